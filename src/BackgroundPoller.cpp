@@ -0,0 +1,159 @@
+#include <motors_elmo_ds402/BackgroundPoller.hpp>
+#include <motors_elmo_ds402/BusLoad.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+BackgroundPoller::BackgroundPoller(BusController& bus, Configuration const& configuration)
+    : mBus(bus)
+    , mConfiguration(configuration)
+    , mScheduler(configuration.timeout, 0)
+    , mCredit(0)
+    , mSentCount(0)
+{
+    if (configuration.framesPerCycle <= 0)
+        throw std::invalid_argument("BackgroundPoller: framesPerCycle must be positive");
+    if (configuration.maxLoad < 0 || configuration.maxLoad > 1)
+        throw std::invalid_argument("BackgroundPoller: maxLoad must be within [0, 1]");
+    if (!configuration.bitrate)
+        throw std::invalid_argument("BackgroundPoller: the bitrate must be positive");
+    if (configuration.responseMargin.toMicroseconds() < 0)
+        throw std::invalid_argument("BackgroundPoller: the response margin must not be negative");
+
+    for (auto& index : mInFlight)
+        index = NO_OBJECT;
+}
+
+void BackgroundPoller::add(uint8_t nodeId, ObjectInfo const& info)
+{
+    if (!mBus.has(nodeId))
+        throw std::invalid_argument("BackgroundPoller: node is not on the bus");
+    if (!info.isReadable())
+        throw std::invalid_argument(string("BackgroundPoller: ") + info.name + " is write-only");
+
+    PolledObject object;
+    object.nodeId = nodeId;
+    object.info = &info;
+    mObjects.push_back(object);
+    mLastRequest.push_back(0);
+}
+
+vector<canbus::Message> BackgroundPoller::poll(base::Time const& now, base::Time const& nextSync)
+{
+    mScheduler.poll(now);
+    for (auto const& failure : mScheduler.getFailures())
+        handleResult(failure, now);
+    mScheduler.clearFailures();
+
+    vector<canbus::Message> messages;
+    if (mObjects.empty())
+        return messages;
+
+    // A transaction is the request and its response
+    int frameBits = getWorstCaseFrameBits(8);
+    double transactionBits = 2 * frameBits;
+    if (mConfiguration.maxLoad > 0)
+    {
+        // Accumulate the budget of this cycle, keeping at most what is
+        // needed for one cycle or one transaction so that an idle poller
+        // does not burst
+        double cycleBits = mConfiguration.maxLoad * mConfiguration.bitrate *
+            mConfiguration.cyclePeriod.toSeconds();
+        mCredit = min(mCredit + cycleBits, max(cycleBits, transactionBits));
+    }
+
+    // Transactions are counted back-to-back on the bus, the response time
+    // of the drives overlapping with the next ones
+    base::Time transactionTime = base::Time::fromMicroseconds(
+        (2 * frameBits * 1000000LL + mConfiguration.bitrate - 1) / mConfiguration.bitrate);
+    base::Time sendTime = now;
+
+    while (static_cast<int>(messages.size()) < mConfiguration.framesPerCycle)
+    {
+        if (mConfiguration.maxLoad > 0 && mCredit < transactionBits)
+            break;
+        if (nextSync < sendTime + transactionTime + mConfiguration.responseMargin)
+            break;
+
+        int index = findNext();
+        if (index == NO_OBJECT)
+            break;
+
+        PolledObject const& object = mObjects[index];
+        Controller const& controller = mBus.get(object.nodeId);
+        messages.push_back(mScheduler.start(controller.queryRawObject(*object.info), now));
+        mInFlight[object.nodeId] = index;
+        mLastRequest[index] = ++mSentCount;
+        sendTime = sendTime + transactionTime;
+        if (mConfiguration.maxLoad > 0)
+            mCredit -= transactionBits;
+    }
+    return messages;
+}
+
+int BackgroundPoller::findNext() const
+{
+    int next = NO_OBJECT;
+    for (size_t i = 0; i < mObjects.size(); ++i)
+    {
+        if (mInFlight[mObjects[i].nodeId] != NO_OBJECT)
+            continue;
+        if (next == NO_OBJECT || mLastRequest[i] < mLastRequest[next])
+            next = i;
+    }
+    return next;
+}
+
+void BackgroundPoller::process(canbus::Message const& msg, base::Time const& now)
+{
+    SDOResult result = mScheduler.process(msg, now);
+    if (result.isValid())
+        handleResult(result, now);
+}
+
+void BackgroundPoller::handleResult(SDOResult const& result, base::Time const& now)
+{
+    int index = mInFlight[result.nodeId];
+    if (index == NO_OBJECT)
+        return;
+    mInFlight[result.nodeId] = NO_OBJECT;
+
+    PolledObject& object = mObjects[index];
+    uint32_t value;
+    if (result.status == SDOResult::SUCCESS &&
+        mBus.get(result.nodeId).getRawObject(*object.info, value))
+    {
+        object.value = value;
+        object.time = now;
+    }
+    else
+        ++object.failures;
+}
+
+vector<PolledObject> const& BackgroundPoller::getObjects() const
+{
+    return mObjects;
+}
+
+PolledObject const& BackgroundPoller::get(uint8_t nodeId, ObjectInfo const& info) const
+{
+    for (auto const& object : mObjects)
+    {
+        if (object.nodeId == nodeId && object.info == &info)
+            return object;
+    }
+    throw std::invalid_argument(string("BackgroundPoller: ") + info.name + " is not polled on this node");
+}
+
+base::Time BackgroundPoller::getAge(uint8_t nodeId, ObjectInfo const& info, base::Time const& now) const
+{
+    PolledObject const& object = get(nodeId, info);
+    if (!object.isValid())
+        return base::Time();
+    return now - object.time;
+}
+
+uint64_t BackgroundPoller::getSentCount() const
+{
+    return mSentCount;
+}
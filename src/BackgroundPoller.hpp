@@ -0,0 +1,158 @@
+#ifndef MOTORS_ELMO_DS402_BACKGROUND_POLLER_HPP
+#define MOTORS_ELMO_DS402_BACKGROUND_POLLER_HPP
+
+#include <vector>
+#include <motors_elmo_ds402/BusController.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+#include <motors_elmo_ds402/SDOScheduler.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Last value read by BackgroundPoller for one object of one node */
+    struct PolledObject
+    {
+        uint8_t nodeId;
+        ObjectInfo const* info;
+        /** Raw value, valid if time is not null */
+        uint32_t value;
+        /** Reception time of the value */
+        base::Time time;
+        /** Number of uploads that were aborted or timed out */
+        uint32_t failures;
+
+        PolledObject()
+            : nodeId(0)
+            , info(nullptr)
+            , value(0)
+            , failures(0) {}
+
+        bool isValid() const { return !time.isNull(); }
+    };
+
+    /** Continuous, low-priority SDO reading of slow-changing objects
+     *
+     * The polled objects (e.g. Temperature, DCLinkCircuitVoltage) are
+     * uploaded least recently requested first, with at most one upload in
+     * flight per node, so that all nodes and objects get their turn. The
+     * poller limits itself to a budget of frames per SYNC cycle and,
+     * optionally, to a fraction of the bus bitrate. A budget below one
+     * transaction per cycle is accumulated over several cycles.
+     *
+     * poll() must be called once per cycle, in the idle gap after the
+     * cycle's PDOs, e.g. once CycleAggregator reports the cycle complete.
+     * It starts no upload whose request and response could still be on the
+     * bus at the next SYNC.
+     * Received frames must be passed to process() after
+     * BusController::process. The values are also available through
+     * Controller::getTelemetry.
+     */
+    class BackgroundPoller
+    {
+    public:
+        struct Configuration
+        {
+            /** Maximum number of uploads started per cycle */
+            int framesPerCycle;
+            /** Maximum fraction of the bitrate used by the uploads and
+             * their responses, or zero for no limit
+             */
+            double maxLoad;
+            /** Bitrate of the bus in bits per second */
+            uint32_t bitrate;
+            /** SYNC period */
+            base::Time cyclePeriod;
+            /** Time before which an unanswered upload is abandoned */
+            base::Time timeout;
+            /** Time the drives take to answer an upload, on top of the
+             * transmission of the request and of the response
+             */
+            base::Time responseMargin;
+
+            Configuration()
+                : framesPerCycle(2)
+                , maxLoad(0)
+                , bitrate(1000000)
+                , cyclePeriod(base::Time::fromMilliseconds(1))
+                , timeout(base::Time::fromMilliseconds(100))
+                , responseMargin(base::Time::fromMicroseconds(200)) {}
+        };
+
+        /**
+         * @throws std::invalid_argument if framesPerCycle is not positive,
+         *   maxLoad is not within [0, 1], bitrate is zero or responseMargin
+         *   is negative
+         */
+        BackgroundPoller(BusController& bus,
+            Configuration const& configuration = Configuration());
+
+        /** Add an object to poll on a node
+         *
+         * @throws std::invalid_argument if the node is not on the bus or
+         *   the object is not readable
+         */
+        void add(uint8_t nodeId, ObjectInfo const& info);
+
+        /** @overload */
+        template<typename T>
+        void add(uint8_t nodeId)
+        {
+            add(nodeId, getObjectInfo<T>());
+        }
+
+        /** Returns the uploads to send in this cycle's idle gap
+         *
+         * @param nextSync time of the next SYNC. Uploads are started only
+         *   if the worst-case transmission of their request and response,
+         *   plus responseMargin, ends by then
+         */
+        std::vector<canbus::Message> poll(base::Time const& now, base::Time const& nextSync);
+
+        /** Process a received frame, after BusController::process */
+        void process(canbus::Message const& msg, base::Time const& now);
+
+        /** The polled objects, in the order they were added */
+        std::vector<PolledObject> const& getObjects() const;
+
+        /** The state of a polled object
+         *
+         * @throws std::invalid_argument if the object is not polled on this
+         *   node
+         */
+        PolledObject const& get(uint8_t nodeId, ObjectInfo const& info) const;
+
+        /** Time since the last value of a polled object was received, or a
+         * null time if none was
+         *
+         * @throws std::invalid_argument if the object is not polled on this
+         *   node
+         */
+        base::Time getAge(uint8_t nodeId, ObjectInfo const& info, base::Time const& now) const;
+
+        /** Total number of uploads started */
+        uint64_t getSentCount() const;
+
+    private:
+        enum { NO_OBJECT = -1 };
+
+        BusController& mBus;
+        Configuration mConfiguration;
+        SDOScheduler mScheduler;
+        std::vector<PolledObject> mObjects;
+        /** Value of mSentCount when each object was last requested, zero
+         * if it never was
+         */
+        std::vector<uint64_t> mLastRequest;
+        /** Index of the object in flight on each node, or NO_OBJECT */
+        int mInFlight[BusUpdate::MAX_NODES];
+        /** Bus time accumulated for the load budget, in bits */
+        double mCredit;
+        uint64_t mSentCount;
+
+        /** The least recently requested object whose node is idle, or
+         * NO_OBJECT
+         */
+        int findNext() const;
+        void handleResult(SDOResult const& result, base::Time const& now);
+    };
+}
+
+#endif
@@ -0,0 +1,117 @@
+#include <motors_elmo_ds402/BusController.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+BusUpdate::BusUpdate()
+{
+    clear();
+}
+
+void BusUpdate::clear()
+{
+    for (int i = 0; i < MAX_NODES; ++i)
+        mUpdates[i] = Update();
+    mNodes[0] = 0;
+    mNodes[1] = 0;
+}
+
+void BusUpdate::merge(NodeUpdate const& update)
+{
+    if (!update.isValid())
+        return;
+
+    uint8_t nodeId = update.nodeId & 0x7F;
+    mUpdates[nodeId].merge(update.update);
+    mNodes[nodeId >> 6] |= static_cast<uint64_t>(1) << (nodeId & 0x3F);
+}
+
+Update const& BusUpdate::get(uint8_t nodeId) const
+{
+    return mUpdates[nodeId & 0x7F];
+}
+
+bool BusUpdate::hasNode(uint8_t nodeId) const
+{
+    nodeId &= 0x7F;
+    return mNodes[nodeId >> 6] & (static_cast<uint64_t>(1) << (nodeId & 0x3F));
+}
+
+bool BusUpdate::isUpdated(uint8_t nodeId, uint64_t updateId) const
+{
+    return hasNode(nodeId) && get(nodeId).isUpdated(updateId);
+}
+
+BusController::BusController()
+{
+    for (int i = 0; i < BusUpdate::MAX_NODES; ++i)
+        mByNodeId[i] = nullptr;
+}
+
+Controller& BusController::add(uint8_t nodeId)
+{
+    if (nodeId == 0 || nodeId >= BusUpdate::MAX_NODES)
+        throw std::invalid_argument("CANOpen node IDs must be within [1, 127]");
+    if (mByNodeId[nodeId])
+        throw std::invalid_argument("there is already a controller for this node ID");
+
+    mControllers.emplace_back(new Controller(nodeId));
+    mByNodeId[nodeId] = mControllers.back().get();
+    return *mControllers.back();
+}
+
+bool BusController::has(uint8_t nodeId) const
+{
+    return nodeId < BusUpdate::MAX_NODES && mByNodeId[nodeId];
+}
+
+Controller& BusController::get(uint8_t nodeId)
+{
+    if (!has(nodeId))
+        throw std::invalid_argument("no controller registered for this node ID");
+    return *mByNodeId[nodeId];
+}
+
+Controller const& BusController::get(uint8_t nodeId) const
+{
+    if (!has(nodeId))
+        throw std::invalid_argument("no controller registered for this node ID");
+    return *mByNodeId[nodeId];
+}
+
+size_t BusController::size() const
+{
+    return mControllers.size();
+}
+
+vector<uint8_t> BusController::getNodeIds() const
+{
+    vector<uint8_t> ids;
+    for (auto const& controller : mControllers)
+        ids.push_back(controller->getNodeId());
+    return ids;
+}
+
+canbus::Message BusController::querySync() const
+{
+    if (mControllers.empty())
+        throw std::logic_error("querySync called on an empty bus");
+    return mControllers.front()->querySync();
+}
+
+uint8_t BusController::getNodeIdFromCOBID(uint32_t cobId)
+{
+    // All CANOpen predefined connection set COB-IDs are made of a 4-bit
+    // function code and the 7-bit node ID. Node ID zero is used for the
+    // broadcast objects (NMT, SYNC and TIME)
+    return cobId & 0x7F;
+}
+
+NodeUpdate BusController::process(canbus::Message const& msg)
+{
+    uint8_t nodeId = getNodeIdFromCOBID(msg.can_id);
+    Controller* controller = mByNodeId[nodeId];
+    if (!controller)
+        return NodeUpdate();
+    return NodeUpdate(nodeId, controller->process(msg));
+}
@@ -0,0 +1,119 @@
+#ifndef MOTORS_ELMO_DS402_BUS_CONTROLLER_HPP
+#define MOTORS_ELMO_DS402_BUS_CONTROLLER_HPP
+
+#include <memory>
+#include <vector>
+#include <motors_elmo_ds402/Controller.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Update of a single node, as returned by BusController::process */
+    struct NodeUpdate
+    {
+        /** The ID of the node the frame was addressed to, or zero if the frame
+         * was not addressed to any of the known nodes
+         */
+        uint8_t nodeId;
+        Update update;
+
+        NodeUpdate()
+            : nodeId(0) {}
+        NodeUpdate(uint8_t nodeId, Update const& update)
+            : nodeId(nodeId)
+            , update(update) {}
+
+        bool isValid() const { return nodeId != 0; }
+    };
+
+    /** Set of per-node updates, accumulated over multiple frames
+     *
+     * This is the bus-level equivalent of Update::merge
+     */
+    class BusUpdate
+    {
+    public:
+        static const int MAX_NODES = 128;
+
+        BusUpdate();
+
+        /** Merge a single-node update into this set */
+        void merge(NodeUpdate const& update);
+
+        /** Reset the set to its empty state */
+        void clear();
+
+        /** Returns the update of a given node */
+        Update const& get(uint8_t nodeId) const;
+
+        /** Whether the given node has been updated at all */
+        bool hasNode(uint8_t nodeId) const;
+
+        /** Whether the given node has been updated with the given update IDs */
+        bool isUpdated(uint8_t nodeId, uint64_t updateId) const;
+
+    private:
+        Update mUpdates[MAX_NODES];
+        uint64_t mNodes[2];
+    };
+
+    /** Representation of a set of controllers sharing the same CAN bus
+     *
+     * It dispatches the received frames to the controller they are addressed
+     * to, using a flat node ID lookup table. The cost of processing a frame
+     * is therefore independent of the number of controllers on the bus.
+     *
+     * Like Controller, this is independent of _how_ the CAN bus is being
+     * accessed.
+     */
+    class BusController
+    {
+    public:
+        BusController();
+
+        /** Create a new controller for the given node
+         *
+         * @throws std::invalid_argument if the node ID is not within [1, 127]
+         *   or if a controller is already registered for it
+         */
+        Controller& add(uint8_t nodeId);
+
+        /** Whether a controller has been registered for the given node */
+        bool has(uint8_t nodeId) const;
+
+        /** Returns the controller of a given node
+         *
+         * @throws std::invalid_argument if there is no controller for this node
+         */
+        Controller& get(uint8_t nodeId);
+
+        /** @overload */
+        Controller const& get(uint8_t nodeId) const;
+
+        /** Returns the number of registered controllers */
+        size_t size() const;
+
+        /** Returns the IDs of the registered nodes, in registration order */
+        std::vector<uint8_t> getNodeIds() const;
+
+        /** Create a Sync message */
+        canbus::Message querySync() const;
+
+        /** Extract the node ID from a CANOpen COB-ID
+         *
+         * Returns zero for the broadcast frames (NMT, SYNC, TIME)
+         */
+        static uint8_t getNodeIdFromCOBID(uint32_t cobId);
+
+        /** Dispatch a CAN message to the controller it is addressed to
+         *
+         * The returned update is invalid (NodeUpdate::isValid() is false) if
+         * the message is not addressed to any of the registered nodes
+         */
+        NodeUpdate process(canbus::Message const& msg);
+
+    private:
+        std::vector<std::unique_ptr<Controller>> mControllers;
+        Controller* mByNodeId[BusUpdate::MAX_NODES];
+    };
+}
+
+#endif
@@ -0,0 +1,384 @@
+#include <motors_elmo_ds402/BusLoad.hpp>
+#include <motors_elmo_ds402/SDOScheduler.hpp>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+/** Bits of a standard data frame that are subject to stuffing, without the
+ * data: SOF, identifier, RTR, IDE, r0, DLC and CRC
+ */
+static const int STUFFED_HEADER_BITS = 34;
+/** Bits of a standard data frame that are not subject to stuffing: CRC
+ * delimiter, ACK slot and delimiter, EOF and the interframe space
+ */
+static const int TRAILER_BITS = 13;
+
+namespace {
+    /** Accumulates the bits of a frame, computing the CRC and counting the
+     * stuff bits on the fly
+     */
+    struct FrameBitStream
+    {
+        uint16_t crc;
+        int runLength;
+        int lastBit;
+        int stuffBits;
+
+        FrameBitStream()
+            : crc(0)
+            , runLength(0)
+            , lastBit(-1)
+            , stuffBits(0) {}
+
+        void stuff(int bit)
+        {
+            if (bit == lastBit)
+                ++runLength;
+            else
+            {
+                lastBit = bit;
+                runLength = 1;
+            }
+
+            if (runLength == 5)
+            {
+                // The stuff bit is the complement of the run, and starts
+                // the next one
+                ++stuffBits;
+                lastBit = !bit;
+                runLength = 1;
+            }
+        }
+
+        void push(uint32_t value, int bitCount)
+        {
+            for (int i = bitCount - 1; i >= 0; --i)
+            {
+                int bit = (value >> i) & 1;
+                int crcNext = bit ^ ((crc >> 14) & 1);
+                crc = (crc << 1) & 0x7FFF;
+                if (crcNext)
+                    crc ^= 0x4599;
+                stuff(bit);
+            }
+        }
+
+        void finish()
+        {
+            uint16_t value = crc;
+            for (int i = 14; i >= 0; --i)
+                stuff((value >> i) & 1);
+        }
+    };
+}
+
+int motors_elmo_ds402::getFrameBits(canbus::Message const& msg)
+{
+    int size = min<int>(msg.size, 8);
+
+    FrameBitStream stream;
+    // SOF, identifier, then RTR, IDE and r0 which are all dominant
+    stream.push(0, 1);
+    stream.push(msg.can_id & 0x7FF, 11);
+    stream.push(0, 3);
+    stream.push(size, 4);
+    for (int i = 0; i < size; ++i)
+        stream.push(msg.data[i], 8);
+    stream.finish();
+    return STUFFED_HEADER_BITS + 8 * size + stream.stuffBits + TRAILER_BITS;
+}
+
+int motors_elmo_ds402::getWorstCaseFrameBits(int dataSize)
+{
+    int stuffed = STUFFED_HEADER_BITS + 8 * dataSize;
+    return stuffed + (stuffed - 1) / 4 + TRAILER_BITS;
+}
+
+BUS_LOAD_SOURCE motors_elmo_ds402::getLoadSource(canbus::Message const& msg)
+{
+    uint32_t function = msg.can_id & 0x780;
+    uint32_t nodeId = msg.can_id & 0x7F;
+    switch(function)
+    {
+        case 0x080:
+            return nodeId ? LOAD_OTHER : LOAD_SYNC;
+        case 0x180:
+        case 0x280:
+        case 0x380:
+        case 0x480:
+            return LOAD_TPDO;
+        case 0x200:
+        case 0x300:
+        case 0x400:
+        case 0x500:
+            return LOAD_RPDO;
+        case 0x580:
+        case 0x600:
+            return LOAD_SDO;
+        case 0x700:
+            return LOAD_HEARTBEAT;
+        default:
+            return LOAD_OTHER;
+    }
+}
+
+static uint32_t getPDOKey(uint8_t nodeId, uint16_t objectId)
+{
+    // Map the mapping parameters (0x16xx, 0x1Axx) to their communication
+    // parameters (0x14xx, 0x18xx)
+    return static_cast<uint32_t>(nodeId) << 16 | (objectId & ~0x0200);
+}
+
+BusLoadModel::PDO::PDO()
+    : transmit(false)
+    , cobId(0x80000000)
+    , transmissionType(0)
+    , eventTimer(0)
+    , mappingCount(0)
+{
+    std::memset(mappingBits, 0, sizeof(mappingBits));
+}
+
+bool BusLoadModel::PDO::isValid() const
+{
+    return !(cobId & 0x80000000) && mappingCount;
+}
+
+int BusLoadModel::PDO::getSize() const
+{
+    int bits = 0;
+    for (int i = 0; i < mappingCount; ++i)
+        bits += mappingBits[i];
+    return min(8, (bits + 7) / 8);
+}
+
+BusLoadModel::BusLoadModel(Configuration const& configuration)
+    : mConfiguration(configuration)
+{
+    if (!configuration.bitrate)
+        throw std::invalid_argument("BusLoadModel: the bitrate must be positive");
+    if (configuration.syncPeriod.toMicroseconds() <= 0)
+        throw std::invalid_argument("BusLoadModel: the SYNC period must be positive");
+    if (configuration.maxLoad <= 0 || configuration.maxLoad > 1)
+        throw std::invalid_argument("BusLoadModel: maxLoad must be within ]0, 1]");
+
+    for (auto& bits : mExtraBits)
+        bits = 0;
+    mExtraBits[LOAD_SYNC] = getWorstCaseFrameBits(0);
+}
+
+void BusLoadModel::addConfiguration(vector<canbus::Message> const& downloads)
+{
+    for (auto const& msg : downloads)
+    {
+        uint8_t nodeId = SDOScheduler::getRequestNodeId(msg);
+        // Expedited downloads only
+        if (!nodeId || (msg.data[0] & 0xE2) != 0x22)
+            continue;
+
+        uint16_t objectId = msg.data[1] | msg.data[2] << 8;
+        uint32_t value = static_cast<uint32_t>(msg.data[4]) |
+            static_cast<uint32_t>(msg.data[5]) << 8 |
+            static_cast<uint32_t>(msg.data[6]) << 16 |
+            static_cast<uint32_t>(msg.data[7]) << 24;
+        addDownload(nodeId, objectId, msg.data[3], value);
+    }
+}
+
+void BusLoadModel::addDownload(uint8_t nodeId, uint16_t objectId,
+    uint8_t objectSubId, uint32_t value)
+{
+    if (objectId == 0x1017 && objectSubId == 0)
+    {
+        mHeartbeats[nodeId] = value & 0xFFFF;
+        return;
+    }
+
+    uint16_t base = objectId & 0xFF00;
+    if (base != 0x1400 && base != 0x1600 && base != 0x1800 && base != 0x1A00)
+        return;
+
+    PDO& pdo = mPDOs[getPDOKey(nodeId, objectId)];
+    pdo.transmit = (base >= 0x1800);
+    if (base == 0x1400 || base == 0x1800)
+    {
+        if (objectSubId == 1)
+            pdo.cobId = value;
+        else if (objectSubId == 2)
+            pdo.transmissionType = value;
+        else if (objectSubId == 5)
+            pdo.eventTimer = value;
+    }
+    else if (objectSubId == 0)
+        pdo.mappingCount = min<uint32_t>(value, MAX_MAPPED_OBJECTS);
+    else if (objectSubId <= MAX_MAPPED_OBJECTS)
+        pdo.mappingBits[objectSubId - 1] = value & 0xFF;
+}
+
+void BusLoadModel::addSDOTraffic(double transactionsPerCycle)
+{
+    addFrames(LOAD_SDO, 8, 2 * transactionsPerCycle);
+}
+
+void BusLoadModel::addFrames(BUS_LOAD_SOURCE source, int dataSize, double framesPerCycle)
+{
+    if (dataSize < 0 || dataSize > 8)
+        throw std::invalid_argument("BusLoadModel: frames carry at most 8 bytes");
+    mExtraBits[source] += framesPerCycle * getWorstCaseFrameBits(dataSize);
+}
+
+double BusLoadModel::getPDOFramesPerCycle(PDO const& pdo) const
+{
+    if (!pdo.transmit)
+        return 1;
+
+    uint8_t type = pdo.transmissionType;
+    if (type >= 1 && type <= 240)
+        return 1.0 / type;
+    else if (type == 252 || type == 253)
+        return 0; // remote-requested only
+    else if (type >= 254 && pdo.eventTimer)
+        return mConfiguration.syncPeriod.toMicroseconds() / (1000.0 * pdo.eventTimer);
+    else
+        return 1;
+}
+
+double BusLoadModel::getBitsPerCycle(BUS_LOAD_SOURCE source) const
+{
+    double bits = mExtraBits[source];
+    if (source == LOAD_TPDO || source == LOAD_RPDO)
+    {
+        for (auto const& entry : mPDOs)
+        {
+            PDO const& pdo = entry.second;
+            if (!pdo.isValid() || pdo.transmit != (source == LOAD_TPDO))
+                continue;
+            bits += getPDOFramesPerCycle(pdo) * getWorstCaseFrameBits(pdo.getSize());
+        }
+    }
+    else if (source == LOAD_HEARTBEAT)
+    {
+        double periodMs = mConfiguration.syncPeriod.toMicroseconds() / 1000.0;
+        for (auto const& entry : mHeartbeats)
+        {
+            if (entry.second)
+                bits += periodMs / entry.second * getWorstCaseFrameBits(1);
+        }
+    }
+    return bits;
+}
+
+double BusLoadModel::getBitsPerCycle() const
+{
+    double bits = 0;
+    for (int i = 0; i < LOAD_SOURCE_COUNT; ++i)
+        bits += getBitsPerCycle(static_cast<BUS_LOAD_SOURCE>(i));
+    return bits;
+}
+
+double BusLoadModel::getLoad() const
+{
+    double cycleBits = mConfiguration.bitrate * mConfiguration.syncPeriod.toSeconds();
+    return getBitsPerCycle() / cycleBits;
+}
+
+void BusLoadModel::validate() const
+{
+    double load = getLoad();
+    if (load > mConfiguration.maxLoad)
+    {
+        std::ostringstream message;
+        message << "worst-case bus load of " << load * 100 << "% exceeds the "
+            << mConfiguration.maxLoad * 100 << "% target";
+        throw BusOverloaded(message.str());
+    }
+}
+
+BusLoadMeter::BusLoadMeter(Configuration const& configuration)
+    : mConfiguration(configuration)
+{
+    if (!configuration.bitrate)
+        throw std::invalid_argument("BusLoadMeter: the bitrate must be positive");
+    if (configuration.window.toMicroseconds() <= 0)
+        throw std::invalid_argument("BusLoadMeter: the window must be positive");
+    clear();
+}
+
+void BusLoadMeter::clear()
+{
+    mWindowStart = base::Time();
+    mWindowBits = 0;
+    mWindowCount = 0;
+    mLoad = 0;
+    mPeakLoad = 0;
+    mFrameCount = 0;
+    for (auto& bits : mBits)
+        bits = 0;
+}
+
+void BusLoadMeter::add(canbus::Message const& msg, base::Time const& time)
+{
+    update(time);
+    int bits = getFrameBits(msg);
+    mWindowBits += bits;
+    mBits[getLoadSource(msg)] += bits;
+    ++mFrameCount;
+}
+
+void BusLoadMeter::update(base::Time const& now)
+{
+    if (mWindowStart.isNull())
+    {
+        mWindowStart = now;
+        return;
+    }
+
+    int64_t windowUsec = mConfiguration.window.toMicroseconds();
+    int64_t elapsed = (now - mWindowStart).toMicroseconds() / windowUsec;
+    if (elapsed <= 0)
+        return;
+
+    double windowBits = mConfiguration.bitrate * mConfiguration.window.toSeconds();
+    // Windows after the first one closed here saw no frame
+    mLoad = elapsed > 1 ? 0 : mWindowBits / windowBits;
+    mPeakLoad = max(mPeakLoad, mWindowBits / windowBits);
+    mWindowCount += elapsed;
+    mWindowBits = 0;
+    mWindowStart = mWindowStart + base::Time::fromMicroseconds(elapsed * windowUsec);
+}
+
+double BusLoadMeter::getLoad() const
+{
+    return mLoad;
+}
+
+double BusLoadMeter::getPeakLoad() const
+{
+    return mPeakLoad;
+}
+
+uint64_t BusLoadMeter::getWindowCount() const
+{
+    return mWindowCount;
+}
+
+uint64_t BusLoadMeter::getFrameCount() const
+{
+    return mFrameCount;
+}
+
+uint64_t BusLoadMeter::getBitCount(BUS_LOAD_SOURCE source) const
+{
+    return mBits[source];
+}
+
+uint64_t BusLoadMeter::getBitCount() const
+{
+    uint64_t bits = 0;
+    for (auto count : mBits)
+        bits += count;
+    return bits;
+}
@@ -0,0 +1,210 @@
+#ifndef MOTORS_ELMO_DS402_BUS_LOAD_HPP
+#define MOTORS_ELMO_DS402_BUS_LOAD_HPP
+
+#include <map>
+#include <stdexcept>
+#include <vector>
+#include <base/Time.hpp>
+#include <canbus/Message.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Length on the bus of a standard CAN data frame, in bits
+     *
+     * It counts the actual stuff bits of the frame, computed from its
+     * identifier, data and CRC, and the interframe space
+     */
+    int getFrameBits(canbus::Message const& msg);
+
+    /** Length on the bus of a standard CAN data frame with the given number
+     * of data bytes and the largest possible number of stuff bits
+     */
+    int getWorstCaseFrameBits(int dataSize);
+
+    /** Traffic categories of the bus load model and meter */
+    enum BUS_LOAD_SOURCE
+    {
+        LOAD_SYNC,
+        LOAD_TPDO,
+        LOAD_RPDO,
+        LOAD_HEARTBEAT,
+        LOAD_SDO,
+        /** EMCY, NMT and any other frame */
+        LOAD_OTHER,
+        LOAD_SOURCE_COUNT
+    };
+
+    /** Traffic category of a frame, based on its COB-ID */
+    BUS_LOAD_SOURCE getLoadSource(canbus::Message const& msg);
+
+    /** Exception thrown by BusLoadModel::validate */
+    struct BusOverloaded : public std::runtime_error
+    {
+        BusOverloaded(std::string const& msg)
+            : std::runtime_error(msg) {}
+    };
+
+    /** Worst-case traffic of a configured bus
+     *
+     * The model is built from the same SDO downloads that configure the
+     * drives, e.g. the result of Controller::queryPeriodicJointStateUpdate,
+     * Controller::queryCyclicCommand or HeartbeatSupervisor::queryConfiguration.
+     * It follows the PDO communication and mapping parameters and the
+     * producer heartbeat time that these downloads write.
+     *
+     * Every frame is counted at its worst-case length. Synchronous TPDOs
+     * are counted at the rate given by their transmission type,
+     * timer-triggered TPDOs at the rate of their event timer and acyclic
+     * ones once per cycle. RPDOs are sent by the master, and are counted
+     * once per cycle. Sporadic traffic (EMCY, NMT) is not modelled.
+     */
+    class BusLoadModel
+    {
+    public:
+        struct Configuration
+        {
+            /** Bitrate of the bus in bits per second */
+            uint32_t bitrate;
+            /** SYNC period */
+            base::Time syncPeriod;
+            /** Highest acceptable fraction of the bitrate */
+            double maxLoad;
+
+            Configuration()
+                : bitrate(1000000)
+                , syncPeriod(base::Time::fromMilliseconds(1))
+                , maxLoad(0.7) {}
+        };
+
+        /**
+         * @throws std::invalid_argument if the bitrate or SYNC period are
+         *   not positive, or if maxLoad is not within ]0, 1]
+         */
+        explicit BusLoadModel(Configuration const& configuration = Configuration());
+
+        /** Account for the objects written by a list of SDO downloads
+         *
+         * Frames that are not expedited SDO downloads, and downloads of
+         * other objects, are ignored
+         */
+        void addConfiguration(std::vector<canbus::Message> const& downloads);
+
+        /** Account for background SDO transactions, such as the uploads of
+         * BackgroundPoller
+         *
+         * @param transactionsPerCycle average number of request/response
+         *   pairs per SYNC cycle
+         */
+        void addSDOTraffic(double transactionsPerCycle);
+
+        /** Account for any other periodic frame */
+        void addFrames(BUS_LOAD_SOURCE source, int dataSize, double framesPerCycle);
+
+        /** Worst-case bits per SYNC cycle of a category of frames */
+        double getBitsPerCycle(BUS_LOAD_SOURCE source) const;
+
+        /** Worst-case bits per SYNC cycle of all the modelled frames */
+        double getBitsPerCycle() const;
+
+        /** Worst-case fraction of the bitrate used by the modelled frames */
+        double getLoad() const;
+
+        /** @throws BusOverloaded if the load is above maxLoad */
+        void validate() const;
+
+    private:
+        static const int MAX_MAPPED_OBJECTS = 8;
+
+        struct PDO
+        {
+            bool transmit;
+            uint32_t cobId;
+            uint8_t transmissionType;
+            uint16_t eventTimer;
+            uint8_t mappingCount;
+            uint8_t mappingBits[MAX_MAPPED_OBJECTS];
+
+            PDO();
+            bool isValid() const;
+            int getSize() const;
+        };
+
+        Configuration mConfiguration;
+        /** PDOs keyed by node ID and communication object, see getPDOKey */
+        std::map<uint32_t, PDO> mPDOs;
+        /** Producer heartbeat time of each node, in milliseconds */
+        std::map<uint8_t, uint16_t> mHeartbeats;
+        double mExtraBits[LOAD_SOURCE_COUNT];
+
+        void addDownload(uint8_t nodeId, uint16_t objectId,
+            uint8_t objectSubId, uint32_t value);
+        /** Number of frames sent per cycle by a PDO */
+        double getPDOFramesPerCycle(PDO const& pdo) const;
+    };
+
+    /** Measurement of the actual utilization of a bus
+     *
+     * All the frames seen on the bus, both sent and received, are passed
+     * to add(). The load is computed over consecutive windows of fixed
+     * duration, from the exact length of the frames.
+     */
+    class BusLoadMeter
+    {
+    public:
+        struct Configuration
+        {
+            /** Bitrate of the bus in bits per second */
+            uint32_t bitrate;
+            /** Duration over which the load is averaged */
+            base::Time window;
+
+            Configuration()
+                : bitrate(1000000)
+                , window(base::Time::fromMilliseconds(100)) {}
+        };
+
+        /**
+         * @throws std::invalid_argument if the bitrate or window are not
+         *   positive
+         */
+        explicit BusLoadMeter(Configuration const& configuration = Configuration());
+
+        /** Account for a frame seen on the bus at the given time */
+        void add(canbus::Message const& msg, base::Time const& time);
+
+        /** Close the windows that ended before the given time */
+        void update(base::Time const& now);
+
+        /** Load measured over the last complete window */
+        double getLoad() const;
+
+        /** Highest load of all the complete windows */
+        double getPeakLoad() const;
+
+        /** Number of windows completed so far */
+        uint64_t getWindowCount() const;
+
+        /** Number of frames seen so far */
+        uint64_t getFrameCount() const;
+
+        /** Number of bits seen so far in a category of frames */
+        uint64_t getBitCount(BUS_LOAD_SOURCE source) const;
+
+        /** Number of bits seen so far */
+        uint64_t getBitCount() const;
+
+        /** Forget all the measurements */
+        void clear();
+
+    private:
+        Configuration mConfiguration;
+        base::Time mWindowStart;
+        uint64_t mWindowBits;
+        uint64_t mWindowCount;
+        double mLoad;
+        double mPeakLoad;
+        uint64_t mFrameCount;
+        uint64_t mBits[LOAD_SOURCE_COUNT];
+    };
+}
+
+#endif
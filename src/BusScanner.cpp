@@ -0,0 +1,201 @@
+#include <motors_elmo_ds402/BusScanner.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static const uint32_t SDO_REQUEST_COB_ID  = 0x600;
+static const uint32_t SDO_RESPONSE_COB_ID = 0x580;
+static const uint8_t SDO_UPLOAD_REQUEST = 0x40;
+static const uint8_t SDO_COMMAND_MASK = 0xE0;
+static const uint8_t SDO_UPLOAD_RESPONSE = 0x40;
+
+static canbus::Message makeUpload(uint8_t nodeId, uint16_t objectId, uint8_t objectSubId)
+{
+    canbus::Message msg;
+    msg.can_id = SDO_REQUEST_COB_ID + nodeId;
+    msg.size = 8;
+    msg.data[0] = SDO_UPLOAD_REQUEST;
+    msg.data[1] = objectId & 0xFF;
+    msg.data[2] = objectId >> 8;
+    msg.data[3] = objectSubId;
+    for (int i = 4; i < 8; ++i)
+        msg.data[i] = 0;
+    return msg;
+}
+
+static bool isSDOResponse(canbus::Message const& msg, uint16_t objectId, uint8_t objectSubId)
+{
+    return (msg.can_id & 0x780) == SDO_RESPONSE_COB_ID && msg.size == 8 &&
+        (msg.data[1] | msg.data[2] << 8) == objectId &&
+        msg.data[3] == objectSubId;
+}
+
+static bool isUploadResponse(canbus::Message const& msg)
+{
+    return (msg.data[0] & SDO_COMMAND_MASK) == SDO_UPLOAD_RESPONSE;
+}
+
+BusScanner::BusScanner(Configuration const& configuration)
+    : mConfiguration(configuration)
+    , mNextProbe(configuration.firstNodeId)
+    , mUnansweredProbes(0)
+    , mBusyNodes(0)
+{
+    if (configuration.firstNodeId == 0 ||
+        configuration.lastNodeId >= BusUpdate::MAX_NODES ||
+        configuration.firstNodeId > configuration.lastNodeId)
+        throw std::invalid_argument("BusScanner: the node range must be within [1, 127]");
+    if (!configuration.burstSize)
+        throw std::invalid_argument("BusScanner: the burst size must be at least one");
+}
+
+vector<canbus::Message> BusScanner::poll(base::Time const& now)
+{
+    vector<canbus::Message> messages;
+    if (now < mNextBurst)
+        return messages;
+
+    // Follow-up queries first, they complete the nodes already found
+    while (messages.size() < mConfiguration.burstSize)
+    {
+        if (!mOutgoing.empty())
+        {
+            messages.push_back(mOutgoing.front());
+            mOutgoing.pop_front();
+        }
+        else if (mNextProbe <= mConfiguration.lastNodeId)
+        {
+            messages.push_back(makeUpload(mNextProbe++,
+                DeviceType::OBJECT_ID, DeviceType::OBJECT_SUB_ID));
+            ++mUnansweredProbes;
+        }
+        else
+            break;
+    }
+
+    if (!messages.empty())
+    {
+        mLastSend = now;
+        mNextBurst = now + mConfiguration.burstPeriod;
+    }
+    return messages;
+}
+
+void BusScanner::process(canbus::Message const& msg)
+{
+    uint8_t nodeId = BusController::getNodeIdFromCOBID(msg.can_id);
+    if (nodeId < mConfiguration.firstNodeId || nodeId >= mNextProbe)
+        return;
+
+    Node& node = mNodes[nodeId];
+    if (!node.found)
+    {
+        if (isSDOResponse(msg, DeviceType::OBJECT_ID, DeviceType::OBJECT_SUB_ID))
+            onFound(nodeId, msg);
+        return;
+    }
+
+    bool wasBusy = node.query != QUERY_DONE || node.waitingNodeState;
+    NodeUpdate update = mBus.process(msg);
+    Controller const& controller = mBus.get(nodeId);
+    if (node.waitingNodeState && update.update.isUpdated(UPDATE_HEARTBEAT))
+    {
+        node.info.nodeState = controller.getNodeState();
+        node.info.hasNodeState = true;
+        node.waitingNodeState = false;
+    }
+
+    if (node.query == QUERY_SERIAL_NUMBER &&
+        isSDOResponse(msg, IdentityObject::OBJECT_ID, IdentityObject::OBJECT_SUB_ID))
+    {
+        if (isUploadResponse(msg))
+        {
+            node.info.serialNumber = controller.getSerialNumber();
+            node.info.hasSerialNumber = true;
+        }
+        node.query = QUERY_PAL_VERSION;
+        sendNextQuery(nodeId);
+    }
+    else if (node.query == QUERY_PAL_VERSION &&
+        isSDOResponse(msg, PALVersion::OBJECT_ID, PALVersion::OBJECT_SUB_ID))
+    {
+        uint32_t value;
+        if (isUploadResponse(msg) &&
+            controller.getRawObject(getObjectInfo<PALVersion>(), value))
+        {
+            node.info.palVersion = value;
+            node.info.hasPALVersion = true;
+        }
+        node.query = QUERY_DONE;
+    }
+
+    if (wasBusy && node.query == QUERY_DONE && !node.waitingNodeState)
+        --mBusyNodes;
+}
+
+void BusScanner::onFound(uint8_t nodeId, canbus::Message const& response)
+{
+    Node& node = mNodes[nodeId];
+    node.found = true;
+    node.info.nodeId = nodeId;
+    if (isUploadResponse(response))
+    {
+        node.info.deviceType = static_cast<uint32_t>(response.data[4]) |
+            static_cast<uint32_t>(response.data[5]) << 8 |
+            static_cast<uint32_t>(response.data[6]) << 16 |
+            static_cast<uint32_t>(response.data[7]) << 24;
+        node.info.hasDeviceType = true;
+    }
+    --mUnansweredProbes;
+
+    Controller& controller = mBus.add(nodeId);
+    node.query = QUERY_SERIAL_NUMBER;
+    node.waitingNodeState = true;
+    ++mBusyNodes;
+    mOutgoing.push_back(controller.queryNodeState());
+    sendNextQuery(nodeId);
+}
+
+void BusScanner::sendNextQuery(uint8_t nodeId)
+{
+    Controller const& controller = mBus.get(nodeId);
+    switch(mNodes[nodeId].query)
+    {
+        case QUERY_SERIAL_NUMBER:
+            mOutgoing.push_back(controller.querySerialNumber());
+            break;
+        case QUERY_PAL_VERSION:
+            mOutgoing.push_back(controller.queryRawObject(getObjectInfo<PALVersion>()));
+            break;
+        case QUERY_DONE:
+            break;
+    }
+}
+
+bool BusScanner::isDone(base::Time const& now) const
+{
+    if (!mOutgoing.empty() || mNextProbe <= mConfiguration.lastNodeId)
+        return false;
+    if (mUnansweredProbes == 0 && mBusyNodes == 0)
+        return true;
+    return !(now < mLastSend + mConfiguration.timeout);
+}
+
+base::Time BusScanner::getNextDeadline() const
+{
+    if (!mOutgoing.empty() || mNextProbe <= mConfiguration.lastNodeId)
+        return mNextBurst;
+    return mLastSend + mConfiguration.timeout;
+}
+
+vector<ScannedNode> BusScanner::getNodes() const
+{
+    vector<ScannedNode> nodes;
+    for (int nodeId = mConfiguration.firstNodeId; nodeId <= mConfiguration.lastNodeId; ++nodeId)
+    {
+        if (mNodes[nodeId].found)
+            nodes.push_back(mNodes[nodeId].info);
+    }
+    return nodes;
+}
@@ -0,0 +1,143 @@
+#ifndef MOTORS_ELMO_DS402_BUS_SCANNER_HPP
+#define MOTORS_ELMO_DS402_BUS_SCANNER_HPP
+
+#include <deque>
+#include <vector>
+#include <motors_elmo_ds402/BusController.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Description of a node found by BusScanner */
+    struct ScannedNode
+    {
+        uint8_t nodeId;
+        /** DeviceType (0x1000), valid if hasDeviceType is set. It is not if
+         * the node aborted the upload, which still proves it is there
+         */
+        uint32_t deviceType;
+        bool hasDeviceType;
+        /** Serial number from the identity object (0x1018 sub 4) */
+        uint32_t serialNumber;
+        bool hasSerialNumber;
+        uint16_t palVersion;
+        bool hasPALVersion;
+        canopen_master::NODE_STATE nodeState;
+        bool hasNodeState;
+
+        ScannedNode()
+            : nodeId(0)
+            , deviceType(0)
+            , hasDeviceType(false)
+            , serialNumber(0)
+            , hasSerialNumber(false)
+            , palVersion(0)
+            , hasPALVersion(false)
+            , nodeState(canopen_master::NODE_UNKNOWN_STATE)
+            , hasNodeState(false) {}
+    };
+
+    /** Discovery of the nodes present on a bus
+     *
+     * A DeviceType upload is sent to all the node IDs of the scanned range
+     * at once, without waiting for the responses. The nodes that respond
+     * are then queried for their serial number, PAL version and NMT state.
+     * A full scan therefore takes a single response timeout instead of
+     * one per node ID.
+     *
+     * To avoid overflowing the transmit queue of the CAN device, the
+     * frames are released in bursts of at most Configuration::burstSize
+     * frames, separated by Configuration::burstPeriod.
+     *
+     * Like SDOScheduler, it only represents the protocol. The caller
+     * writes the messages returned by poll() and passes all the received
+     * messages to process(), until isDone() returns true.
+     */
+    class BusScanner
+    {
+    public:
+        struct Configuration
+        {
+            /** How long to wait for the last response */
+            base::Time timeout;
+            /** Maximum number of frames released at once */
+            size_t burstSize;
+            /** Minimum time between two bursts */
+            base::Time burstPeriod;
+            uint8_t firstNodeId;
+            uint8_t lastNodeId;
+
+            Configuration()
+                : timeout(base::Time::fromMilliseconds(100))
+                , burstSize(8)
+                , burstPeriod(base::Time::fromMilliseconds(1))
+                , firstNodeId(1)
+                , lastNodeId(127) {}
+        };
+
+        /**
+         * @throws std::invalid_argument if the node range is not within
+         *   [1, 127], or if burstSize is zero
+         */
+        explicit BusScanner(Configuration const& configuration = Configuration());
+
+        /** Returns the messages to send now */
+        std::vector<canbus::Message> poll(base::Time const& now);
+
+        /** Process a received message */
+        void process(canbus::Message const& msg);
+
+        /** Whether the scan is finished
+         *
+         * It is finished when all the frames have been sent, and either all
+         * the probed nodes answered all their queries, or the timeout
+         * passed since the last frame was sent
+         */
+        bool isDone(base::Time const& now) const;
+
+        /** Time at which poll() should be called next */
+        base::Time getNextDeadline() const;
+
+        /** The nodes found so far, sorted by node ID */
+        std::vector<ScannedNode> getNodes() const;
+
+    private:
+        /** Follow-up queries of a found node, in the order they are sent */
+        enum NODE_QUERY
+        {
+            QUERY_SERIAL_NUMBER,
+            QUERY_PAL_VERSION,
+            QUERY_DONE
+        };
+
+        struct Node
+        {
+            bool found;
+            NODE_QUERY query;
+            bool waitingNodeState;
+            ScannedNode info;
+
+            Node()
+                : found(false)
+                , query(QUERY_DONE)
+                , waitingNodeState(false) {}
+        };
+
+        Configuration mConfiguration;
+        Node mNodes[BusUpdate::MAX_NODES];
+        BusController mBus;
+
+        /** Next node ID to probe, or lastNodeId + 1 once all are probed */
+        int mNextProbe;
+        /** Number of probed nodes that did not answer yet */
+        int mUnansweredProbes;
+        /** Number of found nodes that still have queries in flight */
+        int mBusyNodes;
+        std::deque<canbus::Message> mOutgoing;
+        base::Time mNextBurst;
+        base::Time mLastSend;
+
+        void onFound(uint8_t nodeId, canbus::Message const& response);
+        void sendNextQuery(uint8_t nodeId);
+    };
+}
+
+#endif
@@ -0,0 +1,154 @@
+#include <motors_elmo_ds402/ConfigurationSnapshot.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static const char* SNAPSHOT_HEADER = "# motors_elmo_ds402 configuration snapshot";
+
+bool ConfigurationSnapshot::isConfigurationObject(ObjectInfo const& info)
+{
+    if (info.access != ACCESS_RW)
+        return false;
+
+    switch(info.getFullId())
+    {
+        case ControlWordRegister::OBJECT_ID << 8:
+        case ModesOfOperation::OBJECT_ID << 8:
+        case TargetTorque::OBJECT_ID << 8:
+        case TargetPosition::OBJECT_ID << 8:
+        case TargetVelocity::OBJECT_ID << 8:
+            return false;
+        default:
+            return true;
+    }
+}
+
+vector<canbus::Message> ConfigurationSnapshot::queryAll(Controller const& controller)
+{
+    vector<canbus::Message> queries;
+    for (auto const& info : OBJECT_REGISTRY)
+    {
+        if (isConfigurationObject(info))
+            queries.push_back(controller.queryRawObject(info));
+    }
+    return queries;
+}
+
+ConfigurationSnapshot ConfigurationSnapshot::capture(Controller const& controller)
+{
+    ConfigurationSnapshot snapshot;
+    for (auto const& info : OBJECT_REGISTRY)
+    {
+        uint32_t value;
+        if (isConfigurationObject(info) && controller.getRawObject(info, value))
+            snapshot.mValues.push_back(make_pair(&info, value));
+    }
+    return snapshot;
+}
+
+ConfigurationSnapshot ConfigurationSnapshot::load(string const& path)
+{
+    ifstream file(path.c_str());
+    if (!file)
+        throw std::runtime_error("cannot open " + path);
+
+    ConfigurationSnapshot snapshot;
+    string line;
+    int lineNumber = 0;
+    while (getline(file, line))
+    {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        istringstream in(line);
+        uint32_t objectId, objectSubId, value;
+        in >> hex >> objectId >> objectSubId >> value;
+        ObjectInfo const* info = in ? findObject(objectId, objectSubId) : nullptr;
+        if (!info || !isConfigurationObject(*info))
+        {
+            ostringstream message;
+            message << path << ":" << lineNumber << ": invalid entry '" << line << "'";
+            throw std::runtime_error(message.str());
+        }
+        // Values are the raw content of the object, restoring a wider value
+        // would silently truncate it
+        if (info->size < 4 && (value >> (8 * info->size)) != 0)
+        {
+            ostringstream message;
+            message << path << ":" << lineNumber << ": value out of the range of "
+                << info->name << " in '" << line << "'";
+            throw std::runtime_error(message.str());
+        }
+        snapshot.set(*info, value);
+    }
+    return snapshot;
+}
+
+void ConfigurationSnapshot::save(string const& path) const
+{
+    ofstream file(path.c_str());
+    file << SNAPSHOT_HEADER << "\n"
+        << "# object sub-index value name\n";
+    for (auto const& value : mValues)
+    {
+        ObjectInfo const& info = *value.first;
+        file << hex << setfill('0')
+            << setw(4) << info.objectId << " "
+            << setw(2) << static_cast<int>(info.objectSubId) << " "
+            << setw(info.size * 2) << value.second << " "
+            << info.name << "\n";
+    }
+    file.flush();
+    if (!file)
+        throw std::runtime_error("failed to write " + path);
+}
+
+vector<canbus::Message> ConfigurationSnapshot::queryCurrent(Controller const& controller) const
+{
+    vector<canbus::Message> queries;
+    for (auto const& value : mValues)
+        queries.push_back(controller.queryRawObject(*value.first));
+    return queries;
+}
+
+vector<canbus::Message> ConfigurationSnapshot::queryRestore(Controller const& controller) const
+{
+    vector<canbus::Message> queries;
+    for (auto const& value : mValues)
+    {
+        uint32_t current;
+        if (!controller.getRawObject(*value.first, current) || current != value.second)
+            queries.push_back(controller.sendRawObject(*value.first, value.second));
+    }
+    return queries;
+}
+
+void ConfigurationSnapshot::set(ObjectInfo const& info, uint32_t value)
+{
+    if (!isConfigurationObject(info))
+        throw std::invalid_argument(string(info.name) + " is not a configuration object");
+
+    // Keep the values sorted, as the registry is
+    auto it = mValues.begin();
+    while (it != mValues.end() && it->first < &info)
+        ++it;
+    if (it != mValues.end() && it->first == &info)
+        it->second = value;
+    else
+        mValues.insert(it, make_pair(&info, value));
+}
+
+vector<pair<ObjectInfo const*, uint32_t>> const& ConfigurationSnapshot::getValues() const
+{
+    return mValues;
+}
+
+size_t ConfigurationSnapshot::size() const
+{
+    return mValues.size();
+}
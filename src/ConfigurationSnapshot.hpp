@@ -0,0 +1,77 @@
+#ifndef MOTORS_ELMO_DS402_CONFIGURATION_SNAPSHOT_HPP
+#define MOTORS_ELMO_DS402_CONFIGURATION_SNAPSHOT_HPP
+
+#include <string>
+#include <vector>
+#include <motors_elmo_ds402/Controller.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Values of the configuration objects of a drive
+     *
+     * The configuration objects are the RW objects of Objects.hpp, except
+     * for the ones that command the drive (control word, mode of operation
+     * and targets).
+     *
+     * To provision a drive from a snapshot, read its current values with
+     * queryCurrent(), then download only the objects that differ with
+     * queryRestore(). The write traffic therefore scales with the size of
+     * the difference, not with the size of the dictionary.
+     */
+    class ConfigurationSnapshot
+    {
+    public:
+        /** Whether an object is part of the snapshots */
+        static bool isConfigurationObject(ObjectInfo const& info);
+
+        /** SDO uploads of all the configuration objects */
+        static std::vector<canbus::Message> queryAll(Controller const& controller);
+
+        /** Create a snapshot from the configuration objects the controller
+         * has received
+         *
+         * Objects that have not been received, e.g. because the drive
+         * refused the upload, are not part of the snapshot
+         */
+        static ConfigurationSnapshot capture(Controller const& controller);
+
+        /** Load a snapshot written by save()
+         *
+         * @throws std::runtime_error if the file cannot be read, is
+         *   malformed or refers to an object that is not a configuration
+         *   object
+         */
+        static ConfigurationSnapshot load(std::string const& path);
+
+        /** Save the snapshot, one object per line
+         *
+         * @throws std::runtime_error if the file cannot be written
+         */
+        void save(std::string const& path) const;
+
+        /** SDO uploads of the objects of this snapshot, to be processed by
+         * the controller before calling queryRestore
+         */
+        std::vector<canbus::Message> queryCurrent(Controller const& controller) const;
+
+        /** SDO downloads of the objects whose value differs from the last
+         * value received by the controller, or that have not been received
+         */
+        std::vector<canbus::Message> queryRestore(Controller const& controller) const;
+
+        /** Add or replace the value of an object
+         *
+         * @throws std::invalid_argument if it is not a configuration object
+         */
+        void set(ObjectInfo const& info, uint32_t value);
+
+        /** The objects and their raw values, sorted by object ID */
+        std::vector<std::pair<ObjectInfo const*, uint32_t>> const& getValues() const;
+
+        size_t size() const;
+
+    private:
+        std::vector<std::pair<ObjectInfo const*, uint32_t>> mValues;
+    };
+}
+
+#endif
@@ -1,12 +1,84 @@
 #include <motors_elmo_ds402/Controller.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+#include <cstddef>
+#include <cmath>
+#include <chrono>
+#include <limits>
 
 using namespace std;
 using namespace motors_elmo_ds402;
 
+template<typename T>
+static uint32_t getFullId()
+{
+    return static_cast<uint32_t>(T::OBJECT_ID) << 8 | T::OBJECT_SUB_ID;
+}
+
+/** Narrow a value converted to drive units to the type of its object
+ *
+ * @throws std::invalid_argument if it does not fit
+ */
+template<typename T>
+static T narrowToObject(int64_t value, char const* context)
+{
+    if (value < numeric_limits<T>::min() || value > numeric_limits<T>::max())
+        throw std::invalid_argument(string(context) + ": value out of the range of the drive object");
+    return static_cast<T>(value);
+}
+
 Controller::Controller(uint8_t nodeId)
-    : mCanOpen(nodeId)
+    : mNodeId(nodeId)
+    , mCanOpen(nodeId)
     , mRatedTorque(base::unknown<double>())
+    , mFactorsReady(0)
+    , mFactorsInvalid(false)
+    , mCommandPDOIndex(-1)
+    , mCommandMode(OperationMode::CYCLIC_SYNCHRONOUS_POSITION)
+    , mCommandControlWord(
+        encode<ControlWord, uint16_t>(ControlWord(ControlWord::ENABLE_OPERATION, false)))
+    , mProcessCount(0)
 {
+    for (auto& interval : mLastTPDOInterval)
+        interval = -1;
+    std::memset(mReceived, 0, sizeof(mReceived));
+    std::memset(mTPDOObjects, 0, sizeof(mTPDOObjects));
+
+    canbus::Message factors[FACTORS_QUERY_SIZE] = {
+        queryObject<PositionEncoderResolutionNum>(),
+        queryObject<PositionEncoderResolutionDen>(),
+        queryObject<GearRatioNum>(),
+        queryObject<GearRatioDen>(),
+        queryObject<FeedConstantNum>(),
+        queryObject<FeedConstantDen>(),
+        queryObject<VelocityFactorNum>(),
+        queryObject<VelocityFactorDen>(),
+        queryObject<MotorRatedCurrent>(),
+    };
+    copy(factors, factors + FACTORS_QUERY_SIZE, mFactorsQuery);
+
+    // NOTE: we don't need to query TorqueActualValue. Given how bot this and
+    // CurrentActualValue are encoded, they contain the same value
+    canbus::Message jointState[JOINT_STATE_QUERY_SIZE] = {
+        queryObject<PositionActualInternalValue>(),
+        queryObject<VelocityActualValue>(),
+        queryObject<CurrentActualValue>()
+    };
+    copy(jointState, jointState + JOINT_STATE_QUERY_SIZE, mJointStateQuery);
+
+    canbus::Message jointLimits[JOINT_LIMITS_QUERY_SIZE] = {
+        queryObject<SoftwarePositionLimitMin>(),
+        queryObject<SoftwarePositionLimitMax>(),
+        queryObject<MaxMotorSpeed>(),
+        queryObject<MaxAcceleration>(),
+        queryObject<MaxDeceleration>(),
+        queryObject<MaxCurrent>()
+    };
+    copy(jointLimits, jointLimits + JOINT_LIMITS_QUERY_SIZE, mJointLimitsQuery);
+}
+
+uint8_t Controller::getNodeId() const
+{
+    return mNodeId;
 }
 
 void Controller::setRatedTorque(double ratedTorque)
@@ -47,43 +119,63 @@ canbus::Message Controller::queryStatusWord() const
 
 std::vector<canbus::Message> Controller::queryFactors()
 {
-    return std::vector<canbus::Message>
-    {
-        queryObject<PositionEncoderResolutionNum>(),
-        queryObject<PositionEncoderResolutionDen>(),
-        queryObject<GearRatioNum>(),
-        queryObject<GearRatioDen>(),
-        queryObject<FeedConstantNum>(),
-        queryObject<FeedConstantDen>(),
-        queryObject<VelocityFactorNum>(),
-        queryObject<VelocityFactorDen>(),
-        queryObject<MotorRatedCurrent>(),
-    };
+    return std::vector<canbus::Message>(
+        mFactorsQuery, mFactorsQuery + FACTORS_QUERY_SIZE);
 }
 
+enum FACTOR_INPUTS
+{
+    FACTOR_INPUT_ENCODER_TICKS          = 0x01,
+    FACTOR_INPUT_ENCODER_REVOLUTIONS    = 0x02,
+    FACTOR_INPUT_GEAR_MOTOR_SHAFT       = 0x04,
+    FACTOR_INPUT_GEAR_DRIVING_SHAFT     = 0x08,
+    FACTOR_INPUT_FEED_LENGTH            = 0x10,
+    FACTOR_INPUT_FEED_DRIVING_SHAFT     = 0x20,
+    FACTOR_INPUT_RATED_CURRENT          = 0x40,
+    FACTOR_INPUT_RATED_TORQUE           = 0x80,
+    FACTOR_INPUT_ALL                    = 0xFF,
+
+    // Optional inputs, the factors are computed without them
+    FACTOR_INPUT_VELOCITY_FACTOR_NUM    = 0x100,
+    FACTOR_INPUT_VELOCITY_FACTOR_DEN    = 0x200
+};
+
 void Controller::setMotorParameters(MotorParameters const& parameters)
 {
-    if (parameters.encoderTicks)
+    if (parameters.encoderTicks) {
         setRaw<PositionEncoderResolutionNum>(parameters.encoderTicks);
-    if (parameters.encoderRevolutions)
+        updateFactorInput(getFullId<PositionEncoderResolutionNum>());
+    }
+    if (parameters.encoderRevolutions) {
         setRaw<PositionEncoderResolutionDen>(parameters.encoderRevolutions);
-    if (parameters.gearMotorShaftRevolutions)
+        updateFactorInput(getFullId<PositionEncoderResolutionDen>());
+    }
+    if (parameters.gearMotorShaftRevolutions) {
         setRaw<GearRatioNum>(parameters.gearMotorShaftRevolutions);
-    if (parameters.gearDrivingShaftRevolutions)
+        updateFactorInput(getFullId<GearRatioNum>());
+    }
+    if (parameters.gearDrivingShaftRevolutions) {
         setRaw<GearRatioDen>(parameters.gearDrivingShaftRevolutions);
-    if (parameters.feedLength)
+        updateFactorInput(getFullId<GearRatioDen>());
+    }
+    if (parameters.feedLength) {
         setRaw<FeedConstantNum>(parameters.feedLength);
-    if (parameters.feedDrivingShaftRevolutions)
+        updateFactorInput(getFullId<FeedConstantNum>());
+    }
+    if (parameters.feedDrivingShaftRevolutions) {
         setRaw<FeedConstantDen>(parameters.feedDrivingShaftRevolutions);
+        updateFactorInput(getFullId<FeedConstantDen>());
+    }
     if (!base::isUnknown(parameters.torqueConstant)) {
-        uint64_t current_mA = getRaw<MotorRatedCurrent>();
-        setRaw<MotorRatedTorque>(current_mA * parameters.torqueConstant);
+        if (!(mFactorsReady & FACTOR_INPUT_RATED_CURRENT))
+            throw std::logic_error("setMotorParameters: the torque constant requires "
+                "the rated current, read it with queryFactors first");
+        setRaw<MotorRatedTorque>(std::llround(
+            mFactorsInput.ratedCurrent * 1000 * parameters.torqueConstant));
+        updateFactorInput(getFullId<MotorRatedTorque>());
     }
 
-    try {
-        mFactors = computeFactors();
-    }
-    catch(canopen_master::ObjectNotRead) {}
+    updateFactors();
 }
 
 Factors Controller::getFactors() const
@@ -91,100 +183,346 @@ Factors Controller::getFactors() const
     return mFactors;
 }
 
-Factors Controller::computeFactors() const
+bool Controller::hasInvalidFactors() const
 {
-    Factors factors;
-    factors.encoderTicks = getRaw<PositionEncoderResolutionNum>();
-    factors.encoderRevolutions = getRaw<PositionEncoderResolutionDen>();
-    factors.gearMotorShaftRevolutions = getRaw<GearRatioNum>();
-    factors.gearDrivingShaftRevolutions = getRaw<GearRatioDen>();
-    factors.feedLength = getRaw<FeedConstantNum>();
-    factors.feedDrivingShaftRevolutions = getRaw<FeedConstantDen>();
-    factors.ratedTorque  = static_cast<double>(getRaw<MotorRatedTorque>()) / 1000;
-    factors.ratedCurrent = static_cast<double>(getRaw<MotorRatedCurrent>()) / 1000;
-    factors.update();
-    return factors;
+    return mFactorsInvalid;
+}
+
+canbus::Message Controller::querySerialNumber() const
+{
+    return queryObject<IdentityObject>();
 }
 
-#define MODE_UPDATE_CASE(mode, object) \
-    case canopen_master::StateMachine::mode: \
-        update |= object::UPDATE_ID; \
-        break;
+uint32_t Controller::getSerialNumber() const
+{
+    return getRaw<IdentityObject>();
+}
 
-#define SDO_UPDATE_CASE(object) \
+#define FACTOR_INPUT_CASE(object, input, field, value) \
     case (static_cast<uint32_t>(object::OBJECT_ID) << 8 | object::OBJECT_SUB_ID): \
-        update |= object::UPDATE_ID; \
-        break;
+        mFactorsInput.field = value; \
+        mFactorsReady |= input; \
+        return true;
+
+bool Controller::updateFactorInput(uint32_t fullId)
+{
+    // The object is known to be present in the dictionary, getRaw will not
+    // throw
+    switch(fullId)
+    {
+        FACTOR_INPUT_CASE(PositionEncoderResolutionNum,
+            FACTOR_INPUT_ENCODER_TICKS, encoderTicks,
+            getRaw<PositionEncoderResolutionNum>());
+        FACTOR_INPUT_CASE(PositionEncoderResolutionDen,
+            FACTOR_INPUT_ENCODER_REVOLUTIONS, encoderRevolutions,
+            getRaw<PositionEncoderResolutionDen>());
+        FACTOR_INPUT_CASE(GearRatioNum,
+            FACTOR_INPUT_GEAR_MOTOR_SHAFT, gearMotorShaftRevolutions,
+            getRaw<GearRatioNum>());
+        FACTOR_INPUT_CASE(GearRatioDen,
+            FACTOR_INPUT_GEAR_DRIVING_SHAFT, gearDrivingShaftRevolutions,
+            getRaw<GearRatioDen>());
+        FACTOR_INPUT_CASE(FeedConstantNum,
+            FACTOR_INPUT_FEED_LENGTH, feedLength,
+            getRaw<FeedConstantNum>());
+        FACTOR_INPUT_CASE(FeedConstantDen,
+            FACTOR_INPUT_FEED_DRIVING_SHAFT, feedDrivingShaftRevolutions,
+            getRaw<FeedConstantDen>());
+        FACTOR_INPUT_CASE(VelocityFactorNum,
+            FACTOR_INPUT_VELOCITY_FACTOR_NUM, velocityFactorNum,
+            getRaw<VelocityFactorNum>());
+        FACTOR_INPUT_CASE(VelocityFactorDen,
+            FACTOR_INPUT_VELOCITY_FACTOR_DEN, velocityFactorDen,
+            getRaw<VelocityFactorDen>());
+        FACTOR_INPUT_CASE(MotorRatedCurrent,
+            FACTOR_INPUT_RATED_CURRENT, ratedCurrent,
+            static_cast<double>(getRaw<MotorRatedCurrent>()) / 1000);
+        FACTOR_INPUT_CASE(MotorRatedTorque,
+            FACTOR_INPUT_RATED_TORQUE, ratedTorque,
+            static_cast<double>(getRaw<MotorRatedTorque>()) / 1000);
+        default:
+            return false;
+    }
+}
+
+void Controller::updateFactors()
+{
+    if ((mFactorsReady & FACTOR_INPUT_ALL) != FACTOR_INPUT_ALL)
+        return;
+
+    // Keep the previous factors if the new ones are invalid. This runs on
+    // the receive path, where a bad configuration on the drive side must
+    // not make process() throw
+    mFactorsInvalid = !mFactorsInput.isValid();
+    if (mFactorsInvalid)
+        return;
+
+    Factors factors = mFactorsInput;
+    factors.update();
+    mFactors = factors;
+}
+
+int Controller::getTPDOIndex(uint32_t cobId) const
+{
+    if ((cobId & 0x7F) != mNodeId)
+        return -1;
+
+    // TPDOs are 0x180, 0x280, 0x380 and 0x480. RPDOs are interleaved in
+    // between
+    uint32_t function = cobId & 0x780;
+    if (function < 0x180 || function > 0x480 || !(function & 0x80))
+        return -1;
+    return (function >> 8) - 1;
+}
 
 Update Controller::process(canbus::Message const& msg)
 {
+    FRAME_TYPE type = FRAME_OTHER;
+    if (++mProcessCount % PROCESS_TIME_SAMPLING)
+    {
+        Update update = processFrame(msg, type);
+        mStatistics.countFrame(type);
+        return update;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    Update update = processFrame(msg, type);
+    auto duration = std::chrono::steady_clock::now() - start;
+
+    mStatistics.countFrame(type);
+    mStatistics.processTime.add(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+    return update;
+}
+
+void Controller::notifySync(base::Time const& time)
+{
+    mLastSync = time;
+}
+
+void Controller::recordSDORoundTrip(base::Time const& roundTrip)
+{
+    mStatistics.sdoRoundTrip.add(roundTrip.toMicroseconds());
+}
+
+ControllerStatistics const& Controller::getStatistics() const
+{
+    return mStatistics;
+}
+
+void Controller::clearStatistics()
+{
+    mStatistics.clear();
+    for (int i = 0; i < TPDO_COUNT; ++i)
+    {
+        mLastTPDOTime[i] = base::Time();
+        mLastTPDOInterval[i] = -1;
+    }
+}
+
+Update Controller::processEmergency(canbus::Message const& msg)
+{
+    Emergency emergency = Emergency::parse(msg);
+    mEmergencies.push(emergency);
+    std::memcpy(&mDecoded.values[ObjectIndex<ErrorCode>::value],
+        &emergency.errorCode, sizeof(emergency.errorCode));
+    std::memcpy(&mDecoded.values[ObjectIndex<ErrorRegister>::value],
+        &emergency.errorRegister, sizeof(emergency.errorRegister));
+    markReceived(ObjectIndex<ErrorCode>::value);
+    markReceived(ObjectIndex<ErrorRegister>::value);
+    return Update::UpdatedObjects(UPDATE_EMERGENCY);
+}
+
+EmergencyHistory const& Controller::getEmergencies() const
+{
+    return mEmergencies;
+}
+
+void Controller::clearEmergencies()
+{
+    mEmergencies.clear();
+}
+
+void Controller::recordTPDOTiming(int pdoIndex, base::Time const& time)
+{
+    if (time.isNull())
+        return;
+
+    if (!mLastSync.isNull() && !(time < mLastSync))
+        mStatistics.syncToPDOLatency.add((time - mLastSync).toMicroseconds());
+
+    base::Time& lastTime = mLastTPDOTime[pdoIndex];
+    int64_t& lastInterval = mLastTPDOInterval[pdoIndex];
+    if (!lastTime.isNull())
+    {
+        int64_t interval = (time - lastTime).toMicroseconds();
+        if (lastInterval >= 0)
+            mStatistics.tpdoJitter.add(std::abs(interval - lastInterval));
+        lastInterval = interval;
+    }
+    lastTime = time;
+}
+
+Update Controller::processFrame(canbus::Message const& msg, FRAME_TYPE& type)
+{
+    int pdoIndex = getTPDOIndex(msg.can_id);
+    if (pdoIndex >= 0 && !mTPDODecoders[pdoIndex].empty())
+    {
+        uint8_t* target = reinterpret_cast<uint8_t*>(&mDecoded);
+        uint64_t update = mTPDODecoders[pdoIndex].decode(msg, target);
+        if (update)
+        {
+            type = FRAME_TPDO;
+            for (int i = 0; i < RECEIVED_WORDS; ++i)
+                mReceived[i] |= mTPDOObjects[pdoIndex][i];
+            recordTPDOTiming(pdoIndex, msg.time);
+        }
+        return Update::UpdatedObjects(update);
+    }
+
+    if (Emergency::getNodeId(msg) == mNodeId && msg.size == 8)
+    {
+        type = FRAME_EMERGENCY;
+        return processEmergency(msg);
+    }
+
     uint64_t update = 0;
     auto canUpdate = mCanOpen.process(msg);
     switch(canUpdate.mode)
     {
-        MODE_UPDATE_CASE(PROCESSED_HEARTBEAT, Heartbeat);
+        case canopen_master::StateMachine::PROCESSED_HEARTBEAT:
+            type = FRAME_HEARTBEAT;
+            update |= Heartbeat::UPDATE_ID;
+            break;
         case canopen_master::StateMachine::PROCESSED_SDO_INITIATE_DOWNLOAD:
         {
             // Ack of a upload request
+            type = FRAME_SDO_ACK;
             auto object = canUpdate.updated[0];
             return Update::Ack(object.first, object.second);
         }
+        case canopen_master::StateMachine::PROCESSED_SDO:
+            type = FRAME_SDO;
+            break;
+        case canopen_master::StateMachine::PROCESSED_PDO:
+            type = FRAME_PDO;
+            break;
 
         default: ; // we just ignore the rest, we really don't care
     };
 
+    bool factorsUpdated = false;
     for (auto it = canUpdate.begin(); it != canUpdate.end(); ++it)
     {
-        uint32_t fullId = static_cast<uint32_t>(it->first) << 8 | it->second;
+        ObjectInfo const* info = findObject(it->first, it->second);
+        if (!info)
+            continue;
 
-        switch(fullId)
-        {
-            SDO_UPDATE_CASE(StatusWord);
-
-            // UPDATE_FACTORS
-            SDO_UPDATE_CASE(PositionEncoderResolutionNum);
-            SDO_UPDATE_CASE(PositionEncoderResolutionDen);
-            SDO_UPDATE_CASE(VelocityEncoderResolutionNum);
-            SDO_UPDATE_CASE(VelocityEncoderResolutionDen);
-            SDO_UPDATE_CASE(AccelerationFactorNum);
-            SDO_UPDATE_CASE(AccelerationFactorDen);
-            SDO_UPDATE_CASE(GearRatioNum);
-            SDO_UPDATE_CASE(GearRatioDen);
-            SDO_UPDATE_CASE(FeedConstantNum);
-            SDO_UPDATE_CASE(FeedConstantDen);
-            SDO_UPDATE_CASE(VelocityFactorNum);
-            SDO_UPDATE_CASE(VelocityFactorDen);
-            SDO_UPDATE_CASE(MotorRatedCurrent);
-            SDO_UPDATE_CASE(MotorRatedTorque);
-
-            // UPDATE_JOINT_STATE
-            SDO_UPDATE_CASE(PositionActualInternalValue);
-            SDO_UPDATE_CASE(VelocityActualValue);
-            SDO_UPDATE_CASE(CurrentActualValue);
-
-            // UPDATE_JOINT_LIMITS
-            SDO_UPDATE_CASE(SoftwarePositionLimitMin);
-            SDO_UPDATE_CASE(SoftwarePositionLimitMax);
-            SDO_UPDATE_CASE(MaxMotorSpeed);
-            SDO_UPDATE_CASE(MaxAcceleration);
-            SDO_UPDATE_CASE(MaxDeceleration);
-            SDO_UPDATE_CASE(MaxCurrent);
-        }
+        update |= info->updateId;
+        factorsUpdated = updateFromDictionary(*info) || factorsUpdated;
     }
 
-    if (update & UPDATE_FACTORS) {
-        try {
-            mFactors = computeFactors();
+    if (factorsUpdated)
+        updateFactors();
+
+    return Update::UpdatedObjects(update);
+}
+
+bool Controller::updateFromDictionary(ObjectInfo const& info)
+{
+    updateObjectValue(info);
+    if (info.updateId & UPDATE_FACTORS)
+        return updateFactorInput(info.getFullId());
+    else if (info.updateId & UPDATE_JOINT_STATE)
+        updateJointStateSample(info.getFullId());
+    return false;
+}
+
+canbus::Message Controller::queryRawObject(ObjectInfo const& info) const
+{
+    return mCanOpen.upload(info.objectId, info.objectSubId);
+}
+
+canbus::Message Controller::sendRawObject(ObjectInfo const& info, uint32_t value) const
+{
+    switch(info.size)
+    {
+        case 1: return mCanOpen.download<uint8_t>(info.objectId, info.objectSubId, value);
+        case 2: return mCanOpen.download<uint16_t>(info.objectId, info.objectSubId, value);
+        default: return mCanOpen.download<uint32_t>(info.objectId, info.objectSubId, value);
+    }
+}
+
+bool Controller::getRawObject(ObjectInfo const& info, uint32_t& value) const
+{
+    try {
+        switch(info.size)
+        {
+            case 1: value = mCanOpen.get<uint8_t>(info.objectId, info.objectSubId); break;
+            case 2: value = mCanOpen.get<uint16_t>(info.objectId, info.objectSubId); break;
+            default: value = mCanOpen.get<uint32_t>(info.objectId, info.objectSubId); break;
         }
-        catch(canopen_master::ObjectNotRead) {}
+        return true;
+    }
+    catch(canopen_master::ObjectNotRead const&) {
+        return false;
     }
+}
 
-    return Update::UpdatedObjects(update);
+Update Controller::setRawObject(ObjectInfo const& info, uint32_t value)
+{
+    switch(info.size)
+    {
+        case 1: mCanOpen.set<uint8_t>(info.objectId, info.objectSubId, value); break;
+        case 2: mCanOpen.set<uint16_t>(info.objectId, info.objectSubId, value); break;
+        default: mCanOpen.set<uint32_t>(info.objectId, info.objectSubId, value); break;
+    }
+    if (updateFromDictionary(info))
+        updateFactors();
+    return Update::UpdatedObjects(info.updateId);
 }
 
 StatusWord Controller::getStatusWord() const
 {
-    return get<StatusWord>();
+    if (!hasTelemetry<StatusWordRegister>())
+        throw canopen_master::ObjectNotRead("the status word has not been received");
+    return parse<StatusWord, uint16_t>(getTelemetry<StatusWordRegister>());
+}
+
+bool Controller::hasTelemetry(ObjectInfo const& info) const
+{
+    return isReceived(getObjectIndex(info));
+}
+
+void Controller::markReceived(size_t index)
+{
+    mReceived[index / 64] |= static_cast<uint64_t>(1) << (index % 64);
+}
+
+void Controller::updateObjectValue(ObjectInfo const& info)
+{
+    // The object is known to be present in the dictionary, get will not
+    // throw
+    markReceived(getObjectIndex(info));
+    uint32_t* cell = &mDecoded.values[getObjectIndex(info)];
+    switch(info.size)
+    {
+        case 1:
+        {
+            uint8_t value = mCanOpen.get<uint8_t>(info.objectId, info.objectSubId);
+            std::memcpy(cell, &value, 1);
+            break;
+        }
+        case 2:
+        {
+            uint16_t value = mCanOpen.get<uint16_t>(info.objectId, info.objectSubId);
+            std::memcpy(cell, &value, 2);
+            break;
+        }
+        case 4:
+            *cell = mCanOpen.get<uint32_t>(info.objectId, info.objectSubId);
+            break;
+    }
 }
 
 template<typename T>
@@ -205,6 +543,12 @@ T Controller::get() const
     return parse<T, typename T::OBJECT_TYPE>(getRaw<T>());
 }
 
+template<typename T>
+canbus::Message Controller::download(typename T::OBJECT_TYPE value) const
+{
+    return mCanOpen.download(T::OBJECT_ID, T::OBJECT_SUB_ID, value);
+}
+
 template<typename T>
 canbus::Message Controller::queryObject() const
 {
@@ -213,27 +557,54 @@ canbus::Message Controller::queryObject() const
 
 std::vector<canbus::Message> Controller::queryJointState() const
 {
-    // NOTE: we don't need to query TorqueActualValue. Given how bot this and
-    // CurrentActualValue are encoded, they contain the same value
-    return vector<canbus::Message> {
-        queryObject<PositionActualInternalValue>(),
-        queryObject<VelocityActualValue>(),
-        queryObject<CurrentActualValue>()
-    };
+    return vector<canbus::Message>(
+        mJointStateQuery, mJointStateQuery + JOINT_STATE_QUERY_SIZE);
+}
+
+void Controller::updateJointStateSample(uint32_t fullId)
+{
+    // The object is known to be present in the dictionary, getRaw will not
+    // throw
+    if (fullId == getFullId<PositionActualInternalValue>())
+        mDecoded.jointState.position = getRaw<PositionActualInternalValue>();
+    else if (fullId == getFullId<VelocityActualValue>())
+        mDecoded.jointState.velocity = getRaw<VelocityActualValue>();
+    else if (fullId == getFullId<CurrentActualValue>())
+        mDecoded.jointState.current = getRaw<CurrentActualValue>();
+}
+
+JointStateSample const& Controller::getJointStateSample() const
+{
+    return mDecoded.jointState;
+}
+
+uint64_t Controller::getJointStateFields() const
+{
+    uint64_t fields = 0;
+    if (hasTelemetry<PositionActualInternalValue>())
+        fields |= UPDATE_JOINT_POSITION;
+    if (hasTelemetry<VelocityActualValue>())
+        fields |= UPDATE_JOINT_VELOCITY;
+    if (hasTelemetry<CurrentActualValue>())
+        fields |= UPDATE_JOINT_CURRENT;
+    return fields;
 }
 
 base::JointState Controller::getJointState(uint64_t fields) const
 {
-    auto position = getRaw<PositionActualInternalValue>();
-    auto velocity = getRaw<VelocityActualValue>();
-    // See comment in queryJointState
-    auto current_and_torque = getRaw<CurrentActualValue>();
+    if ((fields & UPDATE_JOINT_STATE) & ~getJointStateFields())
+        throw canopen_master::ObjectNotRead("the joint state has not been received");
+
+    auto position = mDecoded.jointState.position;
+    auto velocity = mDecoded.jointState.velocity;
+    // See comment in the constructor
+    auto current_and_torque = mDecoded.jointState.current;
 
     base::JointState state;
     if (fields & UPDATE_JOINT_POSITION)
         state.position = mFactors.scaleEncoderValue(position);
     if (fields & UPDATE_JOINT_VELOCITY)
-        state.speed    = mFactors.scaleEncoderValue(velocity);
+        state.speed    = mFactors.velocityToUser(velocity);
     if (fields & UPDATE_JOINT_CURRENT) {
         state.raw      = mFactors.currentToUser(current_and_torque);
         state.effort   = mFactors.currentToUserTorque(current_and_torque);
@@ -243,14 +614,8 @@ base::JointState Controller::getJointState(uint64_t fields) const
 
 vector<canbus::Message> Controller::queryJointLimits() const
 {
-    return vector<canbus::Message> {
-        queryObject<SoftwarePositionLimitMin>(),
-        queryObject<SoftwarePositionLimitMax>(),
-        queryObject<MaxMotorSpeed>(),
-        queryObject<MaxAcceleration>(),
-        queryObject<MaxDeceleration>(),
-        queryObject<MaxCurrent>()
-    };
+    return vector<canbus::Message>(
+        mJointLimitsQuery, mJointLimitsQuery + JOINT_LIMITS_QUERY_SIZE);
 }
 
 base::JointLimitRange Controller::getJointLimits() const
@@ -279,7 +644,7 @@ base::JointLimitRange Controller::getJointLimits() const
     }
     else
     {
-        double speedLimit = mFactors.scaleEncoderValue(rawMaxSpeed);
+        double speedLimit = mFactors.velocityToUser(rawMaxSpeed);
         min.speed = -speedLimit;
         max.speed = speedLimit;
     }
@@ -302,16 +667,64 @@ base::JointLimitRange Controller::getJointLimits() const
     return range;
 }
 
+vector<canbus::Message> Controller::setJointLimits(base::JointLimitRange const& limits)
+{
+    vector<canbus::Message> messages;
+
+    // See getJointLimits for the handling of infinite limits
+    if (std::isinf(limits.min.position) && std::isinf(limits.max.position)) {
+        messages.push_back(download<SoftwarePositionLimitMin>(0));
+        messages.push_back(download<SoftwarePositionLimitMax>(0));
+    }
+    else if (std::isinf(limits.min.position) || std::isinf(limits.max.position)) {
+        // The drive can only disable both limits at once
+        throw std::invalid_argument("setJointLimits: the position limits "
+            "must be either both infinite or both finite");
+    }
+    else if (!base::isUnknown(limits.min.position) &&
+             !base::isUnknown(limits.max.position)) {
+        messages.push_back(download<SoftwarePositionLimitMin>(narrowToObject<int32_t>(
+            mFactors.userToEncoderValue(limits.min.position), "setJointLimits")));
+        messages.push_back(download<SoftwarePositionLimitMax>(narrowToObject<int32_t>(
+            mFactors.userToEncoderValue(limits.max.position), "setJointLimits")));
+    }
+
+    if (!base::isUnknown(limits.max.speed) && !std::isinf(limits.max.speed)) {
+        if (limits.max.speed < 0)
+            throw std::invalid_argument("setJointLimits: the maximum speed is negative");
+        messages.push_back(download<MaxMotorSpeed>(narrowToObject<int32_t>(
+            mFactors.userToVelocity(limits.max.speed), "setJointLimits")));
+    }
+
+    int64_t maxCurrent;
+    if (!base::isUnknown(limits.max.effort))
+        maxCurrent = mFactors.userTorqueToCurrent(limits.max.effort);
+    else if (!base::isUnknown(limits.max.raw))
+        maxCurrent = mFactors.userToCurrent(limits.max.raw);
+    else
+        return messages;
+
+    messages.push_back(download<MaxCurrent>(
+        narrowToObject<uint16_t>(maxCurrent, "setJointLimits")));
+    return messages;
+}
+
 struct PDOMapping : canopen_master::PDOMapping
 {
-    template<typename Object>
-    void add()
+    void add(ObjectInfo const& info)
     {
-        canopen_master::PDOMapping::add(
-            Object::OBJECT_ID, Object::OBJECT_SUB_ID, sizeof(typename Object::OBJECT_TYPE));
+        canopen_master::PDOMapping::add(info.objectId, info.objectSubId, info.size);
     }
 };
 
+template<typename Object>
+static void addToLayout(TelemetryLayout::PDO& pdo)
+{
+    TelemetryLayout::Entry entry = { &getObjectInfo<Object>(), pdo.size };
+    pdo.entries.push_back(entry);
+    pdo.size += sizeof(typename Object::OBJECT_TYPE);
+}
+
 vector<canbus::Message> Controller::queryPeriodicJointStateUpdate(
     int pdoIndex, base::Time const& period, uint64_t fields)
 {
@@ -335,36 +748,191 @@ vector<canbus::Message> Controller::queryPeriodicJointStateUpdate(
 {
     // We need two PDOs only if the three fields are reported. If not, need only
     // one
-    PDOMapping mapping0;
-    PDOMapping mapping1;
+    TelemetryLayout layout;
+    layout.pdos.resize(2);
     if (fields == UPDATE_JOINT_STATE) {
-        mapping0.add<PositionActualInternalValue>();
-        mapping0.add<VelocityActualValue>();
-        mapping1.add<CurrentActualValue>();
+        addToLayout<PositionActualInternalValue>(layout.pdos[0]);
+        addToLayout<VelocityActualValue>(layout.pdos[0]);
+        addToLayout<CurrentActualValue>(layout.pdos[1]);
     }
     else {
         if (fields & UPDATE_JOINT_POSITION)
-            mapping0.add<PositionActualInternalValue>();
+            addToLayout<PositionActualInternalValue>(layout.pdos[0]);
         if (fields & UPDATE_JOINT_VELOCITY)
-            mapping0.add<VelocityActualValue>();
+            addToLayout<VelocityActualValue>(layout.pdos[0]);
         if (fields & UPDATE_JOINT_CURRENT)
-            mapping0.add<CurrentActualValue>();
+            addToLayout<CurrentActualValue>(layout.pdos[0]);
+        layout.pdos.pop_back();
     }
+    return configureTPDOs(pdoIndex, parameters, layout, 0);
+}
+
+vector<canbus::Message> Controller::queryPeriodicTelemetryUpdate(
+    int pdoIndex, canopen_master::PDOCommunicationParameters parameters,
+    TelemetryLayout const& layout)
+{
+    return configureTPDOs(pdoIndex, parameters, layout, UPDATE_TELEMETRY);
+}
+
+vector<canbus::Message> Controller::configureTPDOs(
+    int pdoIndex, canopen_master::PDOCommunicationParameters const& parameters,
+    TelemetryLayout const& layout, uint64_t updateId)
+{
+    if (pdoIndex + static_cast<int>(layout.getPDOCount()) > TPDO_COUNT)
+        throw std::invalid_argument("layout requires more TPDOs than available");
 
     vector<canbus::Message> messages;
-    if (!mapping0.empty()) {
-        auto pdo = mCanOpen.configurePDO(true, pdoIndex, parameters, mapping0);
-        mCanOpen.declarePDOMapping(pdoIndex, mapping0);
-        messages.insert(messages.end(), pdo.begin(), pdo.end());
+    for (auto const& pdo : layout.pdos)
+    {
+        if (pdo.entries.empty())
+            continue;
+
+        PDOMapping mapping;
+        PDODecoder decoder;
+        uint64_t* objects = mTPDOObjects[pdoIndex];
+        std::memset(objects, 0, sizeof(mTPDOObjects[pdoIndex]));
+        for (auto const& entry : pdo.entries)
+        {
+            ObjectInfo const& info = *entry.object;
+            mapping.add(info);
+            size_t index = getObjectIndex(info);
+            objects[index / 64] |= static_cast<uint64_t>(1) << (index % 64);
+            decoder.add(info.size,
+                offsetof(DecodedObjects, values) + index * sizeof(uint32_t),
+                info.updateId);
+
+            int sampleOffset = -1;
+            if (index == OBJECT_INDEX_PositionActualInternalValue)
+                sampleOffset = offsetof(JointStateSample, position);
+            else if (index == OBJECT_INDEX_VelocityActualValue)
+                sampleOffset = offsetof(JointStateSample, velocity);
+            else if (index == OBJECT_INDEX_CurrentActualValue)
+                sampleOffset = offsetof(JointStateSample, current);
+            if (sampleOffset >= 0)
+                decoder.addAlias(offsetof(DecodedObjects, jointState) + sampleOffset);
+        }
+        decoder.updateId |= updateId;
+
+        auto pdoMessages = mCanOpen.configurePDO(true, pdoIndex, parameters, mapping);
+        mCanOpen.declarePDOMapping(pdoIndex, mapping);
+        mTPDODecoders[pdoIndex] = decoder;
+        messages.insert(messages.end(), pdoMessages.begin(), pdoMessages.end());
+        ++pdoIndex;
     }
-    if (!mapping1.empty()) {
-        auto pdo = mCanOpen.configurePDO(true, pdoIndex + 1, parameters, mapping1);
-        mCanOpen.declarePDOMapping(pdoIndex + 1, mapping1);
-        messages.insert(messages.end(), pdo.begin(), pdo.end());
+    return messages;
+}
+
+vector<canbus::Message> Controller::queryCyclicCommand(
+    int pdoIndex, OperationMode::Mode mode)
+{
+    if (pdoIndex < 0 || pdoIndex >= RPDO_COUNT)
+        throw std::invalid_argument("invalid RPDO index");
+
+    PDOMapping mapping;
+    mapping.add(getObjectInfo<ControlWordRegister>());
+    switch(mode)
+    {
+        case OperationMode::CYCLIC_SYNCHRONOUS_POSITION:
+            mapping.add(getObjectInfo<TargetPosition>());
+            break;
+        case OperationMode::CYCLIC_SYNCHRONOUS_VELOCITY:
+            mapping.add(getObjectInfo<TargetVelocity>());
+            break;
+        case OperationMode::CYCLIC_SYNCHRONOUS_TORQUE:
+            mapping.add(getObjectInfo<TargetTorque>());
+            break;
+        default:
+            throw std::invalid_argument("queryCyclicCommand: mode is not a cyclic synchronous mode");
     }
+
+    // The drive applies the RPDO content on the next SYNC
+    canopen_master::PDOCommunicationParameters parameters;
+    parameters.transmission_mode = canopen_master::PDO_SYNCHRONOUS;
+    parameters.sync_period = 1;
+
+    vector<canbus::Message> messages =
+        mCanOpen.configurePDO(false, pdoIndex, parameters, mapping);
+    messages.push_back(send(OperationMode(mode)));
+    mCommandPDOIndex = pdoIndex;
+    mCommandMode = mode;
     return messages;
 }
 
+bool Controller::hasCommandPDO() const
+{
+    return mCommandPDOIndex >= 0;
+}
+
+OperationMode::Mode Controller::getCommandMode() const
+{
+    return mCommandMode;
+}
+
+uint64_t Controller::getTPDOUpdateIds() const
+{
+    uint64_t updateIds = 0;
+    for (auto const& decoder : mTPDODecoders)
+        updateIds |= decoder.updateId;
+    return updateIds;
+}
+
+void Controller::setCommandControlWord(ControlWord const& controlWord)
+{
+    mCommandControlWord = encode<ControlWord, uint16_t>(controlWord);
+}
+
+static void writeLittleEndian(uint8_t* buffer, uint32_t value, int size)
+{
+    for (int i = 0; i < size; ++i)
+        buffer[i] = (value >> (8 * i)) & 0xFF;
+}
+
+canbus::Message Controller::commandJoint(base::JointState const& setpoint) const
+{
+    if (mCommandPDOIndex < 0)
+        throw std::logic_error("commandJoint called before queryCyclicCommand");
+
+    canbus::Message msg;
+    msg.can_id = 0x200 + 0x100 * mCommandPDOIndex + mNodeId;
+    writeLittleEndian(msg.data, mCommandControlWord, 2);
+
+    double value;
+    switch(mCommandMode)
+    {
+        case OperationMode::CYCLIC_SYNCHRONOUS_POSITION:
+            value = setpoint.position;
+            break;
+        case OperationMode::CYCLIC_SYNCHRONOUS_VELOCITY:
+            value = setpoint.speed;
+            break;
+        default:
+            value = setpoint.effort;
+    }
+    if (base::isUnknown(value))
+        throw std::invalid_argument("commandJoint: the setpoint field of the current mode is not set");
+    if (!std::isfinite(value))
+        throw std::invalid_argument("commandJoint: the setpoint is not finite");
+
+    if (mCommandMode == OperationMode::CYCLIC_SYNCHRONOUS_TORQUE)
+    {
+        int16_t torque = narrowToObject<int16_t>(
+            mFactors.userTorqueToCurrent(value), "commandJoint");
+        writeLittleEndian(msg.data + 2, static_cast<uint16_t>(torque), 2);
+        msg.size = 4;
+    }
+    else
+    {
+        int64_t converted =
+            mCommandMode == OperationMode::CYCLIC_SYNCHRONOUS_VELOCITY ?
+            mFactors.userToVelocity(value) :
+            mFactors.userToEncoderValue(value);
+        int32_t target = narrowToObject<int32_t>(converted, "commandJoint");
+        writeLittleEndian(msg.data + 2, static_cast<uint32_t>(target), 4);
+        msg.size = 6;
+    }
+    return msg;
+}
+
 canbus::Message Controller::querySave()
 {
     uint8_t buffer[4] = { 's', 'a', 'v', 'e' };
@@ -6,11 +6,20 @@
 #include <motors_elmo_ds402/Update.hpp>
 #include <motors_elmo_ds402/Factors.hpp>
 #include <motors_elmo_ds402/MotorParameters.hpp>
+#include <motors_elmo_ds402/JointStateSample.hpp>
+#include <motors_elmo_ds402/PDODecoder.hpp>
+#include <motors_elmo_ds402/TelemetryLayout.hpp>
+#include <motors_elmo_ds402/Statistics.hpp>
+#include <motors_elmo_ds402/Emergency.hpp>
 #include <base/JointState.hpp>
 #include <base/JointLimitRange.hpp>
+#include <algorithm>
 
 namespace motors_elmo_ds402 {
-    struct HasPendingQuery : public std::runtime_error {};
+    struct HasPendingQuery : public std::runtime_error
+    {
+        using std::runtime_error::runtime_error;
+    };
 
     /** Representation of a controller through the CANOpen protocol
      *
@@ -23,8 +32,18 @@ namespace motors_elmo_ds402 {
         typedef canopen_master::StateMachine StateMachine;
 
     public:
+        /** Number of messages written by queryFactors */
+        static const int FACTORS_QUERY_SIZE = 9;
+        /** Number of messages written by queryJointState */
+        static const int JOINT_STATE_QUERY_SIZE = 3;
+        /** Number of messages written by queryJointLimits */
+        static const int JOINT_LIMITS_QUERY_SIZE = 6;
+
         Controller(uint8_t nodeId);
 
+        /** Returns the CANOpen ID of the node this controller talks to */
+        uint8_t getNodeId() const;
+
         /** Give the motor rated torque
          *
          * This is necessary to use torque commands and status
@@ -55,6 +74,8 @@ namespace motors_elmo_ds402 {
 
         /**
          * Return the last received status word
+         *
+         * @throws canopen_master::ObjectNotRead if it has not been received
          */
         StatusWord getStatusWord() const;
 
@@ -63,6 +84,21 @@ namespace motors_elmo_ds402 {
          */
         std::vector<canbus::Message> queryFactors();
 
+        /** Write the SDO upload queries of queryFactors() to an output
+         * iterator, e.g. a caller-provided array of FACTORS_QUERY_SIZE
+         * messages
+         *
+         * The messages are copied from templates built at construction, this
+         * does not allocate
+         *
+         * @return the iterator past the last written message
+         */
+        template<typename OutputIterator>
+        OutputIterator queryFactors(OutputIterator out) const
+        {
+            return std::copy(mFactorsQuery, mFactorsQuery + FACTORS_QUERY_SIZE, out);
+        }
+
         /**
          * Returns the conversion factor object between Elmo's internal units
          * and physical units
@@ -73,6 +109,25 @@ namespace motors_elmo_ds402 {
          */
         Factors getFactors() const;
 
+        /** Whether the last set of factor objects received from the drive
+         * has a zero term in the position or velocity ratios
+         *
+         * getFactors() then keeps returning the last valid factors until
+         * valid ones are received
+         */
+        bool hasInvalidFactors() const;
+
+        /** Message to query the serial number of the drive, i.e. the
+         * fourth entry of the identity object (0x1018)
+         */
+        canbus::Message querySerialNumber() const;
+
+        /** Return the last received serial number
+         *
+         * @throws canopen_master::ObjectNotRead if it has not been received
+         */
+        uint32_t getSerialNumber() const;
+
         /** Explicitely sets motor parameters
          *
          * The CANOpen objects that store the factors are not saved to non-volatile
@@ -86,6 +141,9 @@ namespace motors_elmo_ds402 {
          * This allows to set the parameters that can't be extracted from the
          * drive, updating the internal factors in the process. One usually
          * wants to read the factors from the drive beforehand with queryFactors().
+         *
+         * @throws std::logic_error if the torque constant is set but the
+         *   rated current has not been received yet
          */
         void setMotorParameters(MotorParameters const& parameters);
 
@@ -94,16 +152,57 @@ namespace motors_elmo_ds402 {
          */
         std::vector<canbus::Message> queryJointState() const;
 
+        /** Write the SDO upload queries of queryJointState() to an output
+         * iterator, without allocating
+         *
+         * @return the iterator past the last written message
+         * @see queryFactors(OutputIterator)
+         */
+        template<typename OutputIterator>
+        OutputIterator queryJointState(OutputIterator out) const
+        {
+            return std::copy(mJointStateQuery, mJointStateQuery + JOINT_STATE_QUERY_SIZE, out);
+        }
+
         /**
-         * Reads the factor objects from the object dictionary and return them
+         * Returns the last received joint state, converted in SI units
+         *
+         * @throws canopen_master::ObjectNotRead if one of the requested fields
+         *   has not been received
          */
         base::JointState getJointState(uint64_t fields = UPDATE_JOINT_STATE) const;
 
+        /** The joint state fields (UPDATE_JOINT_POSITION,
+         * UPDATE_JOINT_VELOCITY and UPDATE_JOINT_CURRENT) that have been
+         * received, i.e. that getJointState can return
+         */
+        uint64_t getJointStateFields() const;
+
+        /**
+         * Returns the last received joint state, in the drive's internal units
+         *
+         * It is updated both by the SDOs sent by queryJointState and by the
+         * PDOs configured by queryPeriodicJointStateUpdate
+         */
+        JointStateSample const& getJointStateSample() const;
+
         /** Returns the set of SDO upload queries that allow
          * to get the current joint limits
          */
         std::vector<canbus::Message> queryJointLimits() const;
 
+        /** Write the SDO upload queries of queryJointLimits() to an output
+         * iterator, without allocating
+         *
+         * @return the iterator past the last written message
+         * @see queryFactors(OutputIterator)
+         */
+        template<typename OutputIterator>
+        OutputIterator queryJointLimits(OutputIterator out) const
+        {
+            return std::copy(mJointLimitsQuery, mJointLimitsQuery + JOINT_LIMITS_QUERY_SIZE, out);
+        }
+
         /**
          * Reads the joint limits from the object dictionary and return them
          */
@@ -112,11 +211,19 @@ namespace motors_elmo_ds402 {
         /**
          * Sets the joint limits and return the set of messages necessary to
          * change them on the drive
+         *
+         * @throws std::invalid_argument if only one of the position limits
+         *   is infinite, if the maximum speed is negative, or if a limit
+         *   does not fit in its object once converted
          */
         std::vector<canbus::Message> setJointLimits(base::JointLimitRange const& limits);
 
         /**
          * Configure the controller to periodically send joint state information
+         *
+         * The PDOs configured this way (pdoIndex and, if all joint state
+         * fields are requested, pdoIndex + 1) are decoded straight into the
+         * joint state sample by process(), bypassing the object dictionary.
          */
         std::vector<canbus::Message> queryPeriodicJointStateUpdate(
             int pdoIndex, canopen_master::PDOCommunicationParameters, uint64_t fields);
@@ -129,6 +236,91 @@ namespace motors_elmo_ds402 {
         std::vector<canbus::Message> queryPeriodicJointStateUpdate(
             int pdoIndex, int syncPeriod, uint64_t fields = UPDATE_JOINT_STATE);
 
+        /**
+         * Configure the controller to periodically send a set of objects
+         *
+         * The PDOs, starting at pdoIndex, are configured following the
+         * given layout (see packTelemetry). The received PDOs are decoded
+         * straight into the values returned by getTelemetry, and into the
+         * joint state sample for the joint state objects. They report
+         * UPDATE_TELEMETRY in addition to the UPDATE_ID of the mapped objects.
+         */
+        std::vector<canbus::Message> queryPeriodicTelemetryUpdate(
+            int pdoIndex, canopen_master::PDOCommunicationParameters parameters,
+            TelemetryLayout const& layout);
+
+        /**
+         * Returns the last received raw value of an object
+         *
+         * It is updated by both SDO uploads and the PDOs configured with
+         * queryPeriodicTelemetryUpdate, and by EMCY frames for ErrorCode
+         * and ErrorRegister. It is zero if the object has not been
+         * received yet, see hasTelemetry.
+         */
+        template<typename T>
+        typename T::OBJECT_TYPE getTelemetry() const
+        {
+            typename T::OBJECT_TYPE value;
+            std::memcpy(&value, &mDecoded.values[ObjectIndex<T>::value], sizeof(value));
+            return value;
+        }
+
+        /** Whether a value of the object has been received, by any of the
+         * means listed in getTelemetry
+         */
+        template<typename T>
+        bool hasTelemetry() const
+        {
+            return isReceived(ObjectIndex<T>::value);
+        }
+
+        /** @overload */
+        bool hasTelemetry(ObjectInfo const& info) const;
+
+        /**
+         * Configure a RPDO to command the drive in a cyclic synchronous mode,
+         * and switch the drive to that mode
+         *
+         * The RPDO maps the control word and the target object of the mode
+         * (TargetPosition, TargetVelocity or TargetTorque). Setpoints are
+         * then encoded with commandJoint, and applied by the drive on the
+         * SYNC that follows their reception.
+         *
+         * @param mode one of the CYCLIC_SYNCHRONOUS_ modes
+         */
+        std::vector<canbus::Message> queryCyclicCommand(
+            int pdoIndex, OperationMode::Mode mode);
+
+        /** Whether queryCyclicCommand has configured a command RPDO */
+        bool hasCommandPDO() const;
+
+        /** The mode given to the last call to queryCyclicCommand */
+        OperationMode::Mode getCommandMode() const;
+
+        /** Update IDs reported by the TPDOs whose mapping is known, i.e.
+         * the ones configured through this controller
+         */
+        uint64_t getTPDOUpdateIds() const;
+
+        /**
+         * Sets the control word that commandJoint sends along the setpoints
+         *
+         * It is ENABLE_OPERATION by default
+         */
+        void setCommandControlWord(ControlWord const& controlWord);
+
+        /**
+         * Encode a setpoint into the RPDO configured by queryCyclicCommand
+         *
+         * Depending on the mode, the position, speed or effort field of the
+         * setpoint is used. This does not allocate.
+         *
+         * @throws std::logic_error if queryCyclicCommand has not been called
+         * @throws std::invalid_argument if the mode's field is not set, or
+         *   if it does not fit in the target object once converted
+         */
+        canbus::Message commandJoint(base::JointState const& setpoint) const;
+
         template<typename T>
         canbus::Message send(T const& object)
         {
@@ -140,6 +332,72 @@ namespace motors_elmo_ds402 {
          */
         Update process(canbus::Message const& msg);
 
+        /** Tell the controller that a SYNC has been sent at the given time
+         *
+         * It is used to measure the latency between SYNCs and TPDOs, based
+         * on the time field of the received TPDOs
+         */
+        void notifySync(base::Time const& time);
+
+        /** Record the round-trip time of an SDO transfer with this node
+         *
+         * The controller does not know when queries are sent, the
+         * round-trip is measured by the SDOScheduler (see
+         * SDOResult::roundTrip)
+         */
+        void recordSDORoundTrip(base::Time const& roundTrip);
+
+        /** Instrumentation of this controller
+         *
+         * It is updated by process(), and can be snapshotted from another
+         * thread. The processing time is sampled on one call out of 16.
+         */
+        ControllerStatistics const& getStatistics() const;
+
+        /** Reset the instrumentation. Must be called from the thread that
+         * calls process()
+         */
+        void clearStatistics();
+
+        /** The last emergencies received from the drive
+         *
+         * process() decodes the EMCY frames into this history, reports
+         * UPDATE_EMERGENCY and updates the ErrorCode and ErrorRegister
+         * values returned by getTelemetry
+         */
+        EmergencyHistory const& getEmergencies() const;
+
+        /** Clear the history returned by getEmergencies */
+        void clearEmergencies();
+
+        /** SDO upload of an object of the registry */
+        canbus::Message queryRawObject(ObjectInfo const& info) const;
+
+        /** SDO download of a raw value into an object of the registry
+         *
+         * Only the low bytes of value are sent for objects smaller than 32
+         * bits
+         */
+        canbus::Message sendRawObject(ObjectInfo const& info, uint32_t value) const;
+
+        /** Read the last received raw value of an object of the registry
+         *
+         * Values smaller than 32 bits are zero-extended
+         *
+         * @return false if the object has not been received yet
+         */
+        bool getRawObject(ObjectInfo const& info, uint32_t& value) const;
+
+        /** Set the raw value of an object of the registry as if it had been
+         * uploaded from the drive, e.g. to restore it from a cache
+         *
+         * The value goes through the same processing as an SDO upload, in
+         * particular it updates the factors.
+         *
+         * @return the update the object's upload would have reported
+         */
+        Update setRawObject(ObjectInfo const& info, uint32_t value);
+
         /** Save configuration to non-volatile memory */
         canbus::Message querySave();
 
@@ -147,14 +405,141 @@ namespace motors_elmo_ds402 {
         canbus::Message queryLoad();
 
     private:
+        uint8_t mNodeId;
         StateMachine mCanOpen;
         double mRatedTorque;
         Factors mFactors;
 
-        Factors computeFactors() const;
+        /** Factor inputs received so far
+         *
+         * It is copied into mFactors once all of them have been received, as
+         * flagged by mFactorsReady
+         */
+        Factors mFactorsInput;
+        /** Bitmask of the factor inputs that have been received so far */
+        uint32_t mFactorsReady;
+        /** Whether mFactorsInput was rejected by the last updateFactors */
+        bool mFactorsInvalid;
+
+        /** Target of the TPDO decoders
+         *
+         * values[i] holds the value of the i-th object of OBJECT_REGISTRY.
+         * Objects smaller than 4 bytes use the first bytes of their cell.
+         */
+        struct DecodedObjects
+        {
+            JointStateSample jointState;
+            uint32_t values[OBJECT_COUNT];
+
+            DecodedObjects()
+                : values() {}
+        };
+        DecodedObjects mDecoded;
+
+        static const int TPDO_COUNT = 4;
+        static const int RPDO_COUNT = 4;
+
+        /** Number of words of the bitsets of received objects, bit i being
+         * the i-th object of OBJECT_REGISTRY
+         */
+        static const int RECEIVED_WORDS = (OBJECT_COUNT + 63) / 64;
+        /** Objects whose value has been received */
+        uint64_t mReceived[RECEIVED_WORDS];
+        /** Objects mapped by each TPDO whose mapping is known */
+        uint64_t mTPDOObjects[TPDO_COUNT][RECEIVED_WORDS];
+
+        bool isReceived(size_t index) const
+        {
+            return mReceived[index / 64] & (static_cast<uint64_t>(1) << (index % 64));
+        }
+        void markReceived(size_t index);
+
+        /** The RPDO configured by queryCyclicCommand, or -1 */
+        int mCommandPDOIndex;
+        OperationMode::Mode mCommandMode;
+        uint16_t mCommandControlWord;
+
+        /** Fast decoders for the TPDOs whose mapping is known */
+        PDODecoder mTPDODecoders[TPDO_COUNT];
+
+        ControllerStatistics mStatistics;
+        EmergencyHistory mEmergencies;
+        /** process() measures its own duration once every
+         * PROCESS_TIME_SAMPLING calls, as reading the clock costs more than
+         * decoding a TPDO
+         */
+        static const int PROCESS_TIME_SAMPLING = 16;
+        uint32_t mProcessCount;
+        /** Time of the last SYNC, as given to notifySync */
+        base::Time mLastSync;
+        /** Reception time of the last frame of each TPDO */
+        base::Time mLastTPDOTime[TPDO_COUNT];
+        /** Last inter-arrival time of each TPDO, or -1 if unknown */
+        int64_t mLastTPDOInterval[TPDO_COUNT];
+
+        /** Frame templates of the polling queries, built once in the
+         * constructor
+         */
+        canbus::Message mFactorsQuery[FACTORS_QUERY_SIZE];
+        canbus::Message mJointStateQuery[JOINT_STATE_QUERY_SIZE];
+        canbus::Message mJointLimitsQuery[JOINT_LIMITS_QUERY_SIZE];
+
+        /** Returns the index of the TPDO of this node that has the given
+         * COB-ID, or -1 if it is not one
+         */
+        int getTPDOIndex(uint32_t cobId) const;
+
+        /** Implementation of process(), without the instrumentation of the
+         * processing time
+         */
+        Update processFrame(canbus::Message const& msg, FRAME_TYPE& type);
+
+        /** Decode an EMCY frame of this node */
+        Update processEmergency(canbus::Message const& msg);
+
+        /** Update the TPDO timing statistics with a received TPDO */
+        void recordTPDOTiming(int pdoIndex, base::Time const& time);
+
+        /** Configure the TPDOs following the given layout, and setup the
+         * matching decoders
+         *
+         * @param updateId update flags reported in addition to the ones of
+         *   the mapped objects
+         */
+        std::vector<canbus::Message> configureTPDOs(
+            int pdoIndex, canopen_master::PDOCommunicationParameters const& parameters,
+            TelemetryLayout const& layout, uint64_t updateId);
+
+        /** Process an object that has just been written to the object
+         * dictionary
+         *
+         * @return true if it changed one of the factor inputs, in which case
+         *   updateFactors must be called
+         */
+        bool updateFromDictionary(ObjectInfo const& info);
+
+        /** Update the joint state sample with the object of the given full
+         * ID from the object dictionary
+         */
+        void updateJointStateSample(uint32_t fullId);
+
+        /** Copy the value of an object from the object dictionary into
+         * mDecoded.values
+         */
+        void updateObjectValue(ObjectInfo const& info);
+
+        /** Update mFactorsInput with the object of the given full ID
+         *
+         * Returns false if the object is not a factor input
+         */
+        bool updateFactorInput(uint32_t fullId);
+        /** Recompute mFactors if all factor inputs have been received */
+        void updateFactors();
 
         template<typename T>
         canbus::Message queryObject() const;
+        template<typename T>
+        canbus::Message download(typename T::OBJECT_TYPE value) const;
         template<typename T> T get() const;
         template<typename T> typename T::OBJECT_TYPE getRaw() const;
         template<typename T> void setRaw(typename T::OBJECT_TYPE value);
@@ -0,0 +1,159 @@
+#include <motors_elmo_ds402/CycleAggregator.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+CycleAggregator::CycleAggregator(BusController const& bus, base::Time const& deadline)
+    : mBus(bus)
+    , mDeadline(deadline)
+    , mOutstanding(0)
+    , mInCycle(false)
+    , mCycleIndex(0)
+{
+    for (int i = 0; i < BusUpdate::MAX_NODES; ++i)
+        mSlots[i] = NO_SLOT;
+}
+
+void CycleAggregator::expect(uint8_t nodeId, uint64_t updateId)
+{
+    if (!mBus.has(nodeId))
+        throw std::invalid_argument("CycleAggregator::expect: node not registered on the bus");
+    if (!updateId)
+        throw std::invalid_argument("CycleAggregator::expect: no update expected");
+    if (mInCycle)
+        throw std::logic_error("CycleAggregator::expect: called during a cycle");
+
+    uint8_t slot = mSlots[nodeId];
+    if (slot != NO_SLOT)
+    {
+        mExpected[slot] = updateId;
+        return;
+    }
+
+    mSlots[nodeId] = mExpected.size();
+    mExpected.push_back(updateId);
+    mRemaining.push_back(0);
+    mReceived.push_back(base::Time());
+
+    CycleAxis axis;
+    axis.nodeId = nodeId;
+    mFrame.axes.push_back(axis);
+}
+
+CYCLE_STATUS CycleAggregator::sync(base::Time const& time)
+{
+    CYCLE_STATUS result = CYCLE_PENDING;
+    if (mInCycle)
+    {
+        close(time);
+        result = CYCLE_INCOMPLETE;
+    }
+
+    for (size_t i = 0; i < mExpected.size(); ++i)
+    {
+        mRemaining[i] = mExpected[i];
+        mReceived[i] = base::Time();
+    }
+    mOutstanding = mExpected.size();
+    mSyncTime = time;
+    mCycleIndex++;
+    mInCycle = true;
+    return result;
+}
+
+CYCLE_STATUS CycleAggregator::process(NodeUpdate const& update, base::Time const& time)
+{
+    if (!update.isValid())
+        return getStatus();
+    uint8_t slot = mSlots[update.nodeId & 0x7F];
+    if (slot == NO_SLOT)
+        return getStatus();
+
+    uint64_t updated = update.update.getUpdatedObjects();
+    if (!mInCycle)
+    {
+        // mRemaining still holds what was missing when the last cycle was
+        // closed
+        if (mRemaining[slot] & updated)
+        {
+            mRemaining[slot] = 0;
+            mStatistics.lateFrames++;
+        }
+        return CYCLE_IDLE;
+    }
+
+    uint64_t& remaining = mRemaining[slot];
+    if (!(remaining & updated))
+        return CYCLE_PENDING;
+
+    remaining &= ~updated;
+    if (remaining)
+        return CYCLE_PENDING;
+
+    mReceived[slot] = time;
+    if (--mOutstanding)
+        return CYCLE_PENDING;
+
+    close(time);
+    return CYCLE_COMPLETE;
+}
+
+CYCLE_STATUS CycleAggregator::checkDeadline(base::Time const& now)
+{
+    if (!mInCycle)
+        return CYCLE_IDLE;
+    if (now < getDeadline())
+        return CYCLE_PENDING;
+
+    close(now);
+    return CYCLE_INCOMPLETE;
+}
+
+CYCLE_STATUS CycleAggregator::getStatus() const
+{
+    return mInCycle ? CYCLE_PENDING : CYCLE_IDLE;
+}
+
+base::Time CycleAggregator::getDeadline() const
+{
+    if (!mInCycle)
+        return base::Time();
+    return mSyncTime + mDeadline;
+}
+
+CycleFrame const& CycleAggregator::getFrame() const
+{
+    return mFrame;
+}
+
+CycleStatistics const& CycleAggregator::getStatistics() const
+{
+    return mStatistics;
+}
+
+void CycleAggregator::close(base::Time const& time)
+{
+    mInCycle = false;
+    mFrame.index = mCycleIndex;
+    mFrame.sync = mSyncTime;
+    mFrame.end = time;
+    mFrame.complete = (mOutstanding == 0);
+    mFrame.missing = mOutstanding;
+
+    for (size_t i = 0; i < mFrame.axes.size(); ++i)
+    {
+        CycleAxis& axis = mFrame.axes[i];
+        axis.received = !mRemaining[i];
+        axis.time = mReceived[i];
+        Controller const& controller = mBus.get(axis.nodeId);
+        axis.jointState = controller.getJointState(controller.getJointStateFields());
+    }
+
+    if (mFrame.complete)
+        mStatistics.complete++;
+    else
+    {
+        mStatistics.incomplete++;
+        mStatistics.missingFrames += mOutstanding;
+    }
+}
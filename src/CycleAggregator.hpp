@@ -0,0 +1,180 @@
+#ifndef MOTORS_ELMO_DS402_CYCLE_AGGREGATOR_HPP
+#define MOTORS_ELMO_DS402_CYCLE_AGGREGATOR_HPP
+
+#include <vector>
+#include <base/Time.hpp>
+#include <base/JointState.hpp>
+#include <motors_elmo_ds402/BusController.hpp>
+
+namespace motors_elmo_ds402 {
+    /** State of one axis within a CycleFrame */
+    struct CycleAxis
+    {
+        uint8_t nodeId;
+        /** Whether all the expected updates of this axis were received
+         * during the cycle. If false, jointState is the last known state
+         */
+        bool received;
+        /** Reception time of the last expected update of the axis */
+        base::Time time;
+        /** Fields that have never been received are left unknown */
+        base::JointState jointState;
+
+        CycleAxis()
+            : nodeId(0)
+            , received(false) {}
+    };
+
+    /** Coherent set of the states of all the axes for one SYNC */
+    struct CycleFrame
+    {
+        /** Index of the cycle, incremented on each SYNC */
+        uint64_t index;
+        /** Time of the SYNC that started the cycle */
+        base::Time sync;
+        /** Time at which the cycle was closed, i.e. the arrival time of
+         * its last expected update or the time the deadline was detected
+         */
+        base::Time end;
+        /** Whether all the expected updates arrived before the deadline */
+        bool complete;
+        /** Number of axes whose updates did not arrive */
+        size_t missing;
+        /** The axes, in the order they were passed to expect() */
+        std::vector<CycleAxis> axes;
+
+        CycleFrame()
+            : index(0)
+            , complete(false)
+            , missing(0) {}
+    };
+
+    /** Counters of a CycleAggregator */
+    struct CycleStatistics
+    {
+        uint64_t complete;
+        uint64_t incomplete;
+        /** Number of axis updates missing when a cycle was closed */
+        uint64_t missingFrames;
+        /** Number of missing axis updates that arrived after their cycle was
+         * closed
+         */
+        uint64_t lateFrames;
+
+        CycleStatistics()
+            : complete(0)
+            , incomplete(0)
+            , missingFrames(0)
+            , lateFrames(0) {}
+    };
+
+    enum CYCLE_STATUS
+    {
+        /** No cycle is in progress */
+        CYCLE_IDLE,
+        /** A cycle is in progress, some updates are still expected */
+        CYCLE_PENDING,
+        /** The cycle has just been completed */
+        CYCLE_COMPLETE,
+        /** The cycle has just been closed with some updates missing */
+        CYCLE_INCOMPLETE
+    };
+
+    /** Detection of the moment all the axes of a bus have answered a SYNC
+     *
+     * Declare with expect() which updates each node sends on every SYNC
+     * (usually the joint state of its SYNC-triggered TPDO). Call sync()
+     * when writing the SYNC, then pass it the result of
+     * BusController::process for every received frame. The cycle is
+     * closed as soon as the last expected update arrives, not on a
+     * timeout. The states of all the axes are then available as one
+     * timestamped frame through getFrame().
+     *
+     * If the deadline passes first - as detected by checkDeadline() or by
+     * the next sync() - the cycle is closed as incomplete and the missing
+     * axes are flagged. Their updates are counted as late if they arrive
+     * before the next SYNC.
+     *
+     * The aggregator does not allocate once all the nodes have been
+     * declared.
+     */
+    class CycleAggregator
+    {
+    public:
+        /**
+         * @param deadline time after the SYNC by which all the expected
+         *   updates should have arrived
+         */
+        CycleAggregator(BusController const& bus, base::Time const& deadline);
+
+        /** Declare the updates a node sends on each SYNC
+         *
+         * @throws std::invalid_argument if the node is not registered on the
+         *   bus, or if updateId is zero
+         * @throws std::logic_error if a cycle is in progress
+         */
+        void expect(uint8_t nodeId, uint64_t updateId = UPDATE_JOINT_STATE);
+
+        /** Start a new cycle
+         *
+         * If the previous cycle was still pending, it is first closed as
+         * incomplete
+         *
+         * @return CYCLE_INCOMPLETE if the previous cycle had to be closed,
+         *   CYCLE_PENDING otherwise
+         */
+        CYCLE_STATUS sync(base::Time const& time);
+
+        /** Account for an update returned by BusController::process
+         *
+         * @param time the reception time of the frame
+         * @return CYCLE_COMPLETE if this update completed the cycle, the
+         *   current status otherwise
+         */
+        CYCLE_STATUS process(NodeUpdate const& update, base::Time const& time);
+
+        /** Close the current cycle if its deadline has passed
+         *
+         * @return CYCLE_INCOMPLETE if the cycle has just been closed, the
+         *   current status otherwise
+         */
+        CYCLE_STATUS checkDeadline(base::Time const& now);
+
+        /** Current status: CYCLE_PENDING while a cycle is in progress,
+         * CYCLE_IDLE otherwise
+         */
+        CYCLE_STATUS getStatus() const;
+
+        /** Deadline of the current cycle, or a null time if none is in
+         * progress
+         */
+        base::Time getDeadline() const;
+
+        /** The last closed cycle */
+        CycleFrame const& getFrame() const;
+
+        CycleStatistics const& getStatistics() const;
+
+    private:
+        static const uint8_t NO_SLOT = 0xFF;
+
+        BusController const& mBus;
+        base::Time mDeadline;
+        uint8_t mSlots[BusUpdate::MAX_NODES];
+        std::vector<uint64_t> mExpected;
+        /** Expected updates not yet received in the current cycle */
+        std::vector<uint64_t> mRemaining;
+        std::vector<base::Time> mReceived;
+        size_t mOutstanding;
+        bool mInCycle;
+        base::Time mSyncTime;
+        uint64_t mCycleIndex;
+
+        CycleFrame mFrame;
+        CycleStatistics mStatistics;
+
+        void close(base::Time const& time);
+    };
+}
+
+#endif
@@ -0,0 +1,72 @@
+#include <motors_elmo_ds402/Emergency.hpp>
+#include <cstring>
+#include <stdexcept>
+
+using namespace motors_elmo_ds402;
+
+static const uint32_t EMCY_COB_ID = 0x080;
+
+uint8_t Emergency::getNodeId(canbus::Message const& msg)
+{
+    // 0x080 itself is the SYNC
+    if ((msg.can_id & 0x780) != EMCY_COB_ID)
+        return 0;
+    return msg.can_id & 0x7F;
+}
+
+Emergency Emergency::parse(canbus::Message const& msg)
+{
+    if (msg.size != 8)
+        throw std::invalid_argument("EMCY frames must be 8 bytes long");
+
+    Emergency emergency;
+    emergency.errorCode = static_cast<uint16_t>(msg.data[0]) |
+        static_cast<uint16_t>(msg.data[1]) << 8;
+    emergency.errorRegister = msg.data[2];
+    std::memcpy(emergency.data, msg.data + 3, 5);
+    emergency.time = msg.time;
+    return emergency;
+}
+
+EmergencyHistory::EmergencyHistory()
+    : mCount(0)
+{
+}
+
+void EmergencyHistory::push(Emergency const& emergency)
+{
+    mEntries[mCount % CAPACITY] = emergency;
+    ++mCount;
+}
+
+int EmergencyHistory::size() const
+{
+    return mCount < CAPACITY ? mCount : CAPACITY;
+}
+
+bool EmergencyHistory::empty() const
+{
+    return mCount == 0;
+}
+
+Emergency const& EmergencyHistory::get(int i) const
+{
+    if (i < 0 || i >= size())
+        throw std::out_of_range("EmergencyHistory::get: index out of range");
+    return mEntries[(mCount - 1 - i) % CAPACITY];
+}
+
+Emergency const& EmergencyHistory::getLast() const
+{
+    return get(0);
+}
+
+uint64_t EmergencyHistory::getTotalCount() const
+{
+    return mCount;
+}
+
+void EmergencyHistory::clear()
+{
+    mCount = 0;
+}
@@ -0,0 +1,90 @@
+#ifndef MOTORS_ELMO_DS402_EMERGENCY_HPP
+#define MOTORS_ELMO_DS402_EMERGENCY_HPP
+
+#include <cstdint>
+#include <base/Time.hpp>
+#include <canbus/Message.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Content of an emergency (EMCY) frame
+     */
+    struct Emergency
+    {
+        /** Error code, as in ErrorCode (0x603F). Zero when the drive
+         * signals that its errors have been cleared
+         */
+        uint16_t errorCode;
+        /** Error register, as in ErrorRegister (0x1001) */
+        uint8_t errorRegister;
+        /** Manufacturer-specific bytes */
+        uint8_t data[5];
+        /** Reception time of the frame */
+        base::Time time;
+
+        Emergency()
+            : errorCode(0)
+            , errorRegister(0)
+            , data() {}
+
+        /** Whether this is the "error reset" emergency, sent when the drive
+         * leaves its error state
+         */
+        bool isErrorReset() const { return errorCode == 0; }
+
+        /** Returns the node ID of an EMCY frame, or zero if the frame is
+         * not one
+         */
+        static uint8_t getNodeId(canbus::Message const& msg);
+
+        /** Decode an EMCY frame
+         *
+         * @throws std::invalid_argument if the frame is not 8 bytes long
+         */
+        static Emergency parse(canbus::Message const& msg);
+    };
+
+    /** The last emergencies received from a node
+     *
+     * It keeps a fixed number of entries, the oldest being overwritten.
+     * Adding an emergency does not allocate.
+     */
+    class EmergencyHistory
+    {
+    public:
+        static const int CAPACITY = 8;
+
+        EmergencyHistory();
+
+        void push(Emergency const& emergency);
+
+        /** Number of emergencies held, at most CAPACITY */
+        int size() const;
+
+        bool empty() const;
+
+        /** Returns an emergency, zero being the most recent one
+         *
+         * @throws std::out_of_range if i is not below size()
+         */
+        Emergency const& get(int i) const;
+
+        /** The most recent emergency
+         *
+         * @throws std::out_of_range if there are none
+         */
+        Emergency const& getLast() const;
+
+        /** Number of emergencies received since construction or the last
+         * clear(), including the ones that have been overwritten
+         */
+        uint64_t getTotalCount() const;
+
+        void clear();
+
+    private:
+        Emergency mEntries[CAPACITY];
+        uint64_t mCount;
+    };
+}
+
+#endif
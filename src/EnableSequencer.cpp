@@ -0,0 +1,247 @@
+#include <motors_elmo_ds402/EnableSequencer.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+EnableSequencer::EnableSequencer(BusController& bus, Configuration const& configuration)
+    : mBus(bus)
+    , mConfiguration(configuration)
+    , mScheduler(configuration.sdoTimeout)
+    , mPendingCount(0)
+{
+}
+
+void EnableSequencer::enable(uint8_t nodeId, base::Time const& now)
+{
+    start(nodeId, true, now);
+}
+
+void EnableSequencer::disable(uint8_t nodeId, base::Time const& now)
+{
+    start(nodeId, false, now);
+}
+
+void EnableSequencer::start(uint8_t nodeId, bool enable, base::Time const& now)
+{
+    if (!mBus.has(nodeId))
+        throw std::invalid_argument("EnableSequencer: node is not on the bus");
+
+    Controller const& controller = mBus.get(nodeId);
+    uint64_t tpdoUpdates = controller.getTPDOUpdateIds();
+    bool holdsPosition =
+        controller.getCommandMode() != OperationMode::CYCLIC_SYNCHRONOUS_POSITION ||
+        (tpdoUpdates & UPDATE_JOINT_POSITION);
+
+    Node& node = mNodes[nodeId];
+    if (!node.started)
+        mOrder.push_back(nodeId);
+    if (node.result.status != ENABLE_PENDING || !node.started)
+        ++mPendingCount;
+
+    bool sdoBusy = node.sdoBusy;
+    node = Node();
+    node.started = true;
+    node.enable = enable;
+    node.usePDO = controller.hasCommandPDO() &&
+        (tpdoUpdates & UPDATE_STATUS_WORD) && holdsPosition;
+    node.sdoBusy = sdoBusy;
+    node.start = now;
+    node.result.nodeId = nodeId;
+    node.result.usedPDO = node.usePDO;
+}
+
+bool EnableSequencer::evaluate(Node& node, Controller const& controller,
+    base::Time const& now, ControlWord::Transition& transition)
+{
+    StatusWord::State state = controller.getStatusWord().state;
+    if (state == StatusWord::FAULT || state == StatusWord::FAULT_REACTION_ACTIVE)
+    {
+        finish(node, ENABLE_FAULT, now);
+        return false;
+    }
+
+    if (node.enable)
+    {
+        switch(state)
+        {
+            case StatusWord::OPERATION_ENABLED:
+                finish(node, ENABLE_DONE, now);
+                return false;
+            case StatusWord::SWITCH_ON:
+                transition = ControlWord::ENABLE_OPERATION;
+                break;
+            case StatusWord::READY_TO_SWITCH_ON:
+                transition = ControlWord::SWITCH_ON;
+                break;
+            case StatusWord::QUICK_STOP_ACTIVE:
+                transition = ControlWord::DISABLE_VOLTAGE;
+                break;
+            default:
+                // SWITCH_ON_DISABLED, and NOT_READY_TO_SWITCH_ON which
+                // moves to SWITCH_ON_DISABLED on its own
+                transition = ControlWord::SHUTDOWN;
+        }
+    }
+    else
+    {
+        if (state == StatusWord::SWITCH_ON_DISABLED)
+        {
+            finish(node, ENABLE_DONE, now);
+            return false;
+        }
+        transition = ControlWord::DISABLE_VOLTAGE;
+    }
+    return true;
+}
+
+void EnableSequencer::finish(Node& node, ENABLE_STATUS status, base::Time const& now)
+{
+    node.result.status = status;
+    node.result.duration = now - node.start;
+    --mPendingCount;
+}
+
+vector<canbus::Message> EnableSequencer::poll(base::Time const& now)
+{
+    // Nodes whose status word query failed go back to idle, they will be
+    // retried until the global timeout. A failed control word download is
+    // still followed by its status word query
+    for (auto const& failure : mScheduler.getFailures())
+    {
+        if (failure.objectId == StatusWordRegister::OBJECT_ID)
+            mNodes[failure.nodeId].sdoBusy = false;
+    }
+    mScheduler.clearFailures();
+
+    vector<canbus::Message> messages;
+    for (uint8_t nodeId : mOrder)
+    {
+        Node& node = mNodes[nodeId];
+        if (node.result.status != ENABLE_PENDING)
+            continue;
+        if (!(now - node.start < mConfiguration.timeout))
+        {
+            finish(node, ENABLE_TIMED_OUT, now);
+            continue;
+        }
+
+        Controller& controller = mBus.get(nodeId);
+        if (node.usePDO)
+        {
+            // Wait for the TPDOs to report the current state. Only CSP
+            // needs the position, to hold it. CSV and CST hold with a zero
+            // target
+            bool needsPosition =
+                controller.getCommandMode() == OperationMode::CYCLIC_SYNCHRONOUS_POSITION;
+            ControlWord::Transition transition;
+            if (!node.statusReceived ||
+                (needsPosition &&
+                 !(controller.getJointStateFields() & UPDATE_JOINT_POSITION)) ||
+                !evaluate(node, controller, now, transition))
+                continue;
+            if (node.lastTransition == transition &&
+                now - node.lastSent < mConfiguration.retransmitPeriod)
+                continue;
+
+            base::JointState hold;
+            if (needsPosition)
+                hold.position = controller.getJointState(UPDATE_JOINT_POSITION).position;
+            hold.speed = 0;
+            hold.effort = 0;
+            controller.setCommandControlWord(ControlWord(transition, false));
+            messages.push_back(controller.commandJoint(hold));
+            node.lastTransition = transition;
+            node.lastSent = now;
+        }
+        else if (!node.sdoBusy)
+        {
+            ControlWord::Transition transition;
+            if (node.statusReceived)
+            {
+                if (!evaluate(node, controller, now, transition))
+                    continue;
+                if (node.lastTransition != transition ||
+                    !(now - node.lastSent < mConfiguration.retransmitPeriod))
+                {
+                    mScheduler.push(controller.send(ControlWord(transition, false)));
+                    node.lastTransition = transition;
+                    node.lastSent = now;
+                }
+            }
+            mScheduler.push(controller.queryStatusWord());
+            node.sdoBusy = true;
+        }
+    }
+
+    vector<canbus::Message> sdos = mScheduler.poll(now);
+    messages.insert(messages.end(), sdos.begin(), sdos.end());
+    return messages;
+}
+
+NodeUpdate EnableSequencer::process(canbus::Message const& msg, base::Time const& now)
+{
+    NodeUpdate update = mBus.process(msg);
+    SDOResult result = mScheduler.process(msg, now);
+    if (result.isValid() && result.objectId == StatusWordRegister::OBJECT_ID)
+        mNodes[result.nodeId].sdoBusy = false;
+
+    if (!update.isValid())
+        return update;
+
+    Node& node = mNodes[update.nodeId];
+    if (node.result.status != ENABLE_PENDING || !node.started)
+        return update;
+
+    if (update.update.isUpdated(UPDATE_STATUS_WORD))
+    {
+        node.statusReceived = true;
+        // Detect the end of the sequence as soon as the status word arrives,
+        // poll() sends the next transition
+        ControlWord::Transition transition;
+        evaluate(node, mBus.get(update.nodeId), now, transition);
+    }
+    return update;
+}
+
+bool EnableSequencer::isDone() const
+{
+    return mPendingCount == 0;
+}
+
+base::Time EnableSequencer::getNextDeadline() const
+{
+    if (isDone())
+        return base::Time();
+
+    base::Time deadline = mScheduler.getNextDeadline();
+    for (uint8_t nodeId : mOrder)
+    {
+        Node const& node = mNodes[nodeId];
+        if (node.result.status != ENABLE_PENDING)
+            continue;
+
+        base::Time nodeDeadline = node.start + mConfiguration.timeout;
+        if (node.lastTransition >= 0)
+        {
+            base::Time retransmit = node.lastSent + mConfiguration.retransmitPeriod;
+            if (retransmit < nodeDeadline)
+                nodeDeadline = retransmit;
+        }
+        if (deadline.isNull() || nodeDeadline < deadline)
+            deadline = nodeDeadline;
+    }
+    return deadline;
+}
+
+vector<EnableResult> EnableSequencer::getResults() const
+{
+    vector<EnableResult> results;
+    for (uint8_t nodeId : mOrder)
+        results.push_back(mNodes[nodeId].result);
+    return results;
+}
+
+EnableResult EnableSequencer::getResult(uint8_t nodeId) const
+{
+    return mNodes[nodeId].result;
+}
@@ -0,0 +1,175 @@
+#ifndef MOTORS_ELMO_DS402_ENABLE_SEQUENCER_HPP
+#define MOTORS_ELMO_DS402_ENABLE_SEQUENCER_HPP
+
+#include <vector>
+#include <motors_elmo_ds402/BusController.hpp>
+#include <motors_elmo_ds402/SDOScheduler.hpp>
+
+namespace motors_elmo_ds402 {
+    enum ENABLE_STATUS
+    {
+        /** The sequence is in progress */
+        ENABLE_PENDING,
+        /** The drive reached the requested state */
+        ENABLE_DONE,
+        /** The drive did not reach the requested state within the timeout */
+        ENABLE_TIMED_OUT,
+        /** The drive went into fault during the sequence */
+        ENABLE_FAULT
+    };
+
+    /** Outcome of the sequence of one node */
+    struct EnableResult
+    {
+        uint8_t nodeId;
+        ENABLE_STATUS status;
+        /** Whether the sequence used the PDOs rather than SDOs */
+        bool usedPDO;
+        /** Time between the start of the sequence and the reception of the
+         * status word that confirmed the requested state
+         */
+        base::Time duration;
+
+        EnableResult()
+            : nodeId(0)
+            , status(ENABLE_PENDING)
+            , usedPDO(false) {}
+    };
+
+    /** Drives the CiA 402 state machine of many nodes in parallel
+     *
+     * enable() brings a node to OPERATION_ENABLED through SHUTDOWN,
+     * SWITCH_ON and ENABLE_OPERATION, and disable() brings it back to
+     * SWITCH_ON_DISABLED. Each node moves to its next transition as soon as
+     * its status word confirms the previous one, independently of the
+     * others.
+     *
+     * When the controller has a command RPDO (see
+     * Controller::queryCyclicCommand) and a TPDO that maps the status
+     * word - and the position in cyclic synchronous position mode, to hold
+     * it - the control word is sent through the RPDO, with a setpoint that
+     * holds the current state, and the status word is watched on the TPDO.
+     * The transitions then take a few SYNC cycles. The caller must keep on
+     * sending SYNC during the sequence. Otherwise, the sequencer falls back
+     * to SDO downloads of the control word, each followed by a status word
+     * upload.
+     *
+     * In PDO mode, the sequencer changes the controller's command control
+     * word (Controller::setCommandControlWord). It is left to
+     * ENABLE_OPERATION after enable() and DISABLE_VOLTAGE after disable().
+     *
+     * The caller writes the messages returned by poll(), and passes all
+     * received frames to process() instead of BusController::process.
+     */
+    class EnableSequencer
+    {
+    public:
+        struct Configuration
+        {
+            /** Time after which a node that did not reach the requested
+             * state is reported as ENABLE_TIMED_OUT
+             */
+            base::Time timeout;
+            /** Time after which a control word that had no effect is sent
+             * again
+             */
+            base::Time retransmitPeriod;
+            /** SDO response timeout */
+            base::Time sdoTimeout;
+
+            Configuration()
+                : timeout(base::Time::fromSeconds(2))
+                , retransmitPeriod(base::Time::fromMilliseconds(20))
+                , sdoTimeout(base::Time::fromMilliseconds(100)) {}
+        };
+
+        EnableSequencer(BusController& bus,
+            Configuration const& configuration = Configuration());
+
+        /** Start bringing a node to OPERATION_ENABLED
+         *
+         * @throws std::invalid_argument if the node is not on the bus
+         */
+        void enable(uint8_t nodeId, base::Time const& now);
+
+        /** Start bringing a node to SWITCH_ON_DISABLED
+         *
+         * @throws std::invalid_argument if the node is not on the bus
+         */
+        void disable(uint8_t nodeId, base::Time const& now);
+
+        /** Returns the messages to send now */
+        std::vector<canbus::Message> poll(base::Time const& now);
+
+        /** Process a received frame through the BusController and advance
+         * the sequence of its node
+         *
+         * @return the result of BusController::process
+         */
+        NodeUpdate process(canbus::Message const& msg, base::Time const& now);
+
+        /** Whether all the sequences are finished */
+        bool isDone() const;
+
+        /** Time at which poll() should be called next, or a null time if
+         * the sequencer is done
+         */
+        base::Time getNextDeadline() const;
+
+        /** The results of all the nodes started since construction, in the
+         * order they were started
+         */
+        std::vector<EnableResult> getResults() const;
+
+        /** The result of the last sequence of a node
+         *
+         * The result's status is ENABLE_PENDING if the node has not been
+         * started
+         */
+        EnableResult getResult(uint8_t nodeId) const;
+
+    private:
+        struct Node
+        {
+            bool started;
+            bool enable;
+            bool usePDO;
+            /** Whether a status word has been received since the start */
+            bool statusReceived;
+            /** Whether a SDO exchange is in progress */
+            bool sdoBusy;
+            /** Last transition sent, or -1 */
+            int lastTransition;
+            base::Time start;
+            base::Time lastSent;
+            EnableResult result;
+
+            Node()
+                : started(false)
+                , enable(false)
+                , usePDO(false)
+                , statusReceived(false)
+                , sdoBusy(false)
+                , lastTransition(-1) {}
+        };
+
+        BusController& mBus;
+        Configuration mConfiguration;
+        SDOScheduler mScheduler;
+        Node mNodes[BusUpdate::MAX_NODES];
+        std::vector<uint8_t> mOrder;
+        int mPendingCount;
+
+        void start(uint8_t nodeId, bool enable, base::Time const& now);
+        /** Check the last status word of a node, and finish its sequence if
+         * it is in the requested state or in fault
+         *
+         * @return false if the sequence is finished
+         */
+        bool evaluate(Node& node, Controller const& controller,
+            base::Time const& now, ControlWord::Transition& transition);
+        void finish(Node& node, ENABLE_STATUS status, base::Time const& now);
+    };
+}
+
+#endif
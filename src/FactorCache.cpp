@@ -0,0 +1,181 @@
+#include <motors_elmo_ds402/FactorCache.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static const char* CACHE_HEADER = "# motors_elmo_ds402 factor cache";
+
+/** Update IDs of the objects that are cached */
+static const uint64_t CACHED_UPDATES = UPDATE_FACTORS | UPDATE_JOINT_LIMITS;
+
+static void fnv1a(uint32_t& hash, uint32_t value)
+{
+    for (int i = 0; i < 4; ++i)
+    {
+        hash ^= (value >> (8 * i)) & 0xFF;
+        hash *= 16777619u;
+    }
+}
+
+uint32_t FactorCache::Entry::checksum(uint8_t nodeId) const
+{
+    uint32_t hash = 2166136261u;
+    fnv1a(hash, nodeId);
+    fnv1a(hash, serialNumber);
+    for (auto const& value : values)
+    {
+        fnv1a(hash, value.first);
+        fnv1a(hash, value.second);
+    }
+    return hash;
+}
+
+/** Parse one line of the cache file, returns false if it is malformed or
+ * if its checksum does not match
+ */
+static bool parseEntry(string const& line, uint8_t& nodeId, FactorCache::Entry& entry)
+{
+    istringstream in(line);
+    unsigned int id;
+    uint32_t checksum;
+    size_t count;
+    in >> dec >> id >> hex >> entry.serialNumber >> checksum >> dec >> count;
+    if (!in || id == 0 || id > 127 || count > OBJECT_COUNT)
+        return false;
+
+    nodeId = id;
+    entry.values.resize(count);
+    for (auto& value : entry.values)
+    {
+        char separator;
+        in >> hex >> value.first >> separator >> value.second;
+        if (!in || separator != '=')
+            return false;
+    }
+    return entry.checksum(nodeId) == checksum;
+}
+
+FactorCache FactorCache::load(string const& path)
+{
+    FactorCache cache;
+    ifstream file(path.c_str());
+    string line;
+    while (getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        uint8_t nodeId;
+        Entry entry;
+        if (parseEntry(line, nodeId, entry))
+            cache.mEntries[nodeId] = entry;
+    }
+    return cache;
+}
+
+void FactorCache::save(string const& path) const
+{
+    string tempPath = path + ".tmp";
+    {
+        ofstream file(tempPath.c_str());
+        file << CACHE_HEADER << "\n";
+        for (auto const& it : mEntries)
+        {
+            Entry const& entry = it.second;
+            file << dec << static_cast<int>(it.first)
+                << hex << " " << entry.serialNumber
+                << " " << entry.checksum(it.first)
+                << dec << " " << entry.values.size();
+            for (auto const& value : entry.values)
+                file << hex << " " << value.first << "=" << value.second;
+            file << "\n";
+        }
+        file.flush();
+        if (!file)
+            throw std::runtime_error("failed to write the factor cache " + tempPath);
+    }
+
+    if (rename(tempPath.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("failed to replace the factor cache " + path);
+}
+
+void FactorCache::store(Controller const& controller)
+{
+    Entry entry;
+    entry.serialNumber = controller.getSerialNumber();
+    for (auto const& info : OBJECT_REGISTRY)
+    {
+        uint32_t value;
+        if ((info.updateId & CACHED_UPDATES) && controller.getRawObject(info, value))
+            entry.values.push_back(make_pair(info.getFullId(), value));
+    }
+    mEntries[controller.getNodeId()] = entry;
+}
+
+/** Whether the entry has a value for the objects of the given SDO upload
+ * requests
+ */
+static bool hasQueriedObjects(FactorCache::Entry const& entry,
+    vector<canbus::Message> const& queries)
+{
+    for (auto const& query : queries)
+    {
+        uint32_t fullId = static_cast<uint32_t>(query.data[1] | query.data[2] << 8) << 8 |
+            query.data[3];
+        auto match = find_if(entry.values.begin(), entry.values.end(),
+            [fullId](pair<uint32_t, uint32_t> const& value) {
+                return value.first == fullId;
+            });
+        if (match == entry.values.end())
+            return false;
+    }
+    return true;
+}
+
+bool FactorCache::apply(Controller& controller) const
+{
+    auto it = mEntries.find(controller.getNodeId());
+    if (it == mEntries.end())
+        return false;
+    if (it->second.serialNumber != controller.getSerialNumber())
+        return false;
+    if (!hasQueriedObjects(it->second, controller.queryFactors()) ||
+        !hasQueriedObjects(it->second, controller.queryJointLimits()))
+        return false;
+
+    for (auto const& value : it->second.values)
+    {
+        ObjectInfo const* info = findObject(value.first >> 8, value.first & 0xFF);
+        if (info && (info->updateId & CACHED_UPDATES))
+            controller.setRawObject(*info, value.second);
+    }
+    return true;
+}
+
+bool FactorCache::has(uint8_t nodeId) const
+{
+    return mEntries.find(nodeId) != mEntries.end();
+}
+
+FactorCache::Entry const& FactorCache::get(uint8_t nodeId) const
+{
+    auto it = mEntries.find(nodeId);
+    if (it == mEntries.end())
+        throw std::invalid_argument("no factor cache entry for this node");
+    return it->second;
+}
+
+void FactorCache::erase(uint8_t nodeId)
+{
+    mEntries.erase(nodeId);
+}
+
+size_t FactorCache::size() const
+{
+    return mEntries.size();
+}
@@ -0,0 +1,103 @@
+#ifndef MOTORS_ELMO_DS402_FACTOR_CACHE_HPP
+#define MOTORS_ELMO_DS402_FACTOR_CACHE_HPP
+
+#include <map>
+#include <string>
+#include <vector>
+#include <motors_elmo_ds402/Controller.hpp>
+
+namespace motors_elmo_ds402 {
+    /** On-disk cache of the configuration objects of the drives
+     *
+     * Reading the factors and joint limits of a drive takes about fifteen
+     * SDO transfers, but these objects rarely change. The cache stores
+     * their raw values per node, keyed by the drive's serial number (see
+     * Controller::querySerialNumber). At startup, a single serial number
+     * upload per node tells whether the cached values can be used. A
+     * different drive at the same node ID - e.g. after rewiring - does not
+     * match, and requires a full read.
+     *
+     * Each entry is stored with a checksum of its content. Entries whose
+     * checksum does not match are ignored when loading. The checksum only
+     * detects a corrupted file: the drive offers no checksum of its
+     * parameters, so the serial number is the only key. Changes made to
+     * the cached objects of a drive by other means (e.g. the vendor's
+     * tools) are therefore not detected. Whoever changes them must
+     * invalidate the node's entry with erase(), or delete the file.
+     *
+     * The cache covers the objects that have UPDATE_FACTORS or
+     * UPDATE_JOINT_LIMITS, including MotorRatedTorque when it has been set
+     * through Controller::setMotorParameters.
+     */
+    class FactorCache
+    {
+    public:
+        struct Entry
+        {
+            uint32_t serialNumber;
+            /** Full object ID (see ObjectInfo::getFullId) and raw value of
+             * each cached object
+             */
+            std::vector<std::pair<uint32_t, uint32_t>> values;
+
+            Entry()
+                : serialNumber(0) {}
+
+            /** Checksum of the serial number and values, as stored in the
+             * cache file
+             */
+            uint32_t checksum(uint8_t nodeId) const;
+        };
+
+        /** Load a cache file
+         *
+         * A missing file results in an empty cache. Malformed entries, and
+         * entries whose checksum does not match, are ignored: the
+         * corresponding nodes will be read in full
+         */
+        static FactorCache load(std::string const& path);
+
+        /** Save the cache
+         *
+         * The file is written next to the target and then renamed, so that
+         * an interrupted save does not corrupt an existing cache
+         *
+         * @throws std::runtime_error if the file cannot be written
+         */
+        void save(std::string const& path) const;
+
+        /** Store the cached objects that the controller has received so far
+         *
+         * @throws canopen_master::ObjectNotRead if the controller has not
+         *   received the serial number
+         */
+        void store(Controller const& controller);
+
+        /** Apply the cached objects of the controller's node, if the
+         * controller's serial number matches the cached one
+         *
+         * @return false if there is no entry for the node, if the serial
+         *   numbers differ, or if the entry lacks one of the objects read
+         *   by Controller::queryFactors and Controller::queryJointLimits.
+         *   The controller is left unchanged in this case
+         * @throws canopen_master::ObjectNotRead if the controller has not
+         *   received the serial number
+         */
+        bool apply(Controller& controller) const;
+
+        bool has(uint8_t nodeId) const;
+
+        /** Returns the entry of the given node
+         *
+         * @throws std::invalid_argument if there is none
+         */
+        Entry const& get(uint8_t nodeId) const;
+        void erase(uint8_t nodeId);
+        size_t size() const;
+
+    private:
+        std::map<uint8_t, Entry> mEntries;
+    };
+}
+
+#endif
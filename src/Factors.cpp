@@ -1,35 +1,95 @@
 #include <motors_elmo_ds402/Factors.hpp>
+#include <stdexcept>
 
 using namespace std;
 using namespace motors_elmo_ds402;
 
-double Factors::scaleEncoderValue(int64_t encoder) const
+static int64_t gcd(int64_t a, int64_t b)
 {
-    int64_t turns = encoder * positionNumerator / positionDenominator;
-    int64_t remainingEncoder = encoder - turns * positionDenominator;
-    double remaining = static_cast<double>(remainingEncoder) * positionNumerator /
-        positionDenominator;
-    return 2 * M_PI * turns + 2 * M_PI * remaining;
+    while (b != 0)
+    {
+        int64_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a < 0 ? -a : a;
 }
 
-double Factors::currentToUserTorque(long current) const
+/** Remove the common factors of a and b */
+static void reduce(int64_t& a, int64_t& b)
 {
-    return static_cast<double>(current) / 1000 * ratedTorque;
+    int64_t d = gcd(a, b);
+    if (d > 1)
+    {
+        a /= d;
+        b /= d;
+    }
 }
 
-double Factors::currentToUser(long current) const
+/** Computes a * b * c, returning false on overflow */
+static bool multiply(int64_t a, int64_t b, int64_t c, int64_t& result)
 {
-    return static_cast<double>(current) / 1000 * ratedCurrent;
+    int64_t ab;
+    return !__builtin_mul_overflow(a, b, &ab) &&
+        !__builtin_mul_overflow(ab, c, &result);
+}
+
+static const long double TWO_PI = 6.283185307179586476925286766559L;
+
+bool Factors::isValid() const
+{
+    int64_t terms[] = {
+        encoderTicks, encoderRevolutions,
+        gearMotorShaftRevolutions, gearDrivingShaftRevolutions,
+        feedLength, feedDrivingShaftRevolutions,
+        velocityFactorNum, velocityFactorDen
+    };
+    for (int64_t term : terms)
+    {
+        if (term == 0)
+            return false;
+    }
+    return true;
 }
 
 void Factors::update()
 {
-    positionNumerator =
-        feedLength *
-        encoderRevolutions *
-        gearDrivingShaftRevolutions;
-    positionDenominator =
-        feedDrivingShaftRevolutions *
-        encoderTicks *
-        gearMotorShaftRevolutions;
+    if (!isValid())
+        throw std::invalid_argument("Factors: the ratios must not have a zero term");
+
+    // Cancel common factors between the numerator and denominator terms
+    // before multiplying them. The product of three 32-bit values does not
+    // fit in 64 bits in general, the reduced one usually does
+    int64_t num[3] = { feedLength, encoderRevolutions, gearDrivingShaftRevolutions };
+    int64_t den[3] = { feedDrivingShaftRevolutions, encoderTicks, gearMotorShaftRevolutions };
+    for (int i = 0; i < 3; ++i)
+    {
+        for (int j = 0; j < 3; ++j)
+            reduce(num[i], den[j]);
+    }
+
+    long double ticksToTurns =
+        static_cast<long double>(num[0]) * num[1] * num[2] /
+        (static_cast<long double>(den[0]) * den[1] * den[2]);
+    if (!multiply(num[0], num[1], num[2], positionNumerator) ||
+        !multiply(den[0], den[1], den[2], positionDenominator))
+    {
+        positionNumerator = 0;
+        positionDenominator = 0;
+    }
+
+    long double positionScaleL = TWO_PI * ticksToTurns;
+    positionScale = positionScaleL;
+    positionInverseScale = 1 / positionScaleL;
+
+    // The velocity factor converts position units per second into the
+    // drive's velocity units
+    long double velocityScaleL = positionScaleL * velocityFactorDen / velocityFactorNum;
+    velocityScale = velocityScaleL;
+    velocityInverseScale = 1 / velocityScaleL;
+
+    currentScale = static_cast<long double>(ratedCurrent) / 1000;
+    currentInverseScale = 1000 / static_cast<long double>(ratedCurrent);
+    torqueScale = static_cast<long double>(ratedTorque) / 1000;
+    torqueInverseScale = 1000 / static_cast<long double>(ratedTorque);
 }
@@ -2,10 +2,24 @@
 #define MOTORS_ELMO_DS402_FACTORS_HPP
 
 #include <cstdint>
+#include <cmath>
 #include <base/Float.hpp>
 
 namespace motors_elmo_ds402
 {
+    /**
+     * Conversion between the drive's internal units and SI units
+     *
+     * The raw factors (the fields up to ratedTorque) are converted by
+     * update() into multipliers, so that the conversions themselves are a
+     * single multiplication, in both directions.
+     *
+     * The multipliers are computed in extended precision from the exact
+     * rational factor and rounded once. Conversions from the drive's units
+     * are therefore within 1 ulp of the exact value for any 32-bit raw
+     * value. Conversions to the drive's units are rounded to the nearest
+     * integer.
+     */
     struct Factors
     {
         int64_t encoderTicks = 1;
@@ -14,17 +28,107 @@ namespace motors_elmo_ds402
         int64_t gearDrivingShaftRevolutions = 1;
         int64_t feedLength = 1;
         int64_t feedDrivingShaftRevolutions = 1;
+        int64_t velocityFactorNum = 1;
+        int64_t velocityFactorDen = 1;
         double ratedCurrent = base::unknown<double>();
         double ratedTorque  = base::unknown<double>();
 
+        /** Whether none of the terms of the position and velocity ratios
+         * is zero, i.e. whether update() can be called
+         */
+        bool isValid() const;
+
+        /** Recompute the conversion multipliers from the raw factors
+         *
+         * @throws std::invalid_argument if a term of the position or
+         *   velocity ratios is zero
+         */
         void update();
+
+        /** Convert a position from encoder ticks into radians */
         double scaleEncoderValue(int64_t encoder) const;
+        /** Convert a velocity from velocity units into radians per second */
+        double velocityToUser(int64_t velocity) const;
+        /** Convert a current from thousands of the rated current into Nm */
         double currentToUserTorque(int64_t current) const;
+        /** Convert a current from thousands of the rated current into A */
         double currentToUser(int64_t current) const;
 
+        /** Inverse of scaleEncoderValue, rounded to the nearest integer */
+        int64_t userToEncoderValue(double value) const;
+        /** Inverse of velocityToUser, rounded to the nearest integer */
+        int64_t userToVelocity(double velocity) const;
+        /** Inverse of currentToUserTorque, rounded to the nearest integer */
+        int64_t userTorqueToCurrent(double torque) const;
+        /** Inverse of currentToUser, rounded to the nearest integer */
+        int64_t userToCurrent(double current) const;
+
+        /** The reduced ratio between encoder ticks and turns
+         *
+         * One encoder tick is positionNumerator / positionDenominator turns.
+         * Both are zero if the reduced ratio does not fit in 64 bits, in
+         * which case the multipliers are computed from an approximation
+         */
         int64_t positionNumerator = 1;
         int64_t positionDenominator = 1;
+
+        /** Radians per encoder tick */
+        double positionScale = 2 * M_PI;
+        /** Encoder ticks per radian */
+        double positionInverseScale = 1 / (2 * M_PI);
+        /** Radians per second per velocity unit */
+        double velocityScale = 2 * M_PI;
+        /** Velocity units per radians per second */
+        double velocityInverseScale = 1 / (2 * M_PI);
+        /** Amperes per thousands of rated current */
+        double currentScale = base::unknown<double>();
+        /** Thousands of rated current per ampere */
+        double currentInverseScale = base::unknown<double>();
+        /** Nm per thousands of rated current */
+        double torqueScale = base::unknown<double>();
+        /** Thousands of rated current per Nm */
+        double torqueInverseScale = base::unknown<double>();
     };
+
+    inline double Factors::scaleEncoderValue(int64_t encoder) const
+    {
+        return static_cast<double>(encoder) * positionScale;
+    }
+
+    inline double Factors::velocityToUser(int64_t velocity) const
+    {
+        return static_cast<double>(velocity) * velocityScale;
+    }
+
+    inline double Factors::currentToUserTorque(int64_t current) const
+    {
+        return static_cast<double>(current) * torqueScale;
+    }
+
+    inline double Factors::currentToUser(int64_t current) const
+    {
+        return static_cast<double>(current) * currentScale;
+    }
+
+    inline int64_t Factors::userToEncoderValue(double value) const
+    {
+        return std::llround(value * positionInverseScale);
+    }
+
+    inline int64_t Factors::userToVelocity(double velocity) const
+    {
+        return std::llround(velocity * velocityInverseScale);
+    }
+
+    inline int64_t Factors::userTorqueToCurrent(double torque) const
+    {
+        return std::llround(torque * torqueInverseScale);
+    }
+
+    inline int64_t Factors::userToCurrent(double current) const
+    {
+        return std::llround(current * currentInverseScale);
+    }
 }
 
 #endif
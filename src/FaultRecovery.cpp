@@ -0,0 +1,347 @@
+#include <motors_elmo_ds402/FaultRecovery.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static bool isResult(SDOResult const& result, ObjectInfo const& info)
+{
+    return result.objectId == info.objectId && result.objectSubId == info.objectSubId;
+}
+
+FaultRecovery::FaultRecovery(BusController& bus, Configuration const& configuration)
+    : mBus(bus)
+    , mConfiguration(configuration)
+    , mSequencer(bus, configuration.enable)
+    , mScheduler(configuration.enable.sdoTimeout)
+{
+    for (auto& policy : mPolicies)
+        policy = configuration.defaultPolicy;
+}
+
+void FaultRecovery::setPolicy(uint8_t errorClass, RECOVERY_POLICY policy)
+{
+    mPolicies[errorClass] = policy;
+}
+
+RECOVERY_POLICY FaultRecovery::getPolicy(uint16_t errorCode) const
+{
+    return mPolicies[errorCode >> 8];
+}
+
+void FaultRecovery::watch(uint8_t nodeId)
+{
+    if (!mBus.has(nodeId))
+        throw std::invalid_argument("FaultRecovery: node is not on the bus");
+
+    Node& node = mNodes[nodeId];
+    if (node.watched)
+        return;
+    node.watched = true;
+    node.event.nodeId = nodeId;
+    mWatched.push_back(nodeId);
+}
+
+void FaultRecovery::acknowledge(uint8_t nodeId, base::Time const& now)
+{
+    Node& node = mNodes[nodeId];
+    if (!node.watched)
+        throw std::invalid_argument("FaultRecovery: node is not watched");
+    if (node.state != RECOVERY_LATCHED)
+        return;
+
+    node.attempts = 0;
+    node.lastRecovery = base::Time();
+    if (!isInFault(nodeId))
+    {
+        node.state = RECOVERY_WATCHING;
+        return;
+    }
+
+    // Keep the error code of the latched fault
+    node.event.policy = RECOVERY_RESET;
+    node.event.recovered = false;
+    node.event.detected = now;
+    startReset(nodeId, now);
+}
+
+RECOVERY_STATE FaultRecovery::getState(uint8_t nodeId) const
+{
+    return mNodes[nodeId].state;
+}
+
+bool FaultRecovery::isInFault(uint8_t nodeId) const
+{
+    Controller const& controller = mBus.get(nodeId);
+    return controller.hasTelemetry<StatusWordRegister>() &&
+        controller.getStatusWord().state == StatusWord::FAULT;
+}
+
+bool FaultRecovery::hasStatusPDO(uint8_t nodeId) const
+{
+    return mBus.get(nodeId).getTPDOUpdateIds() & UPDATE_STATUS_WORD;
+}
+
+void FaultRecovery::onStatus(uint8_t nodeId, base::Time const& now)
+{
+    Node& node = mNodes[nodeId];
+    if (node.state == RECOVERY_WATCHING)
+    {
+        if (isInFault(nodeId))
+            onFault(nodeId, now);
+    }
+    else if (node.state == RECOVERY_RESETTING)
+    {
+        if (isInFault(nodeId))
+            return;
+
+        if (node.event.policy == RECOVERY_RESET_AND_ENABLE)
+        {
+            node.state = RECOVERY_ENABLING;
+            node.enableTime = now;
+            mSequencer.enable(nodeId, now);
+        }
+        else
+            finish(nodeId, true, now);
+    }
+}
+
+void FaultRecovery::onFault(uint8_t nodeId, base::Time const& now)
+{
+    Node& node = mNodes[nodeId];
+    if (!node.lastRecovery.isNull() && now - node.lastRecovery < mConfiguration.stableTime)
+        ++node.attempts;
+    else
+        node.attempts = 1;
+
+    node.event = RecoveryEvent();
+    node.event.nodeId = nodeId;
+    node.event.detected = now;
+
+    // Read the error once, on the fault edge. The error code is already
+    // known if the drive sent an EMCY right before
+    Controller const& controller = mBus.get(nodeId);
+    EmergencyHistory const& emergencies = controller.getEmergencies();
+    bool recentEmergency = !node.lastEmergency.isNull() &&
+        !(now - node.lastEmergency > mConfiguration.emergencyWindow);
+    if (recentEmergency && !emergencies.getLast().isErrorReset())
+    {
+        node.event.errorCode = emergencies.getLast().errorCode;
+        node.event.hasErrorCode = true;
+        node.pendingErrorReads = 1;
+    }
+    else
+    {
+        mScheduler.push(controller.queryRawObject(getObjectInfo<ErrorCode>()));
+        node.pendingErrorReads = 2;
+    }
+    mScheduler.push(controller.queryRawObject(getObjectInfo<ExtendedErrorCode>()));
+    node.lastEmergency = base::Time();
+    node.state = RECOVERY_READING_ERROR;
+}
+
+void FaultRecovery::applyPolicy(uint8_t nodeId, base::Time const& now)
+{
+    Node& node = mNodes[nodeId];
+    node.event.policy = node.event.hasErrorCode ?
+        getPolicy(node.event.errorCode) : mConfiguration.defaultPolicy;
+
+    if (node.event.policy == RECOVERY_LATCH || node.attempts > mConfiguration.maxAttempts)
+        finish(nodeId, false, now);
+    else
+        startReset(nodeId, now);
+}
+
+void FaultRecovery::startReset(uint8_t nodeId, base::Time const& now)
+{
+    // The drive resets on the rising edge of the fault reset bit
+    Node& node = mNodes[nodeId];
+    Controller& controller = mBus.get(nodeId);
+    mScheduler.push(controller.send(ControlWord(ControlWord::DISABLE_VOLTAGE, false)));
+    mScheduler.push(controller.send(ControlWord(ControlWord::FAULT_RESET, false)));
+    // Check the outcome right away rather than at the next poll period
+    if (!node.statusQueried)
+    {
+        mScheduler.push(controller.queryStatusWord());
+        node.statusQueried = true;
+        node.lastStatusQuery = now;
+    }
+    node.resetTime = now;
+    node.state = RECOVERY_RESETTING;
+}
+
+void FaultRecovery::finish(uint8_t nodeId, bool recovered, base::Time const& end)
+{
+    Node& node = mNodes[nodeId];
+    node.event.recovered = recovered;
+    node.event.latency = end - node.event.detected;
+    mEvents.push_back(node.event);
+
+    if (recovered)
+    {
+        mLatency.add(node.event.latency.toMicroseconds());
+        node.lastRecovery = end;
+        node.state = RECOVERY_WATCHING;
+    }
+    else
+        node.state = RECOVERY_LATCHED;
+}
+
+vector<canbus::Message> FaultRecovery::poll(base::Time const& now)
+{
+    // Aborts are handled in process()
+    for (auto const& failure : mScheduler.getFailures())
+    {
+        if (failure.status != SDOResult::TIMED_OUT)
+            continue;
+
+        Node& node = mNodes[failure.nodeId];
+        if (isResult(failure, getObjectInfo<StatusWordRegister>()))
+            node.statusQueried = false;
+        else if (node.state == RECOVERY_READING_ERROR &&
+            failure.objectId != ControlWordRegister::OBJECT_ID &&
+            --node.pendingErrorReads == 0)
+            applyPolicy(failure.nodeId, now);
+    }
+    mScheduler.clearFailures();
+
+    vector<canbus::Message> messages = mSequencer.poll(now);
+    for (uint8_t nodeId : mWatched)
+    {
+        Node& node = mNodes[nodeId];
+        if (node.state == RECOVERY_ENABLING)
+        {
+            EnableResult result = mSequencer.getResult(nodeId);
+            base::Time end = node.enableTime + result.duration;
+            if (result.status == ENABLE_DONE)
+                finish(nodeId, true, end);
+            else if (result.status == ENABLE_FAULT)
+            {
+                // The fault came back while enabling, which counts as a
+                // repeated fault
+                finish(nodeId, false, end);
+                node.lastRecovery = end;
+                onFault(nodeId, end);
+            }
+            else if (result.status == ENABLE_TIMED_OUT)
+                finish(nodeId, false, end);
+            continue;
+        }
+
+        if (node.state == RECOVERY_RESETTING &&
+            !(now - node.resetTime < mConfiguration.resetTimeout))
+        {
+            finish(nodeId, false, now);
+            continue;
+        }
+
+        if (node.state != RECOVERY_WATCHING && node.state != RECOVERY_RESETTING)
+            continue;
+        if (node.statusQueried || hasStatusPDO(nodeId))
+            continue;
+        if (!node.lastStatusQuery.isNull() &&
+            now - node.lastStatusQuery < mConfiguration.statusPollPeriod)
+            continue;
+
+        mScheduler.push(mBus.get(nodeId).queryStatusWord());
+        node.statusQueried = true;
+        node.lastStatusQuery = now;
+    }
+
+    vector<canbus::Message> sdos = mScheduler.poll(now);
+    messages.insert(messages.end(), sdos.begin(), sdos.end());
+    return messages;
+}
+
+NodeUpdate FaultRecovery::process(canbus::Message const& msg, base::Time const& now)
+{
+    NodeUpdate update = mSequencer.process(msg, now);
+    SDOResult result = mScheduler.process(msg, now);
+    if (result.isValid())
+    {
+        Node& node = mNodes[result.nodeId];
+        if (isResult(result, getObjectInfo<StatusWordRegister>()))
+            node.statusQueried = false;
+        else if (node.state == RECOVERY_READING_ERROR &&
+            result.objectId != ControlWordRegister::OBJECT_ID)
+        {
+            // An aborted read still counts, the policy is then the default
+            Controller const& controller = mBus.get(result.nodeId);
+            uint32_t value;
+            if (result.status == SDOResult::SUCCESS)
+            {
+                if (isResult(result, getObjectInfo<ErrorCode>()) &&
+                    controller.getRawObject(getObjectInfo<ErrorCode>(), value))
+                {
+                    node.event.errorCode = value;
+                    node.event.hasErrorCode = true;
+                }
+                else if (isResult(result, getObjectInfo<ExtendedErrorCode>()) &&
+                    controller.getRawObject(getObjectInfo<ExtendedErrorCode>(), value))
+                    node.event.extendedErrorCode = static_cast<int32_t>(value);
+            }
+
+            if (--node.pendingErrorReads == 0)
+                applyPolicy(result.nodeId, now);
+        }
+    }
+
+    if (!update.isValid() || !mNodes[update.nodeId].watched)
+        return update;
+
+    if (update.update.isUpdated(UPDATE_STATUS_WORD))
+        onStatus(update.nodeId, now);
+    else if (update.update.isUpdated(UPDATE_EMERGENCY))
+    {
+        // The drive signalled an error, check its state now instead of at
+        // the next poll period
+        Node& node = mNodes[update.nodeId];
+        node.lastEmergency = now;
+        if (node.state == RECOVERY_WATCHING && !node.statusQueried &&
+            !hasStatusPDO(update.nodeId))
+        {
+            mScheduler.push(mBus.get(update.nodeId).queryStatusWord());
+            node.statusQueried = true;
+            node.lastStatusQuery = now;
+        }
+    }
+    return update;
+}
+
+base::Time FaultRecovery::getNextDeadline() const
+{
+    base::Time deadline = mScheduler.getNextDeadline();
+    base::Time sequencerDeadline = mSequencer.getNextDeadline();
+    if (deadline.isNull() || (!sequencerDeadline.isNull() && sequencerDeadline < deadline))
+        deadline = sequencerDeadline;
+
+    for (uint8_t nodeId : mWatched)
+    {
+        Node const& node = mNodes[nodeId];
+        base::Time nodeDeadline;
+        if (node.state == RECOVERY_RESETTING)
+            nodeDeadline = node.resetTime + mConfiguration.resetTimeout;
+        if ((node.state == RECOVERY_WATCHING || node.state == RECOVERY_RESETTING) &&
+            !node.statusQueried && !hasStatusPDO(nodeId))
+            nodeDeadline = node.lastStatusQuery + mConfiguration.statusPollPeriod;
+
+        if (!nodeDeadline.isNull() && (deadline.isNull() || nodeDeadline < deadline))
+            deadline = nodeDeadline;
+    }
+    return deadline;
+}
+
+vector<RecoveryEvent> const& FaultRecovery::getEvents() const
+{
+    return mEvents;
+}
+
+void FaultRecovery::clearEvents()
+{
+    mEvents.clear();
+}
+
+HistogramSnapshot FaultRecovery::getLatencyStatistics() const
+{
+    return mLatency.snapshot();
+}
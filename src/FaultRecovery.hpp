@@ -0,0 +1,239 @@
+#ifndef MOTORS_ELMO_DS402_FAULT_RECOVERY_HPP
+#define MOTORS_ELMO_DS402_FAULT_RECOVERY_HPP
+
+#include <vector>
+#include <motors_elmo_ds402/EnableSequencer.hpp>
+#include <motors_elmo_ds402/Statistics.hpp>
+
+namespace motors_elmo_ds402 {
+    /** What FaultRecovery does with a fault */
+    enum RECOVERY_POLICY
+    {
+        /** Reset the fault and bring the drive back to OPERATION_ENABLED */
+        RECOVERY_RESET_AND_ENABLE,
+        /** Reset the fault, leaving the drive in SWITCH_ON_DISABLED */
+        RECOVERY_RESET,
+        /** Leave the drive in fault until FaultRecovery::acknowledge is
+         * called
+         */
+        RECOVERY_LATCH
+    };
+
+    /** Phase of the handling of a node by FaultRecovery */
+    enum RECOVERY_STATE
+    {
+        /** Watching the status word for a fault */
+        RECOVERY_WATCHING,
+        /** Reading ErrorCode and ExtendedErrorCode */
+        RECOVERY_READING_ERROR,
+        /** Waiting for the drive to leave FAULT after a fault reset */
+        RECOVERY_RESETTING,
+        /** Bringing the drive back to OPERATION_ENABLED */
+        RECOVERY_ENABLING,
+        /** Waiting for the operator, see FaultRecovery::acknowledge */
+        RECOVERY_LATCHED
+    };
+
+    /** Report of the handling of one fault */
+    struct RecoveryEvent
+    {
+        uint8_t nodeId;
+        /** ErrorCode (0x603F), valid if hasErrorCode is set */
+        uint16_t errorCode;
+        /** Elmo's ExtendedErrorCode (0x2081 sub 5), valid if hasErrorCode is
+         * set
+         */
+        int32_t extendedErrorCode;
+        bool hasErrorCode;
+        RECOVERY_POLICY policy;
+        /** Whether the drive got back to the state the policy targets. If
+         * not, the node is latched, unless the fault came back while the
+         * drive was being re-enabled, which starts the handling of a new
+         * fault
+         */
+        bool recovered;
+        /** Time at which the fault was seen in the status word */
+        base::Time detected;
+        /** Time between the detection and the end of the handling */
+        base::Time latency;
+
+        RecoveryEvent()
+            : nodeId(0)
+            , errorCode(0)
+            , extendedErrorCode(0)
+            , hasErrorCode(false)
+            , policy(RECOVERY_LATCH)
+            , recovered(false) {}
+    };
+
+    /** Automatic recovery of drive faults
+     *
+     * The status word of the watched nodes is followed through the TPDOs
+     * when one maps it, and polled over SDO otherwise. When a node goes
+     * into FAULT, its ErrorCode and ExtendedErrorCode are read once, and
+     * the policy of the error's class is applied. The class is the high
+     * byte of the CiA 402 error code (e.g. 0x23 for output short-circuits,
+     * 0x32 for DC link voltage errors, 0x86 for position control errors).
+     *
+     * When the drive sent an EMCY frame shortly before the fault was
+     * detected (see Configuration::emergencyWindow), ErrorCode is taken
+     * from it instead of being read. EMCY frames also trigger an
+     * immediate status word query on the nodes whose status word is
+     * polled.
+     *
+     * Resets are sent by SDO, and the drives are re-enabled through an
+     * EnableSequencer, i.e. through the command RPDO when there is one.
+     * A node whose fault comes back more than Configuration::maxAttempts
+     * times in a row, or that fails to recover, is latched until
+     * acknowledge() is called.
+     *
+     * The caller writes the messages returned by poll(), and passes all
+     * received frames to process() instead of BusController::process. As
+     * with EnableSequencer, SYNC must keep on being sent when the PDOs are
+     * synchronous.
+     */
+    class FaultRecovery
+    {
+    public:
+        struct Configuration
+        {
+            /** Period of the status word polling of the nodes whose status
+             * word is not mapped to a TPDO
+             */
+            base::Time statusPollPeriod;
+            /** Time the drive has to leave FAULT after a fault reset */
+            base::Time resetTimeout;
+            /** Time after a recovery during which a new fault counts as a
+             * repeated one
+             */
+            base::Time stableTime;
+            /** Maximum age of an EMCY at the detection of a fault for its
+             * error code to be used. Older ones are assumed to belong to
+             * another fault, and ErrorCode is read instead
+             */
+            base::Time emergencyWindow;
+            /** Number of recoveries from repeated faults before the node
+             * gets latched
+             */
+            int maxAttempts;
+            /** Policy of the error classes that have none set through
+             * setPolicy
+             */
+            RECOVERY_POLICY defaultPolicy;
+            EnableSequencer::Configuration enable;
+
+            Configuration()
+                : statusPollPeriod(base::Time::fromMilliseconds(10))
+                , resetTimeout(base::Time::fromMilliseconds(500))
+                , stableTime(base::Time::fromSeconds(5))
+                , emergencyWindow(base::Time::fromMilliseconds(100))
+                , maxAttempts(3)
+                , defaultPolicy(RECOVERY_LATCH) {}
+        };
+
+        FaultRecovery(BusController& bus,
+            Configuration const& configuration = Configuration());
+
+        /** Set the policy of an error class, i.e. of the error codes whose
+         * high byte is errorClass
+         */
+        void setPolicy(uint8_t errorClass, RECOVERY_POLICY policy);
+
+        /** The policy applied to an error code */
+        RECOVERY_POLICY getPolicy(uint16_t errorCode) const;
+
+        /** Start watching a node
+         *
+         * @throws std::invalid_argument if the node is not on the bus
+         */
+        void watch(uint8_t nodeId);
+
+        /** Release a latched node
+         *
+         * The node's attempt count is reset. If it is still in fault, the
+         * fault is reset, leaving the drive in SWITCH_ON_DISABLED. This is
+         * reported as a new event with the RECOVERY_RESET policy.
+         *
+         * @throws std::invalid_argument if the node is not watched
+         */
+        void acknowledge(uint8_t nodeId, base::Time const& now);
+
+        RECOVERY_STATE getState(uint8_t nodeId) const;
+
+        /** Returns the messages to send now */
+        std::vector<canbus::Message> poll(base::Time const& now);
+
+        /** Process a received frame through the BusController
+         *
+         * @return the result of BusController::process
+         */
+        NodeUpdate process(canbus::Message const& msg, base::Time const& now);
+
+        /** Time at which poll() should be called next */
+        base::Time getNextDeadline() const;
+
+        /** The faults handled so far
+         *
+         * The list is accumulated until clearEvents() is called
+         */
+        std::vector<RecoveryEvent> const& getEvents() const;
+
+        /** Clear the list returned by getEvents */
+        void clearEvents();
+
+        /** Latency of the successful recoveries, in microseconds */
+        HistogramSnapshot getLatencyStatistics() const;
+
+    private:
+        struct Node
+        {
+            bool watched;
+            RECOVERY_STATE state;
+            /** Whether a status word upload is in flight */
+            bool statusQueried;
+            base::Time lastStatusQuery;
+            /** Error objects still expected in RECOVERY_READING_ERROR */
+            int pendingErrorReads;
+            /** Reception time of the last EMCY not yet attributed to a
+             * fault, null if there is none
+             */
+            base::Time lastEmergency;
+            base::Time resetTime;
+            base::Time enableTime;
+            base::Time lastRecovery;
+            int attempts;
+            RecoveryEvent event;
+
+            Node()
+                : watched(false)
+                , state(RECOVERY_WATCHING)
+                , statusQueried(false)
+                , pendingErrorReads(0)
+                , attempts(0) {}
+        };
+
+        BusController& mBus;
+        Configuration mConfiguration;
+        EnableSequencer mSequencer;
+        SDOScheduler mScheduler;
+        RECOVERY_POLICY mPolicies[256];
+        Node mNodes[BusUpdate::MAX_NODES];
+        std::vector<uint8_t> mWatched;
+        std::vector<RecoveryEvent> mEvents;
+        Histogram mLatency;
+
+        bool isInFault(uint8_t nodeId) const;
+        /** Whether the status word of a node is reported by a TPDO */
+        bool hasStatusPDO(uint8_t nodeId) const;
+        void onStatus(uint8_t nodeId, base::Time const& now);
+        void onFault(uint8_t nodeId, base::Time const& now);
+        void applyPolicy(uint8_t nodeId, base::Time const& now);
+        void startReset(uint8_t nodeId, base::Time const& now);
+        /** Report the current event of a node, and latch it if it did
+         * not recover
+         */
+        void finish(uint8_t nodeId, bool recovered, base::Time const& end);
+    };
+}
+
+#endif
@@ -0,0 +1,230 @@
+#include <motors_elmo_ds402/HeartbeatSupervisor.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+HeartbeatSupervisor::HeartbeatSupervisor(Configuration const& configuration)
+    : mConfiguration(configuration)
+    , mTickUsec(configuration.tick.toMicroseconds())
+    , mSlotMask(configuration.slotCount - 1)
+    , mSlots(configuration.slotCount, NO_ENTRY)
+    , mCurrentTick(0)
+    , mStarted(false)
+{
+    size_t slots = configuration.slotCount;
+    if (!slots || (slots & (slots - 1)))
+        throw std::invalid_argument("HeartbeatSupervisor: the slot count must be a power of two");
+    if (configuration.tick.toMicroseconds() <= 0)
+        throw std::invalid_argument("HeartbeatSupervisor: the tick must be positive");
+
+    int64_t period = configuration.period.toMicroseconds();
+    if (period % 1000 || period < 1000 || period > 65535000)
+        throw std::invalid_argument("HeartbeatSupervisor: the period must be a whole "
+            "number of milliseconds within [1, 65535]");
+}
+
+size_t HeartbeatSupervisor::addBus(BusController& bus)
+{
+    Bus entry;
+    entry.controller = &bus;
+    entry.entries.fill(static_cast<int>(NO_ENTRY));
+    mBuses.push_back(entry);
+    return mBuses.size() - 1;
+}
+
+void HeartbeatSupervisor::watch(size_t busIndex, uint8_t nodeId, base::Time const& now)
+{
+    if (busIndex >= mBuses.size())
+        throw std::invalid_argument("HeartbeatSupervisor: invalid bus index");
+    if (!mBuses[busIndex].controller->has(nodeId))
+        throw std::invalid_argument("HeartbeatSupervisor: node is not on the bus");
+    if (findEntry(busIndex, nodeId) != NO_ENTRY)
+        return;
+    if (!mStarted)
+        start(now);
+
+    Entry entry;
+    entry.busIndex = busIndex;
+    entry.nodeId = nodeId;
+    entry.next = NO_ENTRY;
+    entry.prev = NO_ENTRY;
+    entry.slot = NO_ENTRY;
+    entry.rounds = 0;
+    entry.lost = false;
+    entry.watchTime = now;
+    mEntries.push_back(entry);
+
+    int index = mEntries.size() - 1;
+    mBuses[busIndex].entries[nodeId] = index;
+    schedule(index, now + mConfiguration.period + mConfiguration.tolerance);
+}
+
+vector<canbus::Message> HeartbeatSupervisor::queryConfiguration(size_t busIndex) const
+{
+    Bus const& bus = mBuses.at(busIndex);
+    uint32_t period = mConfiguration.period.toMilliseconds();
+
+    vector<canbus::Message> queries;
+    for (int nodeId = 0; nodeId < BusUpdate::MAX_NODES; ++nodeId)
+    {
+        if (bus.entries[nodeId] != NO_ENTRY)
+        {
+            queries.push_back(bus.controller->get(nodeId).sendRawObject(
+                getObjectInfo<ProducerHeartbeatTime>(), period));
+        }
+    }
+    return queries;
+}
+
+void HeartbeatSupervisor::process(size_t busIndex, NodeUpdate const& update, base::Time const& time)
+{
+    if (!update.isValid() || !update.update.isUpdated(UPDATE_HEARTBEAT))
+        return;
+    int index = findEntry(busIndex, update.nodeId);
+    if (index == NO_ENTRY)
+        return;
+
+    Entry& entry = mEntries[index];
+    Controller const& controller = mBuses[busIndex].controller->get(update.nodeId);
+    if (controller.getNodeState() == canopen_master::NODE_INITIALIZING)
+        raise(HeartbeatEvent::BOOTED, entry, time);
+    if (entry.lost)
+    {
+        raise(HeartbeatEvent::RECOVERED, entry, time);
+        entry.lost = false;
+    }
+
+    entry.lastSeen = time;
+    unlink(index);
+    schedule(index, time + mConfiguration.period + mConfiguration.tolerance);
+}
+
+void HeartbeatSupervisor::poll(base::Time const& now)
+{
+    if (!mStarted)
+        start(now);
+
+    int64_t target = now.toMicroseconds() / mTickUsec;
+    while (mCurrentTick < target)
+    {
+        ++mCurrentTick;
+        int index = mSlots[mCurrentTick & mSlotMask];
+        while (index != NO_ENTRY)
+        {
+            Entry& entry = mEntries[index];
+            int next = entry.next;
+            if (entry.rounds)
+                --entry.rounds;
+            else
+            {
+                // Lost nodes stay out of the wheel until their next
+                // heartbeat
+                unlink(index);
+                entry.lost = true;
+                raise(HeartbeatEvent::LOST, entry, now);
+            }
+            index = next;
+        }
+    }
+}
+
+base::Time HeartbeatSupervisor::getNextDeadline() const
+{
+    return base::Time::fromMicroseconds((mCurrentTick + 1) * mTickUsec);
+}
+
+bool HeartbeatSupervisor::isAlive(size_t busIndex, uint8_t nodeId) const
+{
+    int index = findEntry(busIndex, nodeId);
+    return index != NO_ENTRY && !mEntries[index].lost;
+}
+
+base::Time HeartbeatSupervisor::getLastSeen(size_t busIndex, uint8_t nodeId) const
+{
+    return getEntry(busIndex, nodeId).lastSeen;
+}
+
+base::Time HeartbeatSupervisor::getAge(size_t busIndex, uint8_t nodeId, base::Time const& now) const
+{
+    Entry const& entry = getEntry(busIndex, nodeId);
+    if (entry.lastSeen.isNull())
+        return now - entry.watchTime;
+    return now - entry.lastSeen;
+}
+
+vector<HeartbeatEvent> const& HeartbeatSupervisor::getEvents() const
+{
+    return mEvents;
+}
+
+void HeartbeatSupervisor::clearEvents()
+{
+    mEvents.clear();
+}
+
+int HeartbeatSupervisor::findEntry(size_t busIndex, uint8_t nodeId) const
+{
+    if (busIndex >= mBuses.size() || nodeId >= BusUpdate::MAX_NODES)
+        return NO_ENTRY;
+    return mBuses[busIndex].entries[nodeId];
+}
+
+HeartbeatSupervisor::Entry const& HeartbeatSupervisor::getEntry(size_t busIndex, uint8_t nodeId) const
+{
+    int index = findEntry(busIndex, nodeId);
+    if (index == NO_ENTRY)
+        throw std::invalid_argument("HeartbeatSupervisor: node is not watched");
+    return mEntries[index];
+}
+
+void HeartbeatSupervisor::start(base::Time const& now)
+{
+    mCurrentTick = now.toMicroseconds() / mTickUsec;
+    mStarted = true;
+}
+
+void HeartbeatSupervisor::schedule(int index, base::Time const& deadline)
+{
+    // Round up, so that the entry never expires before its deadline
+    int64_t deadlineTick = (deadline.toMicroseconds() + mTickUsec - 1) / mTickUsec;
+    if (deadlineTick <= mCurrentTick)
+        deadlineTick = mCurrentTick + 1;
+
+    Entry& entry = mEntries[index];
+    entry.slot = deadlineTick & mSlotMask;
+    entry.rounds = (deadlineTick - mCurrentTick - 1) / mConfiguration.slotCount;
+    entry.prev = NO_ENTRY;
+    entry.next = mSlots[entry.slot];
+    if (entry.next != NO_ENTRY)
+        mEntries[entry.next].prev = index;
+    mSlots[entry.slot] = index;
+}
+
+void HeartbeatSupervisor::unlink(int index)
+{
+    Entry& entry = mEntries[index];
+    if (entry.slot == NO_ENTRY)
+        return;
+
+    if (entry.prev != NO_ENTRY)
+        mEntries[entry.prev].next = entry.next;
+    else
+        mSlots[entry.slot] = entry.next;
+    if (entry.next != NO_ENTRY)
+        mEntries[entry.next].prev = entry.prev;
+    entry.slot = NO_ENTRY;
+    entry.next = NO_ENTRY;
+    entry.prev = NO_ENTRY;
+}
+
+void HeartbeatSupervisor::raise(HeartbeatEvent::Type type, Entry const& entry, base::Time const& time)
+{
+    HeartbeatEvent event;
+    event.type = type;
+    event.busIndex = entry.busIndex;
+    event.nodeId = entry.nodeId;
+    event.time = time;
+    event.lastSeen = entry.lastSeen;
+    mEvents.push_back(event);
+}
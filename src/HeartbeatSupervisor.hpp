@@ -0,0 +1,192 @@
+#ifndef MOTORS_ELMO_DS402_HEARTBEAT_SUPERVISOR_HPP
+#define MOTORS_ELMO_DS402_HEARTBEAT_SUPERVISOR_HPP
+
+#include <array>
+#include <vector>
+#include <motors_elmo_ds402/BusController.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Change of the liveness of a node detected by HeartbeatSupervisor */
+    struct HeartbeatEvent
+    {
+        enum Type
+        {
+            /** No heartbeat arrived within the period and tolerance */
+            LOST,
+            /** A heartbeat arrived from a node that was lost */
+            RECOVERED,
+            /** The node sent its boot-up message, it lost its
+             * configuration
+             */
+            BOOTED
+        };
+
+        Type type;
+        size_t busIndex;
+        uint8_t nodeId;
+        /** Time at which the event was detected */
+        base::Time time;
+        /** Reception time of the last heartbeat before the event, null if
+         * none was ever received
+         */
+        base::Time lastSeen;
+
+        HeartbeatEvent()
+            : type(LOST)
+            , busIndex(0)
+            , nodeId(0) {}
+    };
+
+    /** Supervision of the heartbeats of the nodes of one or many buses
+     *
+     * Each watched node has a deadline, its last heartbeat plus the period
+     * and a tolerance. The deadlines are kept in a hashed timer wheel:
+     * a heartbeat moves its node to another slot of the wheel in constant
+     * time, and poll() only visits the slots of the ticks elapsed since its
+     * last call. The cost of supervision therefore does not depend on the
+     * number of nodes, only on the number of heartbeats and losses.
+     *
+     * A loss is detected at most one tick after the deadline. With the
+     * default tolerance of half a period, it is raised within one period of
+     * the missed heartbeat.
+     *
+     * Answers to node guarding requests (Controller::queryNodeState) are
+     * reported as UPDATE_HEARTBEAT as well, so nodes that are guarded
+     * rather than producing heartbeats can be supervised the same way.
+     *
+     * The caller passes the results of BusController::process to process()
+     * and calls poll() at least once per tick (see getNextDeadline). Apart
+     * from the event list, memory is allocated only by addBus and watch.
+     */
+    class HeartbeatSupervisor
+    {
+    public:
+        struct Configuration
+        {
+            /** Heartbeat period configured on the nodes */
+            base::Time period;
+            /** Delay after the expected heartbeat before the node is
+             * declared lost
+             */
+            base::Time tolerance;
+            /** Resolution of the timer wheel */
+            base::Time tick;
+            /** Number of slots of the wheel, must be a power of two.
+             * Deadlines further than slotCount ticks take more than one
+             * turn of the wheel
+             */
+            size_t slotCount;
+
+            Configuration()
+                : period(base::Time::fromMilliseconds(100))
+                , tolerance(base::Time::fromMilliseconds(50))
+                , tick(base::Time::fromMilliseconds(5))
+                , slotCount(64) {}
+        };
+
+        /**
+         * @throws std::invalid_argument if slotCount is not a power of two,
+         *   or if the period or tick are not positive, or if the period is
+         *   not a multiple of a millisecond within [1, 65535] ms
+         */
+        explicit HeartbeatSupervisor(Configuration const& configuration = Configuration());
+
+        /** Register a bus, returns its index */
+        size_t addBus(BusController& bus);
+
+        /** Start supervising a node
+         *
+         * The first heartbeat is expected within a period and the tolerance
+         *
+         * @throws std::invalid_argument if the bus index is invalid or the
+         *   node is not on the bus
+         */
+        void watch(size_t busIndex, uint8_t nodeId, base::Time const& now);
+
+        /** The SDO downloads that configure the producer heartbeat of all
+         * the nodes watched on a bus
+         */
+        std::vector<canbus::Message> queryConfiguration(size_t busIndex) const;
+
+        /** Handle the result of BusController::process for the given bus */
+        void process(size_t busIndex, NodeUpdate const& update, base::Time const& time);
+
+        /** Advance the wheel to the given time, raising the losses */
+        void poll(base::Time const& now);
+
+        /** Time of the next tick */
+        base::Time getNextDeadline() const;
+
+        /** Whether the node is watched and not lost */
+        bool isAlive(size_t busIndex, uint8_t nodeId) const;
+
+        /** Reception time of the last heartbeat of a node, null if none was
+         * received
+         *
+         * @throws std::invalid_argument if the node is not watched
+         */
+        base::Time getLastSeen(size_t busIndex, uint8_t nodeId) const;
+
+        /** Time since the last heartbeat of a node, or since it has been
+         * watched if it never sent one
+         *
+         * @throws std::invalid_argument if the node is not watched
+         */
+        base::Time getAge(size_t busIndex, uint8_t nodeId, base::Time const& now) const;
+
+        /** The events detected so far
+         *
+         * The list is accumulated until clearEvents() is called
+         */
+        std::vector<HeartbeatEvent> const& getEvents() const;
+
+        /** Clear the list returned by getEvents */
+        void clearEvents();
+
+    private:
+        enum { NO_ENTRY = -1 };
+
+        struct Entry
+        {
+            size_t busIndex;
+            uint8_t nodeId;
+            /** Neighbours in the slot list, or NO_ENTRY */
+            int next;
+            int prev;
+            /** Slot the entry is in, or NO_ENTRY if it is not scheduled */
+            int slot;
+            /** Turns of the wheel left before the deadline */
+            uint64_t rounds;
+            bool lost;
+            base::Time watchTime;
+            base::Time lastSeen;
+        };
+
+        struct Bus
+        {
+            BusController* controller;
+            /** Index in mEntries of each node ID, or NO_ENTRY */
+            std::array<int, BusUpdate::MAX_NODES> entries;
+        };
+
+        Configuration mConfiguration;
+        uint64_t mTickUsec;
+        uint64_t mSlotMask;
+        std::vector<Bus> mBuses;
+        std::vector<Entry> mEntries;
+        std::vector<int> mSlots;
+        /** Last tick processed by poll */
+        int64_t mCurrentTick;
+        bool mStarted;
+        std::vector<HeartbeatEvent> mEvents;
+
+        int findEntry(size_t busIndex, uint8_t nodeId) const;
+        Entry const& getEntry(size_t busIndex, uint8_t nodeId) const;
+        void start(base::Time const& now);
+        void schedule(int index, base::Time const& deadline);
+        void unlink(int index);
+        void raise(HeartbeatEvent::Type type, Entry const& entry, base::Time const& time);
+    };
+}
+
+#endif
@@ -0,0 +1,108 @@
+#include <motors_elmo_ds402/JointStateBatch.hpp>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MOTORS_ELMO_DS402_HAS_AVX2_KERNEL
+#include <immintrin.h>
+#endif
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+void FactorsTable::resize(size_t size)
+{
+    positionScale.resize(size);
+    velocityScale.resize(size);
+    currentScale.resize(size);
+    torqueScale.resize(size);
+}
+
+size_t FactorsTable::size() const
+{
+    return positionScale.size();
+}
+
+void FactorsTable::set(size_t axis, Factors const& factors)
+{
+    positionScale[axis] = factors.positionScale;
+    velocityScale[axis] = factors.velocityScale;
+    currentScale[axis] = factors.currentScale;
+    torqueScale[axis] = factors.torqueScale;
+}
+
+template<typename T>
+static void scaleScalar(T const* in, double const* scale, double* out,
+    size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; ++i)
+        out[i] = static_cast<double>(in[i]) * scale[i];
+}
+
+#ifdef MOTORS_ELMO_DS402_HAS_AVX2_KERNEL
+__attribute__((target("avx2")))
+static size_t scaleAVX2(int32_t const* in, double const* scale, double* out, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i raw = _mm_loadu_si128(reinterpret_cast<__m128i const*>(in + i));
+        __m256d value = _mm256_cvtepi32_pd(raw);
+        __m256d factor = _mm256_loadu_pd(scale + i);
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(value, factor));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+static size_t scaleAVX2(int16_t const* in, double const* scale, double* out, size_t count)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i raw16 = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(in + i));
+        __m256d value = _mm256_cvtepi32_pd(_mm_cvtepi16_epi32(raw16));
+        __m256d factor = _mm256_loadu_pd(scale + i);
+        _mm256_storeu_pd(out + i, _mm256_mul_pd(value, factor));
+    }
+    return i;
+}
+#endif
+
+bool motors_elmo_ds402::hasAVX2JointStateKernel()
+{
+#ifdef MOTORS_ELMO_DS402_HAS_AVX2_KERNEL
+    static const bool hasAVX2 = __builtin_cpu_supports("avx2");
+    return hasAVX2;
+#else
+    return false;
+#endif
+}
+
+template<typename T>
+static void scale(T const* in, double const* scale, double* out, size_t count,
+    bool useAVX2)
+{
+    if (!in || !out)
+        return;
+
+    size_t done = 0;
+#ifdef MOTORS_ELMO_DS402_HAS_AVX2_KERNEL
+    if (useAVX2)
+        done = scaleAVX2(in, scale, out, count);
+#endif
+    scaleScalar(in, scale, out, done, count);
+}
+
+void motors_elmo_ds402::convertJointStates(FactorsTable const& factors,
+    RawJointStateArrays const& raw, JointStateArrays const& out,
+    size_t count, JOINT_STATE_KERNEL kernel)
+{
+    if (factors.size() < count)
+        throw std::invalid_argument("convertJointStates: factors table smaller than the number of axes");
+
+    bool useAVX2 = (kernel != KERNEL_SCALAR) && hasAVX2JointStateKernel();
+    scale(raw.position, factors.positionScale.data(), out.position, count, useAVX2);
+    scale(raw.velocity, factors.velocityScale.data(), out.speed, count, useAVX2);
+    scale(raw.current, factors.torqueScale.data(), out.effort, count, useAVX2);
+    scale(raw.current, factors.currentScale.data(), out.current, count, useAVX2);
+}
@@ -0,0 +1,79 @@
+#ifndef MOTORS_ELMO_DS402_JOINT_STATE_BATCH_HPP
+#define MOTORS_ELMO_DS402_JOINT_STATE_BATCH_HPP
+
+#include <vector>
+#include <cstddef>
+#include <motors_elmo_ds402/Factors.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Conversion multipliers of many axes, as structure-of-arrays
+     *
+     * Element i of each array is the corresponding Factors multiplier of
+     * axis i
+     */
+    struct FactorsTable
+    {
+        std::vector<double> positionScale;
+        std::vector<double> velocityScale;
+        std::vector<double> currentScale;
+        std::vector<double> torqueScale;
+
+        void resize(size_t size);
+        size_t size() const;
+        /** Set the multipliers of a given axis */
+        void set(size_t axis, Factors const& factors);
+    };
+
+    /** Raw joint state values of many axes, as structure-of-arrays
+     *
+     * Arrays may be left NULL, in which case the corresponding outputs
+     * are not computed
+     */
+    struct RawJointStateArrays
+    {
+        int32_t const* position = nullptr;
+        int32_t const* velocity = nullptr;
+        int16_t const* current = nullptr;
+    };
+
+    /** Converted joint state values of many axes, as structure-of-arrays
+     *
+     * Arrays may be left NULL, in which case they are not computed
+     */
+    struct JointStateArrays
+    {
+        double* position = nullptr;
+        double* speed = nullptr;
+        double* effort = nullptr;
+        double* current = nullptr;
+    };
+
+    enum JOINT_STATE_KERNEL
+    {
+        /** Pick the fastest kernel supported by the CPU */
+        KERNEL_AUTO,
+        KERNEL_SCALAR,
+        /** Falls back to the scalar kernel if the CPU has no AVX2 */
+        KERNEL_AVX2
+    };
+
+    /** Whether the CPU supports the AVX2 kernel */
+    bool hasAVX2JointStateKernel();
+
+    /** Convert the raw joint states of many axes into SI units
+     *
+     * The results are bit-for-bit identical to the ones of
+     * Factors::scaleEncoderValue, Factors::velocityToUser,
+     * Factors::currentToUserTorque and Factors::currentToUser, whatever the
+     * kernel: int32 to double conversion is exact, and both kernels do a
+     * single IEEE multiplication per value.
+     *
+     * @param count the number of axes. The factors table and all non-NULL
+     *   arrays must have at least that many elements
+     */
+    void convertJointStates(FactorsTable const& factors,
+        RawJointStateArrays const& raw, JointStateArrays const& out,
+        size_t count, JOINT_STATE_KERNEL kernel = KERNEL_AUTO);
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef MOTORS_ELMO_DS402_JOINT_STATE_SAMPLE_HPP
+#define MOTORS_ELMO_DS402_JOINT_STATE_SAMPLE_HPP
+
+#include <cstdint>
+
+namespace motors_elmo_ds402 {
+    /**
+     * Raw values of the joint state objects, in the drive's internal units
+     *
+     * Controller::getJointState converts them into SI units using the
+     * drive's Factors
+     */
+    struct JointStateSample {
+        /** Value of PositionActualInternalValue */
+        int32_t position = 0;
+        /** Value of VelocityActualValue */
+        int32_t velocity = 0;
+        /** Value of CurrentActualValue
+         *
+         * This is also the value of TorqueActualValue, as both are
+         * expressed in thousands of the rated current
+         */
+        int16_t current = 0;
+    };
+}
+
+#endif
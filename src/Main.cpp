@@ -1,22 +1,51 @@
 #include <iostream>
+#include <algorithm>
 #include <canbus.hh>
 #include <memory>
+#include <motors_elmo_ds402/BusLoad.hpp>
+#include <motors_elmo_ds402/BusScanner.hpp>
 #include <motors_elmo_ds402/Controller.hpp>
+#include <motors_elmo_ds402/ConfigurationSnapshot.hpp>
+#include <motors_elmo_ds402/FactorCache.hpp>
+#include <motors_elmo_ds402/SDOScheduler.hpp>
+#include <motors_elmo_ds402/SimulatedBus.hpp>
+#include <motors_elmo_ds402/SyncProducer.hpp>
 #include <iodrivers_base/Driver.hpp>
 #include <string>
 #include <iomanip>
 #include <signal.h>
 #include <cstring>
+#include <sstream>
 
 using namespace std;
 using namespace motors_elmo_ds402;
 
 int usage()
 {
-    cout << "motors_elmo_ds402_ctl CAN_DEVICE CAN_DEVICE_TYPE CAN_ID COMMAND\n";
+    cout << "motors_elmo_ds402_ctl CAN_DEVICE CAN_DEVICE_TYPE CAN_ID COMMAND [--cache PATH]\n";
+    cout << "  --cache PATH caches the factors and joint limits of the drive, keyed\n"
+            "      by its serial number, to avoid reading them on each invocation.\n"
+            "      Delete the file after changing them with other tools\n";
+    cout << "  CAN_DEVICE_TYPE 'sim' talks to a simulated drive with ID CAN_ID\n";
     cout << "  reset     # resets the drive";
     cout << "  get-state # displays the drive's internal state\n";
     cout << "  set-state NEW_STATE # changes the drive's internal state\n";
+    cout << "  scan      # lists the nodes on the bus, CAN_ID is ignored\n";
+    cout << "  snapshot FILE # saves the configuration objects of the drive\n";
+    cout << "  restore FILE  # downloads the objects of a snapshot that differ\n"
+            "      # from the drive's, and saves them to non-volatile memory\n";
+    cout << "  monitor-joint-state [--time MS] # displays the joint state, using\n"
+            "      # SYNC-triggered PDOs or, with --time, periodic PDOs\n";
+    cout << "    [--sync-period US [--sync-priority P] [--sync-cpu CPU]]\n"
+            "      # writes SYNC from a dedicated thread at a fixed period\n";
+    cout << "  stats [--duration MS] [--period MS] # runs a SYNC/TPDO cycle and\n"
+            "      # displays the latency and jitter statistics\n";
+    cout << "  bus-load [--period US] [--bitrate KBPS] [--max-load PERCENT]\n"
+            "    [--axes N] [--heartbeat MS] [--sdo N] [--duration MS]\n"
+            "      # estimates the worst-case load of N axes configured like this\n"
+            "      # drive, with N SDO transactions per cycle, and rejects it if it\n"
+            "      # is above --max-load. Otherwise, measures the actual load of\n"
+            "      # the SYNC/TPDO cycle of this drive\n";
     cout << endl;
     return 1;
 }
@@ -38,6 +67,18 @@ const char* stateToString(StatusWord::State state)
     }
 }
 
+const char* nodeStateToString(canopen_master::NODE_STATE state)
+{
+    switch(state)
+    {
+        case canopen_master::NODE_INITIALIZING: return "INITIALIZING";
+        case canopen_master::NODE_STOPPED: return "STOPPED";
+        case canopen_master::NODE_OPERATIONAL: return "OPERATIONAL";
+        case canopen_master::NODE_PRE_OPERATIONAL: return "PRE_OPERATIONAL";
+        default: return "UNKNOWN";
+    }
+}
+
 ControlWord::Transition transitionFromString(std::string const& string)
 {
     if (string == "SHUTDOWN") return ControlWord::SHUTDOWN;
@@ -106,14 +147,174 @@ static void queryObject(canbus::Driver& device, canbus::Message const& query,
     }
 }
 
+static bool readMessage(canbus::Driver& device, canbus::Message& msg)
+{
+    // canbus drivers report read timeouts as exceptions
+    try {
+        msg = device.read();
+        return true;
+    }
+    catch(std::runtime_error const&) {
+        return false;
+    }
+}
+
+/** Run a batch of SDO transactions, and return the ones that failed */
+static std::vector<SDOResult> runSDOs(canbus::Driver& device,
+    std::vector<canbus::Message> const& query,
+    motors_elmo_ds402::Controller& controller,
+    base::Time timeout = base::Time::fromMilliseconds(100))
+{
+    SDOScheduler scheduler(timeout);
+    scheduler.push(query);
+    while (!scheduler.isDone())
+    {
+        for (auto const& msg : scheduler.poll(base::Time::now()))
+            device.write(msg);
+
+        base::Time deadline = scheduler.getNextDeadline();
+        base::Time remaining = deadline - base::Time::now();
+        device.setReadTimeout(std::max<int64_t>(1, remaining.toMilliseconds()));
+
+        canbus::Message msg;
+        if (readMessage(device, msg)) {
+            controller.process(msg);
+            SDOResult result = scheduler.process(msg, base::Time::now());
+            if (result.status == SDOResult::SUCCESS)
+                controller.recordSDORoundTrip(result.roundTrip);
+        }
+    }
+
+    return scheduler.getFailures();
+}
+
 static void queryObjects(canbus::Driver& device, std::vector<canbus::Message> const& query,
     motors_elmo_ds402::Controller& controller,
-    uint64_t updateId,
     base::Time timeout = base::Time::fromMilliseconds(100))
 {
-    for(auto const& msg : query) {
-        queryObject(device, msg, controller, updateId, timeout);
+    auto failures = runSDOs(device, query, controller, timeout);
+    if (!failures.empty()) {
+        auto const& failure = failures.front();
+        std::ostringstream message;
+        message << "SDO transaction on object 0x" << std::hex << failure.objectId
+            << "/" << static_cast<int>(failure.objectSubId);
+        if (failure.status == SDOResult::ABORTED)
+            message << " aborted with code 0x" << failure.abortCode;
+        else
+            message << " timed out";
+        throw std::runtime_error(message.str());
+    }
+}
+
+static void displayHistogram(std::string const& name, std::string const& unit,
+    HistogramSnapshot const& histogram)
+{
+    cout << "  " << left << setw(20) << name << right
+        << " n=" << setw(8) << histogram.count;
+    if (histogram.count) {
+        cout << " min=" << histogram.min << unit
+            << " mean=" << fixed << setprecision(1) << histogram.mean() << unit
+            << " p50<" << histogram.percentile(0.5) << unit
+            << " p99<" << histogram.percentile(0.99) << unit
+            << " max=" << histogram.max << unit;
     }
+    cout << "\n";
+}
+
+static void displayStatistics(ControllerStatisticsSnapshot const& stats)
+{
+    cout << "Latencies:\n";
+    displayHistogram("SDO round-trip", "us", stats.sdoRoundTrip);
+    displayHistogram("TPDO jitter", "us", stats.tpdoJitter);
+    displayHistogram("SYNC to TPDO", "us", stats.syncToPDOLatency);
+    displayHistogram("process()", "ns", stats.processTime);
+    cout << "Frames:\n"
+        << "  TPDO (fast path) " << stats.frames[FRAME_TPDO] << "\n"
+        << "  PDO              " << stats.frames[FRAME_PDO] << "\n"
+        << "  SDO              " << stats.frames[FRAME_SDO] << "\n"
+        << "  SDO ack          " << stats.frames[FRAME_SDO_ACK] << "\n"
+        << "  heartbeat        " << stats.frames[FRAME_HEARTBEAT] << "\n"
+        << "  emergency        " << stats.frames[FRAME_EMERGENCY] << "\n"
+        << "  other            " << stats.frames[FRAME_OTHER] << endl;
+}
+
+static void displaySyncStatistics(SyncProducerStatistics const& stats)
+{
+    cout << "SYNC producer:\n"
+        << "  cycles       " << stats.cycles << "\n"
+        << "  overruns     " << stats.overruns << "\n"
+        << "  write errors " << stats.writeErrors << "\n";
+    displayHistogram("wakeup latency", "us", stats.wakeupLatency);
+    displayHistogram("period jitter", "us", stats.periodJitter);
+    cout << flush;
+}
+
+static const char* loadSourceToString(BUS_LOAD_SOURCE source)
+{
+    switch(source)
+    {
+        case LOAD_SYNC: return "SYNC";
+        case LOAD_TPDO: return "TPDO";
+        case LOAD_RPDO: return "RPDO";
+        case LOAD_HEARTBEAT: return "heartbeat";
+        case LOAD_SDO: return "SDO";
+        case LOAD_OTHER: return "other";
+        default: return "";
+    }
+}
+
+static void displayBusLoadModel(BusLoadModel const& model)
+{
+    cout << "Worst-case load model:\n" << fixed << setprecision(1);
+    for (int i = 0; i < LOAD_SOURCE_COUNT; ++i) {
+        BUS_LOAD_SOURCE source = static_cast<BUS_LOAD_SOURCE>(i);
+        cout << "  " << left << setw(10) << loadSourceToString(source) << right
+            << setw(10) << model.getBitsPerCycle(source) << " bits/cycle\n";
+    }
+    cout << "  " << left << setw(10) << "total" << right
+        << setw(10) << model.getBitsPerCycle() << " bits/cycle\n"
+        << "  load " << model.getLoad() * 100 << "%" << endl;
+}
+
+static void displayBusLoadMeter(BusLoadMeter const& meter, int cycles)
+{
+    cout << "Measured load:\n" << fixed << setprecision(1);
+    for (int i = 0; i < LOAD_SOURCE_COUNT; ++i) {
+        BUS_LOAD_SOURCE source = static_cast<BUS_LOAD_SOURCE>(i);
+        cout << "  " << left << setw(10) << loadSourceToString(source) << right
+            << setw(10) << static_cast<double>(meter.getBitCount(source)) / cycles
+            << " bits/cycle\n";
+    }
+    cout << "  frames " << meter.getFrameCount() << "\n"
+        << "  load   " << meter.getLoad() * 100 << "% (last window), "
+        << meter.getPeakLoad() * 100 << "% (peak)" << endl;
+}
+
+/** Read the factors, and the joint limits if withLimits is set
+ *
+ * If cachePath is not empty, the cache is used when the serial number of
+ * the drive matches. Otherwise, both the factors and the limits are read
+ * and the cache is updated.
+ */
+static void readConfiguration(canbus::Driver& device, Controller& controller,
+    std::string const& cachePath, bool withLimits)
+{
+    if (!cachePath.empty()) {
+        queryObjects(device, { controller.querySerialNumber() }, controller);
+        FactorCache cache = FactorCache::load(cachePath);
+        if (cache.apply(controller))
+            return;
+
+        queryObjects(device, controller.queryFactors(), controller);
+        queryObjects(device, controller.queryJointLimits(), controller);
+        cache.store(controller);
+        cache.save(cachePath);
+        return;
+    }
+
+    queryObjects(device, controller.queryFactors(), controller);
+    if (withLimits)
+        queryObjects(device, controller.queryJointLimits(), controller);
 }
 
 struct Deinit
@@ -148,7 +349,26 @@ int main(int argc, char** argv)
     int8_t node_id(stoi(argv[3]));
     std::string cmd(argv[4]);
 
-    unique_ptr<canbus::Driver> device(canbus::openCanDevice(can_device, can_device_type));
+    std::string cache_path;
+    for (int i = 5; i < argc; ++i) {
+        if (string(argv[i]) != "--cache")
+            continue;
+        if (i + 1 >= argc)
+            return usage();
+        cache_path = argv[i + 1];
+        std::copy(argv + i + 2, argv + argc, argv + i);
+        argc -= 2;
+        break;
+    }
+
+    unique_ptr<canbus::Driver> device;
+    if (can_device_type == "sim") {
+        unique_ptr<SimulatedBus> bus(new SimulatedBus());
+        bus->addDrive(node_id);
+        device = std::move(bus);
+    }
+    else
+        device.reset(canbus::openCanDevice(can_device, can_device_type));
     DisplayStats stats(dynamic_cast<iodrivers_base::Driver*>(device.get()));
     Controller controller(node_id);
 
@@ -194,10 +414,8 @@ int main(int argc, char** argv)
             << "  targetReached       " << status.targetReached << "\n"
             << "  internalLimitActive " << status.internalLimitActive << std::endl;
 
-        queryObjects(*device, controller.queryFactors(),
-            controller, UPDATE_FACTORS);
-        queryObjects(*device, controller.queryJointState(),
-            controller, UPDATE_JOINT_STATE);
+        readConfiguration(*device, controller, cache_path, false);
+        queryObjects(*device, controller.queryJointState(), controller);
         auto jointState = controller.getJointState();
         cout << "Current joint state:\n" <<
             "  position " << jointState.position << "\n" <<
@@ -207,8 +425,7 @@ int main(int argc, char** argv)
     }
     else if (cmd == "get-config")
     {
-        queryObjects(*device, controller.queryFactors(),
-            controller, UPDATE_FACTORS);
+        readConfiguration(*device, controller, cache_path, true);
         Factors factors = controller.getFactors();
         cout << "Scale factors:\n"
             << "  encoder " << factors.encoderTicks <<
@@ -220,8 +437,6 @@ int main(int argc, char** argv)
             << "  ratedTorque  " << factors.ratedTorque << "\n"
             << "  ratedCurrent " << factors.ratedCurrent << endl;
 
-        queryObjects(*device, controller.queryJointLimits(),
-            controller, UPDATE_JOINT_LIMITS);
         auto jointLimits = controller.getJointLimits();
         cout << "Current joint limits:\n" <<
             "  position     [" << jointLimits.min.position << ", " << jointLimits.max.position << "]\n" <<
@@ -250,29 +465,123 @@ int main(int argc, char** argv)
             return usage();
         writeObject(*device, controller.queryLoad(), controller);
     }
+    else if (cmd == "scan")
+    {
+        if (argc != 5)
+            return usage();
+
+        BusScanner scanner;
+        while (!interrupted && !scanner.isDone(base::Time::now()))
+        {
+            for (auto const& msg : scanner.poll(base::Time::now()))
+                device->write(msg);
+
+            base::Time remaining = scanner.getNextDeadline() - base::Time::now();
+            device->setReadTimeout(std::max<int64_t>(1, remaining.toMilliseconds()));
+            canbus::Message msg;
+            if (readMessage(*device, msg))
+                scanner.process(msg);
+        }
+
+        cout << setw(4) << "ID" << " "
+            << setw(10) << "DeviceType" << " "
+            << setw(10) << "Serial" << " "
+            << setw(6) << "PAL" << " "
+            << "State" << "\n";
+        for (auto const& node : scanner.getNodes()) {
+            cout << dec << setfill(' ') << setw(4) << static_cast<int>(node.nodeId) << hex << setfill('0');
+            if (node.hasDeviceType)
+                cout << "   " << setw(8) << node.deviceType;
+            else
+                cout << setfill(' ') << setw(11) << "?" << setfill('0');
+            if (node.hasSerialNumber)
+                cout << "   " << setw(8) << node.serialNumber;
+            else
+                cout << setfill(' ') << setw(11) << "?" << setfill('0');
+            if (node.hasPALVersion)
+                cout << "   " << setw(4) << node.palVersion;
+            else
+                cout << setfill(' ') << setw(7) << "?" << setfill('0');
+            cout << " " << (node.hasNodeState ? nodeStateToString(node.nodeState) : "?") << "\n";
+        }
+        cout << dec << setfill(' ') << scanner.getNodes().size() << " node(s) found" << endl;
+    }
+    else if (cmd == "snapshot")
+    {
+        if (argc != 6)
+            return usage();
+
+        auto failures = runSDOs(*device, ConfigurationSnapshot::queryAll(controller), controller);
+        ConfigurationSnapshot snapshot = ConfigurationSnapshot::capture(controller);
+        snapshot.save(argv[5]);
+        cout << "saved " << snapshot.size() << " objects";
+        if (!failures.empty())
+            cout << ", " << failures.size() << " could not be read";
+        cout << endl;
+    }
+    else if (cmd == "restore")
+    {
+        if (argc != 6)
+            return usage();
+
+        ConfigurationSnapshot snapshot = ConfigurationSnapshot::load(argv[5]);
+        // Objects that cannot be read are downloaded unconditionally
+        runSDOs(*device, snapshot.queryCurrent(controller), controller);
+        auto downloads = snapshot.queryRestore(controller);
+        queryObjects(*device, downloads, controller);
+        if (!downloads.empty())
+            writeObject(*device, controller.querySave(), controller);
+        if (!downloads.empty() && !cache_path.empty()) {
+            // The restored objects may be cached ones
+            FactorCache cache = FactorCache::load(cache_path);
+            cache.erase(controller.getNodeId());
+            cache.save(cache_path);
+        }
+        cout << downloads.size() << " of " << snapshot.size()
+            << " objects differed and were restored" << endl;
+    }
     else if (cmd == "monitor-joint-state")
     {
-        queryObjects(*device, controller.queryFactors(),
-            controller, UPDATE_FACTORS);
         bool use_sync = true;
-        vector<canbus::Message> pdoSetup;
-        if (argc == 7) {
-            if (string(argv[5]) == "--time") {
+        base::Time pdoPeriod;
+        SyncProducer::Configuration syncConfiguration;
+        bool use_sync_producer = false;
+        for (int i = 5; i < argc; i += 2) {
+            if (i + 1 >= argc)
+                return usage();
+            else if (string(argv[i]) == "--time") {
                 use_sync = false;
-                pdoSetup = controller.queryPeriodicJointStateUpdate(
-                    0, base::Time::fromMilliseconds(atoi(argv[6])));
-                }
+                pdoPeriod = base::Time::fromMilliseconds(atoi(argv[i + 1]));
+            }
+            else if (string(argv[i]) == "--sync-period") {
+                use_sync_producer = true;
+                syncConfiguration.period = base::Time::fromMicroseconds(atoi(argv[i + 1]));
+            }
+            else if (string(argv[i]) == "--sync-priority")
+                syncConfiguration.priority = atoi(argv[i + 1]);
+            else if (string(argv[i]) == "--sync-cpu")
+                syncConfiguration.cpu = atoi(argv[i + 1]);
             else {
                 std::cerr << "Invalid argument to 'monitor-joint-state'" << std::endl;
                 return usage();
             }
         }
-        else if (argc != 5) {
+        if (use_sync_producer && !use_sync) {
+            std::cerr << "--time and --sync-period are mutually exclusive" << std::endl;
             return usage();
         }
-        else {
-            pdoSetup = controller.queryPeriodicJointStateUpdate(0, 1);
+        if (use_sync_producer && can_device_type == "sim") {
+            std::cerr << "--sync-period requires a device that can be read and "
+                "written from separate threads, which the simulated bus is not" << std::endl;
+            return 1;
         }
+
+        readConfiguration(*device, controller, cache_path, false);
+        vector<canbus::Message> pdoSetup;
+        if (use_sync)
+            pdoSetup = controller.queryPeriodicJointStateUpdate(0, 1);
+        else
+            pdoSetup = controller.queryPeriodicJointStateUpdate(0, pdoPeriod);
         device->write(controller.queryNodeStateTransition(
             canopen_master::NODE_ENTER_PRE_OPERATIONAL));
         writeObjects(*device, pdoSetup, controller);
@@ -281,7 +590,14 @@ int main(int argc, char** argv)
         device->setReadTimeout(1500);
 
         canbus::Message sync = controller.querySync();
-        if (use_sync)
+        unique_ptr<SyncProducer> syncProducer;
+        if (use_sync_producer) {
+            syncProducer.reset(new SyncProducer(*device, sync, syncConfiguration));
+            syncProducer->start();
+            if (!syncProducer->isRealTime())
+                std::cerr << "could not apply the SYNC thread's priority or affinity" << std::endl;
+        }
+        else if (use_sync)
             device->write(sync);
 
         cout << setw(10) << "Position" << " "
@@ -290,27 +606,192 @@ int main(int argc, char** argv)
             << setw(10) << "Current" << endl;
 
         Update state;
+        base::Time lastSync;
         while(true)
         {
             state = Update();
-            if (use_sync)
+            if (use_sync && !syncProducer) {
                 device->write(sync);
+                controller.notifySync(base::Time::now());
+            }
 
             while (!interrupted && !state.isUpdated(UPDATE_JOINT_STATE))
             {
-                canbus::Message msg = device->read();
+                canbus::Message msg;
+                if (!readMessage(*device, msg))
+                    continue;
+                if (syncProducer) {
+                    base::Time syncTime = syncProducer->getLastSyncTime();
+                    if (syncTime != lastSync) {
+                        controller.notifySync(syncTime);
+                        lastSync = syncTime;
+                    }
+                }
                 state.merge(controller.process(msg));
             }
 
             if (interrupted)
                 break;
 
-            base::JointState jointState = controller.getJointState();
+            base::JointState jointState =
+                controller.getJointState(controller.getJointStateFields());
             cout << setw(10) << jointState.position << " "
                 << setw(10) << jointState.speed << " "
                 << setw(10) << jointState.effort << " "
                 << setw(10) << jointState.raw << endl;
         }
+
+        if (syncProducer) {
+            syncProducer->stop();
+            displaySyncStatistics(syncProducer->getStatistics());
+        }
+    }
+    else if (cmd == "stats")
+    {
+        base::Time duration = base::Time::fromMilliseconds(5000);
+        base::Time period = base::Time::fromMilliseconds(10);
+        for (int i = 5; i < argc; i += 2) {
+            if (i + 1 >= argc)
+                return usage();
+            else if (string(argv[i]) == "--duration")
+                duration = base::Time::fromMilliseconds(atoi(argv[i + 1]));
+            else if (string(argv[i]) == "--period")
+                period = base::Time::fromMilliseconds(atoi(argv[i + 1]));
+            else
+                return usage();
+        }
+
+        readConfiguration(*device, controller, cache_path, false);
+        auto pdoSetup = controller.queryPeriodicJointStateUpdate(0, 1);
+        device->write(controller.queryNodeStateTransition(
+            canopen_master::NODE_ENTER_PRE_OPERATIONAL));
+        writeObjects(*device, pdoSetup, controller);
+        device->write(controller.queryNodeStateTransition(
+            canopen_master::NODE_START));
+        controller.clearStatistics();
+
+        // Poll the status word through SDOs every 10 cycles, to measure the
+        // SDO round-trip alongside the PDO traffic
+        canbus::Message sync = controller.querySync();
+        base::Time end = base::Time::now() + duration;
+        base::Time nextSync = base::Time::now();
+        int cycle = 0;
+        while (!interrupted && base::Time::now() < end)
+        {
+            if (cycle++ % 10 == 0)
+                queryObjects(*device, { controller.queryStatusWord() }, controller);
+
+            device->write(sync);
+            controller.notifySync(base::Time::now());
+            nextSync = nextSync + period;
+
+            base::Time now;
+            while (!interrupted && (now = base::Time::now()) < nextSync)
+            {
+                device->setReadTimeout(std::max<int64_t>(1, (nextSync - now).toMilliseconds()));
+                canbus::Message msg;
+                if (readMessage(*device, msg))
+                    controller.process(msg);
+            }
+        }
+        displayStatistics(controller.getStatistics().snapshot());
+    }
+    else if (cmd == "bus-load")
+    {
+        BusLoadModel::Configuration modelConfiguration;
+        base::Time duration = base::Time::fromMilliseconds(2000);
+        int axes = 1;
+        int heartbeat = 0;
+        double sdoPerCycle = 0.1;
+        for (int i = 5; i < argc; i += 2) {
+            if (i + 1 >= argc)
+                return usage();
+            else if (string(argv[i]) == "--period")
+                modelConfiguration.syncPeriod = base::Time::fromMicroseconds(atoi(argv[i + 1]));
+            else if (string(argv[i]) == "--bitrate")
+                modelConfiguration.bitrate = atoi(argv[i + 1]) * 1000;
+            else if (string(argv[i]) == "--max-load")
+                modelConfiguration.maxLoad = atof(argv[i + 1]) / 100;
+            else if (string(argv[i]) == "--axes")
+                axes = atoi(argv[i + 1]);
+            else if (string(argv[i]) == "--heartbeat")
+                heartbeat = atoi(argv[i + 1]);
+            else if (string(argv[i]) == "--sdo")
+                sdoPerCycle = atof(argv[i + 1]);
+            else if (string(argv[i]) == "--duration")
+                duration = base::Time::fromMilliseconds(atoi(argv[i + 1]));
+            else
+                return usage();
+        }
+        if (axes < 1 || node_id + axes - 1 > 127) {
+            std::cerr << "--axes must leave the node IDs within [1, 127]" << std::endl;
+            return usage();
+        }
+
+        // Model the axes on consecutive node IDs, starting with this drive
+        BusLoadModel model(modelConfiguration);
+        for (int i = 0; i < axes; ++i) {
+            Controller axis(node_id + i);
+            model.addConfiguration(axis.queryPeriodicJointStateUpdate(0, 1));
+            if (heartbeat)
+                model.addConfiguration({ axis.sendRawObject(
+                    getObjectInfo<ProducerHeartbeatTime>(), heartbeat) });
+        }
+        model.addSDOTraffic(sdoPerCycle);
+        displayBusLoadModel(model);
+        try {
+            model.validate();
+        }
+        catch(BusOverloaded const& e) {
+            std::cerr << "configuration rejected: " << e.what() << std::endl;
+            return 1;
+        }
+
+        auto pdoSetup = controller.queryPeriodicJointStateUpdate(0, 1);
+        if (heartbeat)
+            pdoSetup.push_back(controller.sendRawObject(
+                getObjectInfo<ProducerHeartbeatTime>(), heartbeat));
+        device->write(controller.queryNodeStateTransition(
+            canopen_master::NODE_ENTER_PRE_OPERATIONAL));
+        writeObjects(*device, pdoSetup, controller);
+        device->write(controller.queryNodeStateTransition(
+            canopen_master::NODE_START));
+
+        BusLoadMeter::Configuration meterConfiguration;
+        meterConfiguration.bitrate = modelConfiguration.bitrate;
+        BusLoadMeter meter(meterConfiguration);
+        canbus::Message sync = controller.querySync();
+        base::Time end = base::Time::now() + duration;
+        base::Time nextSync = base::Time::now();
+        double sdoCredit = 0;
+        int cycles = 0;
+        while (!interrupted && base::Time::now() < end)
+        {
+            device->write(sync);
+            meter.add(sync, base::Time::now());
+            sdoCredit += sdoPerCycle;
+            if (sdoCredit >= 1) {
+                canbus::Message query = controller.queryStatusWord();
+                device->write(query);
+                meter.add(query, base::Time::now());
+                sdoCredit -= 1;
+            }
+            nextSync = nextSync + modelConfiguration.syncPeriod;
+            ++cycles;
+
+            base::Time now;
+            while (!interrupted && (now = base::Time::now()) < nextSync)
+            {
+                device->setReadTimeout(std::max<int64_t>(1, (nextSync - now).toMilliseconds()));
+                canbus::Message msg;
+                if (readMessage(*device, msg)) {
+                    meter.add(msg, base::Time::now());
+                    controller.process(msg);
+                }
+            }
+            meter.update(base::Time::now());
+        }
+        displayBusLoadMeter(meter, std::max(1, cycles));
     }
     return 0;
 }
@@ -0,0 +1,65 @@
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+#include <type_traits>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+#define MOTORS_ELMO_DS402_FULL_ID(object_id, object_sub_id, name, type, update_id) \
+    (static_cast<uint32_t>(object_id) << 8 | object_sub_id),
+
+static constexpr uint32_t FULL_IDS[] = {
+    MOTORS_ELMO_DS402_OBJECT_LIST(
+        MOTORS_ELMO_DS402_FULL_ID,
+        MOTORS_ELMO_DS402_FULL_ID,
+        MOTORS_ELMO_DS402_FULL_ID)
+};
+
+static constexpr bool isSorted(uint32_t const* ids, size_t size)
+{
+    return size < 2 || (ids[0] < ids[1] && isSorted(ids + 1, size - 1));
+}
+
+static_assert(sizeof(FULL_IDS) / sizeof(FULL_IDS[0]) == OBJECT_COUNT,
+    "OBJECT_COUNT does not match the object list");
+static_assert(isSorted(FULL_IDS, OBJECT_COUNT),
+    "the entries of MOTORS_ELMO_DS402_OBJECT_LIST must be sorted by ID and sub-ID");
+
+#define MOTORS_ELMO_DS402_OBJECT_INFO(access, object_id, object_sub_id, name, type, update_id) \
+    { object_id, object_sub_id, sizeof(type), std::is_signed<type>::value, \
+      access, update_id, #name },
+#define MOTORS_ELMO_DS402_RO_OBJECT_INFO(...) \
+    MOTORS_ELMO_DS402_OBJECT_INFO(ACCESS_RO, __VA_ARGS__)
+#define MOTORS_ELMO_DS402_WO_OBJECT_INFO(...) \
+    MOTORS_ELMO_DS402_OBJECT_INFO(ACCESS_WO, __VA_ARGS__)
+#define MOTORS_ELMO_DS402_RW_OBJECT_INFO(...) \
+    MOTORS_ELMO_DS402_OBJECT_INFO(ACCESS_RW, __VA_ARGS__)
+
+namespace motors_elmo_ds402
+{
+    ObjectInfo const OBJECT_REGISTRY[OBJECT_COUNT] = {
+        MOTORS_ELMO_DS402_OBJECT_LIST(
+            MOTORS_ELMO_DS402_RO_OBJECT_INFO,
+            MOTORS_ELMO_DS402_WO_OBJECT_INFO,
+            MOTORS_ELMO_DS402_RW_OBJECT_INFO)
+    };
+}
+
+ObjectInfo const* motors_elmo_ds402::findObject(uint16_t objectId, uint8_t objectSubId)
+{
+    uint32_t fullId = static_cast<uint32_t>(objectId) << 8 | objectSubId;
+
+    size_t begin = 0;
+    size_t end = OBJECT_COUNT;
+    while (begin < end)
+    {
+        size_t middle = (begin + end) / 2;
+        uint32_t middleId = FULL_IDS[middle];
+        if (middleId == fullId)
+            return &OBJECT_REGISTRY[middle];
+        else if (middleId < fullId)
+            begin = middle + 1;
+        else
+            end = middle;
+    }
+    return nullptr;
+}
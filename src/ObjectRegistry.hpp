@@ -0,0 +1,101 @@
+#ifndef MOTORS_ELMO_DS402_OBJECT_REGISTRY_HPP
+#define MOTORS_ELMO_DS402_OBJECT_REGISTRY_HPP
+
+#include <cstddef>
+#include <motors_elmo_ds402/Objects.hpp>
+
+namespace motors_elmo_ds402
+{
+    enum OBJECT_ACCESS
+    {
+        ACCESS_RO = 1,
+        ACCESS_WO = 2,
+        ACCESS_RW = ACCESS_RO | ACCESS_WO
+    };
+
+    /** Description of one of the objects defined in Objects.hpp */
+    struct ObjectInfo
+    {
+        uint16_t objectId;
+        uint8_t objectSubId;
+        /** Size of the object's type in bytes */
+        uint8_t size;
+        /** Whether the object's type is a signed integer */
+        bool isSigned;
+        OBJECT_ACCESS access;
+        /** The UPDATE_ID of the object, or zero if it has none */
+        uint64_t updateId;
+        char const* name;
+
+        uint32_t getFullId() const
+        {
+            return static_cast<uint32_t>(objectId) << 8 | objectSubId;
+        }
+        bool isReadable() const { return access & ACCESS_RO; }
+        bool isWritable() const { return access & ACCESS_WO; }
+    };
+
+    #define MOTORS_ELMO_DS402_COUNT_OBJECT(object_id, object_sub_id, name, type, update_id) + 1
+
+    /** Number of objects in the registry */
+    static const size_t OBJECT_COUNT = 0 MOTORS_ELMO_DS402_OBJECT_LIST(
+        MOTORS_ELMO_DS402_COUNT_OBJECT,
+        MOTORS_ELMO_DS402_COUNT_OBJECT,
+        MOTORS_ELMO_DS402_COUNT_OBJECT);
+
+    #define MOTORS_ELMO_DS402_OBJECT_INDEX(object_id, object_sub_id, name, type, update_id) \
+        OBJECT_INDEX_##name,
+
+    /** Index of each object in OBJECT_REGISTRY */
+    enum OBJECT_INDEXES
+    {
+        MOTORS_ELMO_DS402_OBJECT_LIST(
+            MOTORS_ELMO_DS402_OBJECT_INDEX,
+            MOTORS_ELMO_DS402_OBJECT_INDEX,
+            MOTORS_ELMO_DS402_OBJECT_INDEX)
+    };
+
+    /** Compile-time access to the index of an object in OBJECT_REGISTRY
+     *
+     * ObjectIndex<T>::value is the index of T
+     */
+    template<typename T> struct ObjectIndex;
+
+    #define MOTORS_ELMO_DS402_OBJECT_INDEX_TRAIT(object_id, object_sub_id, name, type, update_id) \
+        template<> struct ObjectIndex<name> { \
+            static const size_t value = OBJECT_INDEX_##name; \
+        };
+
+    MOTORS_ELMO_DS402_OBJECT_LIST(
+        MOTORS_ELMO_DS402_OBJECT_INDEX_TRAIT,
+        MOTORS_ELMO_DS402_OBJECT_INDEX_TRAIT,
+        MOTORS_ELMO_DS402_OBJECT_INDEX_TRAIT)
+
+    /** The registry of all objects defined in Objects.hpp
+     *
+     * It has OBJECT_COUNT entries sorted by object ID and sub-ID
+     */
+    extern ObjectInfo const OBJECT_REGISTRY[OBJECT_COUNT];
+
+    /** Returns the registry entry of the given object, or NULL if it is not
+     * defined in Objects.hpp
+     *
+     * This is a binary search in the registry, i.e. at most 7 comparisons
+     */
+    ObjectInfo const* findObject(uint16_t objectId, uint8_t objectSubId);
+
+    /** Returns the registry entry of the object T */
+    template<typename T>
+    ObjectInfo const& getObjectInfo()
+    {
+        return OBJECT_REGISTRY[ObjectIndex<T>::value];
+    }
+
+    /** Returns the index of a registry entry in OBJECT_REGISTRY */
+    inline size_t getObjectIndex(ObjectInfo const& info)
+    {
+        return &info - OBJECT_REGISTRY;
+    }
+}
+
+#endif
@@ -50,7 +50,7 @@ namespace motors_elmo_ds402
                 word = 0x07;
                 break;
             case ControlWord::FAULT_RESET:
-                word = 0x10;
+                word = 0x80;
                 break;
         }
 
@@ -60,6 +60,12 @@ namespace motors_elmo_ds402
         return word;
     }
 
+    template<>
+    int8_t encode<OperationMode, int8_t>(OperationMode const& value)
+    {
+        return value.mode;
+    }
+
     template<>
     StatusWord parse<StatusWord, uint16_t>(uint16_t word)
     {
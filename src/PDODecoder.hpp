@@ -0,0 +1,129 @@
+#ifndef MOTORS_ELMO_DS402_PDO_DECODER_HPP
+#define MOTORS_ELMO_DS402_PDO_DECODER_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <canbus/Message.hpp>
+
+namespace motors_elmo_ds402 {
+    /**
+     * Decoding plan for a TPDO whose mapping is known at configuration time
+     *
+     * It copies each mapped object from the frame straight into a raw sample
+     * structure, without going through the canopen_master object dictionary.
+     * The target fields are given by their byte offsets in the structure,
+     * and must have the same size than the mapped object.
+     */
+    struct PDODecoder
+    {
+        /** Maximum number of entries, including aliases */
+        static const int MAX_ENTRIES = 16;
+
+        struct Entry
+        {
+            uint8_t frameOffset;
+            uint8_t size;
+            uint16_t targetOffset;
+        };
+
+        /** The update flags that a received frame generates */
+        uint64_t updateId = 0;
+        /** Expected frame size */
+        uint8_t frameSize = 0;
+        uint8_t entryCount = 0;
+        Entry entries[MAX_ENTRIES];
+
+        bool empty() const
+        {
+            return entryCount == 0;
+        }
+
+        void clear()
+        {
+            updateId = 0;
+            frameSize = 0;
+            entryCount = 0;
+        }
+
+        /** Add an object after the ones already mapped
+         *
+         * @param size the object size, in bytes (1, 2 or 4)
+         * @param targetOffset the offset of the target field in the sample
+         * @param updateId the update flags of the object
+         */
+        void add(uint8_t size, uint16_t targetOffset, uint64_t updateId)
+        {
+            if (frameSize + size > 8)
+                throw std::invalid_argument("PDO mapping exceeds 8 bytes");
+            if (entryCount == MAX_ENTRIES)
+                throw std::invalid_argument("too many entries in PDODecoder");
+            if (size != 1 && size != 2 && size != 4)
+                throw std::invalid_argument("PDODecoder only supports objects of 1, 2 or 4 bytes");
+
+            Entry entry = { frameSize, size, targetOffset };
+            entries[entryCount++] = entry;
+            frameSize += size;
+            this->updateId |= updateId;
+        }
+
+        /** Decode the last added object into a second field as well */
+        void addAlias(uint16_t targetOffset)
+        {
+            if (entryCount == 0)
+                throw std::logic_error("PDODecoder::addAlias called on an empty decoder");
+            if (entryCount == MAX_ENTRIES)
+                throw std::invalid_argument("too many entries in PDODecoder");
+
+            Entry entry = entries[entryCount - 1];
+            entry.targetOffset = targetOffset;
+            entries[entryCount++] = entry;
+        }
+
+        /** Decode a PDO frame into the given sample
+         *
+         * Returns the update flags, or zero if the frame is too short for
+         * the mapping
+         */
+        uint64_t decode(canbus::Message const& msg, uint8_t* target) const
+        {
+            if (msg.size < frameSize)
+                return 0;
+
+            uint8_t const* data = msg.data;
+            for (int i = 0; i < entryCount; ++i)
+            {
+                Entry const& entry = entries[i];
+                uint8_t const* bytes = data + entry.frameOffset;
+                uint8_t* field = target + entry.targetOffset;
+                // CANOpen is little endian. Assemble explicitly so that this
+                // is independent of the host byte order
+                switch(entry.size)
+                {
+                    case 1:
+                        *field = bytes[0];
+                        break;
+                    case 2:
+                    {
+                        uint16_t value = static_cast<uint16_t>(bytes[0]) |
+                            static_cast<uint16_t>(bytes[1]) << 8;
+                        std::memcpy(field, &value, 2);
+                        break;
+                    }
+                    case 4:
+                    {
+                        uint32_t value = static_cast<uint32_t>(bytes[0]) |
+                            static_cast<uint32_t>(bytes[1]) << 8 |
+                            static_cast<uint32_t>(bytes[2]) << 16 |
+                            static_cast<uint32_t>(bytes[3]) << 24;
+                        std::memcpy(field, &value, 4);
+                        break;
+                    }
+                }
+            }
+            return updateId;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,21 @@
+#include <motors_elmo_ds402/RealTime.hpp>
+#include <pthread.h>
+#include <sched.h>
+
+bool motors_elmo_ds402::setCurrentThreadAffinity(int cpu)
+{
+    if (cpu < 0 || cpu >= CPU_SETSIZE)
+        return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+bool motors_elmo_ds402::setCurrentThreadFIFOPriority(int priority)
+{
+    sched_param param;
+    param.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0;
+}
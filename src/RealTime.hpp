@@ -0,0 +1,20 @@
+#ifndef MOTORS_ELMO_DS402_REAL_TIME_HPP
+#define MOTORS_ELMO_DS402_REAL_TIME_HPP
+
+namespace motors_elmo_ds402 {
+    /** Pin the calling thread to the given CPU
+     *
+     * @return false if the affinity could not be changed
+     */
+    bool setCurrentThreadAffinity(int cpu);
+
+    /** Switch the calling thread to the SCHED_FIFO policy with the given
+     * priority
+     *
+     * @return false if the scheduling could not be changed, usually because
+     *   the process lacks CAP_SYS_NICE or an RLIMIT_RTPRIO allowance
+     */
+    bool setCurrentThreadFIFOPriority(int priority);
+}
+
+#endif
@@ -0,0 +1,218 @@
+#include <motors_elmo_ds402/ReceiveEngine.hpp>
+#include <motors_elmo_ds402/RealTime.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+/** Updates that trigger a publication */
+static const uint64_t PUBLISHED_UPDATES = UPDATE_JOINT_STATE | UPDATE_STATUS_WORD;
+
+/** Maximum time the processing thread sleeps without being notified, which
+ * bounds the effect of a missed wakeup
+ */
+static const chrono::milliseconds MAX_PROCESSING_SLEEP(10);
+
+ReceiveEngine::ReceiveEngine(canbus::Driver& device, BusController& bus,
+    Configuration const& configuration)
+    : mDevice(device)
+    , mBus(bus)
+    , mConfiguration(configuration)
+    , mRunning(false)
+    , mIntakeDone(false)
+    , mRealTimeFailed(false)
+    , mOverruns(0)
+    , mProcessingErrors(0)
+    , mProcessed(0)
+    , mRing(new SPSCRing<canbus::Message, RING_SIZE>())
+    , mStates(new SeqLock<PublishedNodeState>[BusUpdate::MAX_NODES])
+    , mPendingUpdates()
+    , mReceivedUpdates()
+    , mProcessingWaiting(false)
+{
+}
+
+ReceiveEngine::~ReceiveEngine()
+{
+    stop();
+}
+
+void ReceiveEngine::start()
+{
+    if (isRunning())
+        throw std::logic_error("ReceiveEngine::start: already running");
+
+    mDevice.setReadTimeout(mConfiguration.readTimeout.toMilliseconds());
+    mRealTimeFailed = false;
+    mIntakeDone = false;
+    mRunning = true;
+
+    promise<void> processingSetup;
+    future<void> processingSetupDone = processingSetup.get_future();
+    promise<void> intakeSetup;
+    future<void> intakeSetupDone = intakeSetup.get_future();
+    mProcessingThread = thread(&ReceiveEngine::runProcessing, this,
+        std::move(processingSetup));
+    mIntakeThread = thread(&ReceiveEngine::runIntake, this, std::move(intakeSetup));
+    processingSetupDone.wait();
+    intakeSetupDone.wait();
+}
+
+void ReceiveEngine::stop()
+{
+    mRunning = false;
+    if (mIntakeThread.joinable())
+        mIntakeThread.join();
+    if (mProcessingThread.joinable())
+    {
+        mWakeup.notify_one();
+        mProcessingThread.join();
+    }
+}
+
+bool ReceiveEngine::isRunning() const
+{
+    return mRunning;
+}
+
+bool ReceiveEngine::isRealTime() const
+{
+    return !mRealTimeFailed;
+}
+
+bool ReceiveEngine::getNodeState(uint8_t nodeId, PublishedNodeState& state) const
+{
+    if (nodeId >= BusUpdate::MAX_NODES)
+        return false;
+    return mStates[nodeId].load(state);
+}
+
+uint64_t ReceiveEngine::getOverrunCount() const
+{
+    return mOverruns.load(memory_order_relaxed);
+}
+
+uint64_t ReceiveEngine::getProcessingErrorCount() const
+{
+    return mProcessingErrors.load(memory_order_relaxed);
+}
+
+uint64_t ReceiveEngine::getProcessedCount() const
+{
+    return mProcessed.load(memory_order_relaxed);
+}
+
+void ReceiveEngine::setupThread(int cpu, promise<void>& setup)
+{
+    bool success = true;
+    if (cpu >= 0)
+        success = setCurrentThreadAffinity(cpu) && success;
+    if (mConfiguration.priority > 0)
+        success = setCurrentThreadFIFOPriority(mConfiguration.priority) && success;
+    if (!success)
+        mRealTimeFailed = true;
+    setup.set_value();
+}
+
+void ReceiveEngine::runIntake(promise<void> setup)
+{
+    setupThread(mConfiguration.intakeCPU, setup);
+
+    while (mRunning.load(memory_order_relaxed))
+    {
+        canbus::Message msg;
+        try {
+            msg = mDevice.read();
+        }
+        catch(std::runtime_error const&) {
+            // canbus drivers report read timeouts as exceptions
+            continue;
+        }
+
+        if (!mRing->push(msg))
+            mOverruns.store(mOverruns.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        else if (mProcessingWaiting.load())
+        {
+            lock_guard<mutex> lock(mWakeupMutex);
+            mWakeup.notify_one();
+        }
+    }
+
+    mIntakeDone = true;
+    lock_guard<mutex> lock(mWakeupMutex);
+    mWakeup.notify_one();
+}
+
+void ReceiveEngine::runProcessing(promise<void> setup)
+{
+    setupThread(mConfiguration.processingCPU, setup);
+
+    canbus::Message msg;
+    while (true)
+    {
+        if (!mRing->pop(msg))
+        {
+            if (mIntakeDone)
+                return;
+
+            // Announce that we are going to sleep before checking the ring
+            // again, so that the intake thread either sees the flag or we
+            // see its frame
+            unique_lock<mutex> lock(mWakeupMutex);
+            mProcessingWaiting = true;
+            if (mRing->empty() && !mIntakeDone)
+                mWakeup.wait_for(lock, MAX_PROCESSING_SLEEP);
+            mProcessingWaiting = false;
+            continue;
+        }
+
+        // A single bad frame (e.g. an SDO abort, which canopen_master
+        // reports as an exception) must not terminate the thread
+        try {
+            NodeUpdate update = mBus.process(msg);
+            mProcessed.store(mProcessed.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            if (update.isValid())
+                publish(update.nodeId, update.update, msg.time);
+        }
+        catch(std::exception const&) {
+            mProcessingErrors.store(
+                mProcessingErrors.load(memory_order_relaxed) + 1, memory_order_relaxed);
+        }
+    }
+}
+
+void ReceiveEngine::publish(uint8_t nodeId, Update const& update, base::Time const& time)
+{
+    uint64_t& pending = mPendingUpdates[nodeId];
+    pending |= update.getUpdatedObjects();
+    mReceivedUpdates[nodeId] |= update.getUpdatedObjects();
+    if (!(update.getUpdatedObjects() & PUBLISHED_UPDATES))
+        return;
+
+    Controller const& controller = mBus.get(nodeId);
+    PublishedNodeState state;
+    state.time = time;
+    state.jointState = controller.getJointState(controller.getJointStateFields());
+    state.updateId = pending;
+    state.hasStatusWord = false;
+    if (mReceivedUpdates[nodeId] & UPDATE_STATUS_WORD)
+    {
+        try {
+            state.statusWord = controller.getStatusWord();
+            state.hasStatusWord = true;
+        }
+        catch(StatusWord::UnknownState const&) {
+            // Publish the joint state nonetheless, with the last valid
+            // status word
+        }
+    }
+
+    PublishedNodeState previous;
+    if (!state.hasStatusWord && mStates[nodeId].load(previous) && previous.hasStatusWord)
+    {
+        state.statusWord = previous.statusWord;
+        state.hasStatusWord = true;
+    }
+
+    mStates[nodeId].store(state);
+    pending = 0;
+}
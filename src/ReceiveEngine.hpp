@@ -0,0 +1,161 @@
+#ifndef MOTORS_ELMO_DS402_RECEIVE_ENGINE_HPP
+#define MOTORS_ELMO_DS402_RECEIVE_ENGINE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <canbus/Driver.hpp>
+#include <motors_elmo_ds402/BusController.hpp>
+#include <motors_elmo_ds402/SPSCRing.hpp>
+#include <motors_elmo_ds402/SeqLock.hpp>
+
+namespace motors_elmo_ds402 {
+    /** State of a node as published by ReceiveEngine */
+    struct PublishedNodeState
+    {
+        /** Reception time of the frame that triggered the publication */
+        base::Time time;
+        /** Fields that have never been received are left unknown */
+        base::JointState jointState;
+        StatusWord statusWord;
+        /** Whether statusWord has been received at least once */
+        bool hasStatusWord;
+        /** Update flags accumulated since the previous publication */
+        uint64_t updateId;
+
+        PublishedNodeState()
+            : statusWord(StatusWord::NOT_READY_TO_SWITCH_ON, false, false, false, false)
+            , hasStatusWord(false)
+            , updateId(0) {}
+    };
+
+    /** Optional receive path that keeps frame intake independent of the
+     * consumers
+     *
+     * An intake thread drains the CAN device into a lock-free SPSC ring.
+     * A processing thread pops the frames, runs them through the
+     * BusController and publishes the latest joint state and status word of
+     * each node through a SeqLock. Any number of threads can then read a
+     * consistent state with getNodeState, without ever blocking the
+     * processing.
+     *
+     * While the engine runs, the BusController and its controllers belong
+     * to the processing thread. The device is only read by the intake
+     * thread: it must support being written from another thread at the
+     * same time, which is the case of the socket-based canbus drivers.
+     */
+    class ReceiveEngine
+    {
+    public:
+        static const int RING_SIZE = 1024;
+
+        struct Configuration
+        {
+            /** CPU the intake thread is pinned to, or -1 */
+            int intakeCPU;
+            /** CPU the processing thread is pinned to, or -1 */
+            int processingCPU;
+            /** SCHED_FIFO priority of both threads, or 0 to keep the
+             * default scheduling
+             */
+            int priority;
+            /** Read timeout of the device, which bounds the time stop()
+             * takes
+             */
+            base::Time readTimeout;
+
+            Configuration()
+                : intakeCPU(-1)
+                , processingCPU(-1)
+                , priority(0)
+                , readTimeout(base::Time::fromMilliseconds(100)) {}
+        };
+
+        ReceiveEngine(canbus::Driver& device, BusController& bus,
+            Configuration const& configuration = Configuration());
+        ~ReceiveEngine();
+
+        /** Start the intake and processing threads
+         *
+         * It returns once both threads have applied their affinity and
+         * priority
+         *
+         * @throws std::logic_error if the engine is already running
+         */
+        void start();
+
+        /** Stop the threads, after the frames already in the ring have been
+         * processed
+         */
+        void stop();
+
+        bool isRunning() const;
+
+        /** Whether the threads got their requested affinity and priority
+         *
+         * Only meaningful once start() has been called
+         */
+        bool isRealTime() const;
+
+        /** Read the latest published state of a node
+         *
+         * This is lock-free and can be called from any thread
+         *
+         * @return false if nothing has been published for this node yet
+         */
+        bool getNodeState(uint8_t nodeId, PublishedNodeState& state) const;
+
+        /** Number of frames dropped because the ring was full */
+        uint64_t getOverrunCount() const;
+
+        /** Number of frames dropped because processing them threw */
+        uint64_t getProcessingErrorCount() const;
+
+        /** Number of frames processed so far */
+        uint64_t getProcessedCount() const;
+
+    private:
+        canbus::Driver& mDevice;
+        BusController& mBus;
+        Configuration mConfiguration;
+
+        std::atomic<bool> mRunning;
+        std::atomic<bool> mIntakeDone;
+        std::atomic<bool> mRealTimeFailed;
+        std::atomic<uint64_t> mOverruns;
+        std::atomic<uint64_t> mProcessingErrors;
+        std::atomic<uint64_t> mProcessed;
+
+        std::unique_ptr<SPSCRing<canbus::Message, RING_SIZE>> mRing;
+        std::unique_ptr<SeqLock<PublishedNodeState>[]> mStates;
+        /** Per-node update flags not yet published, owned by the processing
+         * thread
+         */
+        uint64_t mPendingUpdates[BusUpdate::MAX_NODES];
+        /** Per-node update flags received since the engine was created,
+         * owned by the processing thread
+         */
+        uint64_t mReceivedUpdates[BusUpdate::MAX_NODES];
+
+        /** Wakeup of the processing thread when the ring was empty */
+        std::mutex mWakeupMutex;
+        std::condition_variable mWakeup;
+        std::atomic<bool> mProcessingWaiting;
+
+        std::thread mIntakeThread;
+        std::thread mProcessingThread;
+
+        /** Apply the affinity and priority of the calling thread, and
+         * fulfill setup
+         */
+        void setupThread(int cpu, std::promise<void>& setup);
+        void runIntake(std::promise<void> setup);
+        void runProcessing(std::promise<void> setup);
+        void publish(uint8_t nodeId, Update const& update, base::Time const& time);
+    };
+}
+
+#endif
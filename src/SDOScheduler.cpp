@@ -0,0 +1,195 @@
+#include <motors_elmo_ds402/SDOScheduler.hpp>
+#include <motors_elmo_ds402/Controller.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static const uint32_t SDO_REQUEST_COB_ID  = 0x600;
+static const uint32_t SDO_RESPONSE_COB_ID = 0x580;
+static const uint8_t SDO_ABORT = 0x80;
+
+static uint16_t getSDOObjectId(canbus::Message const& msg)
+{
+    return static_cast<uint16_t>(msg.data[1]) |
+        static_cast<uint16_t>(msg.data[2]) << 8;
+}
+
+static uint32_t getSDOPayload(canbus::Message const& msg)
+{
+    return static_cast<uint32_t>(msg.data[4]) |
+        static_cast<uint32_t>(msg.data[5]) << 8 |
+        static_cast<uint32_t>(msg.data[6]) << 16 |
+        static_cast<uint32_t>(msg.data[7]) << 24;
+}
+
+SDOScheduler::SDOScheduler(base::Time const& timeout, int retries)
+    : mTimeout(timeout)
+    , mRetries(retries)
+    , mActiveCount(0)
+{
+}
+
+uint8_t SDOScheduler::getRequestNodeId(canbus::Message const& msg)
+{
+    if ((msg.can_id & 0x780) != SDO_REQUEST_COB_ID || msg.size != 8)
+        return 0;
+    return msg.can_id & 0x7F;
+}
+
+void SDOScheduler::push(canbus::Message const& query)
+{
+    uint8_t nodeId = getRequestNodeId(query);
+    if (!nodeId)
+        throw std::invalid_argument("SDOScheduler::push: message is not a SDO request");
+
+    Node& node = mNodes[nodeId];
+    if (!node.inFlight && node.queue.empty())
+        ++mActiveCount;
+    node.queue.push_back(query);
+}
+
+void SDOScheduler::push(vector<canbus::Message> const& queries)
+{
+    for (auto const& query : queries)
+        push(query);
+}
+
+canbus::Message SDOScheduler::start(canbus::Message const& query, base::Time const& now)
+{
+    uint8_t nodeId = getRequestNodeId(query);
+    if (!nodeId)
+        throw std::invalid_argument("SDOScheduler::start: message is not a SDO request");
+
+    Node& node = mNodes[nodeId];
+    if (node.inFlight)
+        throw HasPendingQuery("a SDO transaction is already in flight for this node");
+
+    if (node.queue.empty())
+        ++mActiveCount;
+    node.queue.push_front(query);
+    vector<canbus::Message> messages;
+    startNext(node, now, messages);
+    return messages.front();
+}
+
+void SDOScheduler::startNext(Node& node, base::Time const& now,
+    vector<canbus::Message>& messages)
+{
+    node.current = node.queue.front();
+    node.queue.pop_front();
+    node.inFlight = true;
+    node.sentTime = now;
+    node.retries = 0;
+    messages.push_back(node.current);
+}
+
+vector<canbus::Message> SDOScheduler::poll(base::Time const& now)
+{
+    vector<canbus::Message> messages;
+    if (!mActiveCount)
+        return messages;
+
+    for (int nodeId = 1; nodeId < MAX_NODES; ++nodeId)
+    {
+        Node& node = mNodes[nodeId];
+        if (node.inFlight && now - node.sentTime >= mTimeout)
+        {
+            if (node.retries < mRetries)
+            {
+                ++node.retries;
+                node.sentTime = now;
+                messages.push_back(node.current);
+                continue;
+            }
+
+            SDOResult result;
+            result.status = SDOResult::TIMED_OUT;
+            result.nodeId = nodeId;
+            result.objectId = getSDOObjectId(node.current);
+            result.objectSubId = node.current.data[3];
+            mFailures.push_back(result);
+            node.inFlight = false;
+            if (node.queue.empty())
+                --mActiveCount;
+        }
+
+        if (!node.inFlight && !node.queue.empty())
+            startNext(node, now, messages);
+    }
+    return messages;
+}
+
+SDOResult SDOScheduler::process(canbus::Message const& msg, base::Time const& now)
+{
+    if ((msg.can_id & 0x780) != SDO_RESPONSE_COB_ID || msg.size != 8)
+        return SDOResult();
+
+    uint8_t nodeId = msg.can_id & 0x7F;
+    Node& node = mNodes[nodeId];
+    if (!node.inFlight)
+        return SDOResult();
+
+    uint16_t objectId = getSDOObjectId(msg);
+    uint8_t objectSubId = msg.data[3];
+    if (objectId != getSDOObjectId(node.current) ||
+        objectSubId != node.current.data[3])
+        return SDOResult();
+
+    SDOResult result;
+    result.nodeId = nodeId;
+    result.objectId = objectId;
+    result.objectSubId = objectSubId;
+    result.roundTrip = now - node.sentTime;
+    if (msg.data[0] == SDO_ABORT)
+    {
+        result.status = SDOResult::ABORTED;
+        result.abortCode = getSDOPayload(msg);
+        mFailures.push_back(result);
+    }
+    else
+        result.status = SDOResult::SUCCESS;
+
+    node.inFlight = false;
+    if (node.queue.empty())
+        --mActiveCount;
+    return result;
+}
+
+bool SDOScheduler::hasPendingQuery(uint8_t nodeId) const
+{
+    return mNodes[nodeId & 0x7F].inFlight;
+}
+
+bool SDOScheduler::isDone() const
+{
+    return mActiveCount == 0;
+}
+
+base::Time SDOScheduler::getNextDeadline() const
+{
+    base::Time deadline;
+    if (!mActiveCount)
+        return deadline;
+
+    for (int nodeId = 1; nodeId < MAX_NODES; ++nodeId)
+    {
+        Node const& node = mNodes[nodeId];
+        if (!node.inFlight)
+            continue;
+
+        base::Time nodeDeadline = node.sentTime + mTimeout;
+        if (deadline.isNull() || nodeDeadline < deadline)
+            deadline = nodeDeadline;
+    }
+    return deadline;
+}
+
+vector<SDOResult> const& SDOScheduler::getFailures() const
+{
+    return mFailures;
+}
+
+void SDOScheduler::clearFailures()
+{
+    mFailures.clear();
+}
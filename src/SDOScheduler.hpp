@@ -0,0 +1,154 @@
+#ifndef MOTORS_ELMO_DS402_SDO_SCHEDULER_HPP
+#define MOTORS_ELMO_DS402_SDO_SCHEDULER_HPP
+
+#include <deque>
+#include <vector>
+#include <canbus/Message.hpp>
+#include <base/Time.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Outcome of a SDO transaction handled by SDOScheduler */
+    struct SDOResult
+    {
+        enum Status
+        {
+            /** The message was not the response to a pending transaction */
+            NONE,
+            SUCCESS,
+            ABORTED,
+            TIMED_OUT
+        };
+
+        Status status;
+        uint8_t nodeId;
+        uint16_t objectId;
+        uint8_t objectSubId;
+        /** The SDO abort code if status is ABORTED */
+        uint32_t abortCode;
+        /** Time between the last (re)transmission and the response */
+        base::Time roundTrip;
+
+        SDOResult()
+            : status(NONE)
+            , nodeId(0)
+            , objectId(0)
+            , objectSubId(0)
+            , abortCode(0) {}
+
+        bool isValid() const { return status != NONE; }
+    };
+
+    /** Pipelining of SDO transactions across the nodes of a bus
+     *
+     * CANOpen allows only one SDO transaction per node at a given time. This
+     * class queues SDO requests (as e.g. returned by
+     * Controller::queryFactors) and keeps one of them in flight for each node,
+     * so that transactions towards different nodes overlap.
+     *
+     * Like Controller, it only represents the protocol. The caller is
+     * expected to send the messages returned by poll(), and to pass all
+     * received messages to process() (in addition to Controller::process or
+     * BusController::process).
+     *
+     * Only expedited transfers are supported, which covers all the objects in
+     * Objects.hpp.
+     */
+    class SDOScheduler
+    {
+    public:
+        static const int MAX_NODES = 128;
+
+        /**
+         * @param timeout how long to wait for a response before
+         *   retransmitting the request
+         * @param retries how many times a request gets retransmitted before
+         *   being reported as TIMED_OUT
+         */
+        SDOScheduler(base::Time const& timeout = base::Time::fromMilliseconds(100),
+            int retries = 2);
+
+        /** Queue a SDO request
+         *
+         * @throws std::invalid_argument if the message is not a SDO request
+         */
+        void push(canbus::Message const& query);
+
+        /** @overload */
+        void push(std::vector<canbus::Message> const& queries);
+
+        /** Start a SDO transaction right away, bypassing the queue
+         *
+         * Returns the message that should be sent
+         *
+         * @throws HasPendingQuery if the node already has a transaction in
+         *   flight
+         */
+        canbus::Message start(canbus::Message const& query, base::Time const& now);
+
+        /** Returns the messages that need to be sent now
+         *
+         * This starts the next queued transaction of all the idle nodes, and
+         * retransmits the requests whose response is overdue. Requests that
+         * ran out of retries are reported by getFailures()
+         */
+        std::vector<canbus::Message> poll(base::Time const& now);
+
+        /** Process a received message
+         *
+         * The returned result is invalid if the message is not a response to
+         * a pending transaction.
+         */
+        SDOResult process(canbus::Message const& msg, base::Time const& now);
+
+        /** Whether a given node has a transaction in flight */
+        bool hasPendingQuery(uint8_t nodeId) const;
+
+        /** Whether all queued transactions have been completed */
+        bool isDone() const;
+
+        /** Returns the time at which the earliest pending request times out
+         *
+         * Returns a null time if there are no requests in flight
+         */
+        base::Time getNextDeadline() const;
+
+        /** The transactions that were aborted or timed out
+         *
+         * The list is accumulated until clearFailures() is called
+         */
+        std::vector<SDOResult> const& getFailures() const;
+
+        /** Clear the list returned by getFailures */
+        void clearFailures();
+
+        /** Return the node ID a SDO request is addressed to, or zero if the
+         * message is not a SDO request
+         */
+        static uint8_t getRequestNodeId(canbus::Message const& msg);
+
+    private:
+        struct Node
+        {
+            std::deque<canbus::Message> queue;
+            bool inFlight;
+            canbus::Message current;
+            base::Time sentTime;
+            int retries;
+
+            Node()
+                : inFlight(false)
+                , retries(0) {}
+        };
+
+        base::Time mTimeout;
+        int mRetries;
+        Node mNodes[MAX_NODES];
+        int mActiveCount;
+        std::vector<SDOResult> mFailures;
+
+        void startNext(Node& node, base::Time const& now,
+            std::vector<canbus::Message>& messages);
+    };
+}
+
+#endif
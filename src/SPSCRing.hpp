@@ -0,0 +1,90 @@
+#ifndef MOTORS_ELMO_DS402_SPSC_RING_HPP
+#define MOTORS_ELMO_DS402_SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+
+namespace motors_elmo_ds402 {
+    /** Lock-free single-producer single-consumer ring buffer
+     *
+     * push() must always be called from the same thread, and pop() from
+     * one other thread. Neither ever blocks nor allocates.
+     *
+     * @tparam Capacity the number of elements, must be a power of two
+     */
+    template<typename T, size_t Capacity>
+    class SPSCRing
+    {
+        static_assert(Capacity && (Capacity & (Capacity - 1)) == 0,
+            "the capacity of a SPSCRing must be a power of two");
+        static const size_t MASK = Capacity - 1;
+        static const size_t CACHE_LINE = 64;
+
+    public:
+        SPSCRing()
+            : mHead(0)
+            , mTailCache(0)
+            , mTail(0)
+            , mHeadCache(0) {}
+
+        /** Push an element. Returns false if the ring is full */
+        bool push(T const& value)
+        {
+            size_t tail = mTail.load(std::memory_order_relaxed);
+            if (tail - mHeadCache == Capacity)
+            {
+                mHeadCache = mHead.load(std::memory_order_acquire);
+                if (tail - mHeadCache == Capacity)
+                    return false;
+            }
+            mBuffer[tail & MASK] = value;
+            mTail.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** Pop an element. Returns false if the ring is empty */
+        bool pop(T& value)
+        {
+            size_t head = mHead.load(std::memory_order_relaxed);
+            if (head == mTailCache)
+            {
+                mTailCache = mTail.load(std::memory_order_acquire);
+                if (head == mTailCache)
+                    return false;
+            }
+            value = mBuffer[head & MASK];
+            mHead.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        /** Number of elements in the ring
+         *
+         * It is only a hint when called while the other side is active
+         */
+        size_t size() const
+        {
+            return mTail.load(std::memory_order_acquire) -
+                mHead.load(std::memory_order_acquire);
+        }
+
+        bool empty() const { return size() == 0; }
+
+        static size_t capacity() { return Capacity; }
+
+    private:
+        // The consumer and producer sides are kept on separate cache lines
+        std::atomic<size_t> mHead;
+        /** Consumer's copy of mTail, to avoid reading it on every pop */
+        size_t mTailCache;
+        char mConsumerPadding[CACHE_LINE];
+
+        std::atomic<size_t> mTail;
+        /** Producer's copy of mHead, to avoid reading it on every push */
+        size_t mHeadCache;
+        char mProducerPadding[CACHE_LINE];
+
+        T mBuffer[Capacity];
+    };
+}
+
+#endif
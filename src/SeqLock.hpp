@@ -0,0 +1,89 @@
+#ifndef MOTORS_ELMO_DS402_SEQ_LOCK_HPP
+#define MOTORS_ELMO_DS402_SEQ_LOCK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace motors_elmo_ds402 {
+    /** Sequence lock publishing a value from one writer to any number of
+     * readers
+     *
+     * The writer never waits. Readers never block the writer and never
+     * take a lock. They retry their copy only if it overlapped a store.
+     * The value is stored as relaxed atomic words, so concurrent accesses
+     * are well-defined.
+     *
+     * store() must always be called from the same thread
+     */
+    template<typename T>
+    class SeqLock
+    {
+        static_assert(std::is_trivially_copyable<T>::value,
+            "SeqLock can only publish trivially copyable types");
+        static const size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    public:
+        SeqLock()
+            : mSequence(0)
+        {
+            for (auto& word : mWords)
+                word.store(0, std::memory_order_relaxed);
+        }
+
+        /** Publish a new value */
+        void store(T const& value)
+        {
+            uint64_t words[WORDS] = {};
+            std::memcpy(words, &value, sizeof(T));
+
+            uint64_t sequence = mSequence.load(std::memory_order_relaxed);
+            mSequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < WORDS; ++i)
+                mWords[i].store(words[i], std::memory_order_relaxed);
+            mSequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        /** Copy the last published value
+         *
+         * @return false if no value has been published yet, in which case
+         *   value is left unchanged
+         */
+        bool load(T& value) const
+        {
+            uint64_t words[WORDS];
+            while (true)
+            {
+                uint64_t before = mSequence.load(std::memory_order_acquire);
+                if (before & 1)
+                    continue;
+
+                for (size_t i = 0; i < WORDS; ++i)
+                    words[i] = mWords[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                uint64_t after = mSequence.load(std::memory_order_relaxed);
+                if (before != after)
+                    continue;
+
+                if (!before)
+                    return false;
+                std::memcpy(&value, words, sizeof(T));
+                return true;
+            }
+        }
+
+        /** Number of values published so far */
+        uint64_t getVersion() const
+        {
+            return mSequence.load(std::memory_order_acquire) / 2;
+        }
+
+    private:
+        std::atomic<uint64_t> mSequence;
+        std::atomic<uint64_t> mWords[WORDS];
+    };
+}
+
+#endif
@@ -0,0 +1,274 @@
+#include <motors_elmo_ds402/SimulatedBus.hpp>
+#include <stdexcept>
+#include <unistd.h>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+bool SimulatedBus::Event::operator <(Event const& other) const
+{
+    // std::priority_queue pops the greatest element first
+    if (time != other.time)
+        return time > other.time;
+    return sequence > other.sequence;
+}
+
+SimulatedBus::SimulatedBus(Configuration const& configuration)
+    : mConfiguration(configuration)
+    , mRandom(configuration.seed)
+    , mVirtualTime(base::Time::fromMicroseconds(1))
+    , mReadTimeout(1000)
+    , mWriteTimeout(1000)
+    , mSequence(0)
+{
+}
+
+SimulatedDrive& SimulatedBus::addDrive(uint8_t nodeId)
+{
+    if (nodeId == 0 || nodeId > 127)
+        throw std::invalid_argument("SimulatedBus::addDrive: node ID must be in [1, 127]");
+    for (auto const& drive : mDrives)
+    {
+        if (drive->getNodeId() == nodeId)
+            throw std::invalid_argument("SimulatedBus::addDrive: node ID already in use");
+    }
+
+    mDrives.emplace_back(new SimulatedDrive(nodeId));
+    return *mDrives.back();
+}
+
+SimulatedDrive& SimulatedBus::getDrive(uint8_t nodeId)
+{
+    for (auto const& drive : mDrives)
+    {
+        if (drive->getNodeId() == nodeId)
+            return *drive;
+    }
+    throw std::invalid_argument("SimulatedBus::getDrive: no drive with this node ID");
+}
+
+size_t SimulatedBus::getDriveCount() const
+{
+    return mDrives.size();
+}
+
+SimulatedBus::Statistics const& SimulatedBus::getStatistics() const
+{
+    return mStatistics;
+}
+
+base::Time SimulatedBus::now() const
+{
+    if (mConfiguration.virtualTime)
+        return mVirtualTime;
+    else
+        return base::Time::now();
+}
+
+base::Time SimulatedBus::getTime() const
+{
+    return now();
+}
+
+void SimulatedBus::advance(base::Time const& duration)
+{
+    if (!mConfiguration.virtualTime)
+        throw std::logic_error("SimulatedBus::advance called on a bus that uses the wall clock");
+    run(mVirtualTime + duration);
+    mVirtualTime = mVirtualTime + duration;
+}
+
+void SimulatedBus::transmit(canbus::Message const& msg, base::Time const& time, bool toHost)
+{
+    if (mConfiguration.lossProbability > 0 &&
+        bernoulli_distribution(mConfiguration.lossProbability)(mRandom))
+    {
+        ++mStatistics.lost;
+        return;
+    }
+
+    base::Time delivery = time + mConfiguration.latency;
+    if (!mConfiguration.jitter.isNull())
+    {
+        uniform_int_distribution<int64_t> jitter(0, mConfiguration.jitter.toMicroseconds());
+        delivery = delivery + base::Time::fromMicroseconds(jitter(mRandom));
+    }
+    base::Time& lastDelivery = mLastDelivery[toHost];
+    if (delivery < lastDelivery)
+        delivery = lastDelivery;
+    lastDelivery = delivery;
+
+    Event event = { delivery, mSequence++, toHost, msg };
+    mEvents.push(event);
+}
+
+void SimulatedBus::queueDriveOutput(base::Time const& time)
+{
+    for (auto const& msg : mDriveOutput)
+    {
+        ++mStatistics.sent;
+        transmit(msg, time, true);
+    }
+    mDriveOutput.clear();
+}
+
+base::Time SimulatedBus::getNextEventTime() const
+{
+    base::Time next;
+    if (!mEvents.empty())
+        next = mEvents.top().time;
+    for (auto const& drive : mDrives)
+    {
+        base::Time deadline = drive->getNextDeadline();
+        if (!deadline.isNull() && (next.isNull() || deadline < next))
+            next = deadline;
+    }
+    return next;
+}
+
+void SimulatedBus::run(base::Time const& time)
+{
+    while (true)
+    {
+        base::Time next = getNextEventTime();
+        if (next.isNull() || time < next)
+            return;
+
+        if (!mEvents.empty() && mEvents.top().time == next)
+        {
+            Event event = mEvents.top();
+            mEvents.pop();
+            if (event.toHost)
+            {
+                event.msg.time = event.time;
+                mInbox.push_back(event.msg);
+            }
+            else
+            {
+                for (auto const& drive : mDrives)
+                    drive->process(event.msg, event.time, mDriveOutput);
+                queueDriveOutput(event.time);
+            }
+        }
+        else
+        {
+            for (auto const& drive : mDrives)
+            {
+                base::Time deadline = drive->getNextDeadline();
+                if (!deadline.isNull() && deadline <= next)
+                    drive->update(next, mDriveOutput);
+            }
+            queueDriveOutput(next);
+        }
+    }
+}
+
+bool SimulatedBus::open(std::string const&)
+{
+    return true;
+}
+
+bool SimulatedBus::reset()
+{
+    clear();
+    return true;
+}
+
+void SimulatedBus::close()
+{
+}
+
+bool SimulatedBus::setBaudrate(canbus::BAUD_RATE)
+{
+    return true;
+}
+
+canbus::Message SimulatedBus::read()
+{
+    base::Time deadline = now() + base::Time::fromMilliseconds(mReadTimeout);
+    while (true)
+    {
+        base::Time current = now();
+        run(current);
+        if (!mInbox.empty())
+        {
+            canbus::Message msg = mInbox.front();
+            mInbox.pop_front();
+            return msg;
+        }
+
+        base::Time next = getNextEventTime();
+        if (current >= deadline || (mConfiguration.virtualTime && (next.isNull() || deadline < next)))
+        {
+            if (mConfiguration.virtualTime)
+                mVirtualTime = deadline;
+            throw std::runtime_error("SimulatedBus::read: timeout");
+        }
+
+        if (mConfiguration.virtualTime)
+            mVirtualTime = next;
+        else
+        {
+            base::Time wakeup = deadline;
+            if (!next.isNull() && next < wakeup)
+                wakeup = next;
+            if (current < wakeup)
+                usleep((wakeup - current).toMicroseconds());
+        }
+    }
+}
+
+void SimulatedBus::write(canbus::Message const& msg)
+{
+    base::Time time = now();
+    run(time);
+    ++mStatistics.written;
+    transmit(msg, time, false);
+}
+
+int SimulatedBus::getPendingMessagesCount()
+{
+    run(now());
+    return mInbox.size();
+}
+
+bool SimulatedBus::checkBusOk()
+{
+    return true;
+}
+
+void SimulatedBus::clear()
+{
+    run(now());
+    mInbox.clear();
+}
+
+int SimulatedBus::getFileDescriptor() const
+{
+    return -1;
+}
+
+bool SimulatedBus::isValid() const
+{
+    return true;
+}
+
+void SimulatedBus::setReadTimeout(uint32_t timeout)
+{
+    mReadTimeout = timeout;
+}
+
+uint32_t SimulatedBus::getReadTimeout() const
+{
+    return mReadTimeout;
+}
+
+void SimulatedBus::setWriteTimeout(uint32_t timeout)
+{
+    mWriteTimeout = timeout;
+}
+
+uint32_t SimulatedBus::getWriteTimeout() const
+{
+    return mWriteTimeout;
+}
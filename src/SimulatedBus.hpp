@@ -0,0 +1,150 @@
+#ifndef MOTORS_ELMO_DS402_SIMULATED_BUS_HPP
+#define MOTORS_ELMO_DS402_SIMULATED_BUS_HPP
+
+#include <deque>
+#include <memory>
+#include <queue>
+#include <random>
+#include <vector>
+#include <canbus/Driver.hpp>
+#include <motors_elmo_ds402/SimulatedDrive.hpp>
+
+namespace motors_elmo_ds402 {
+    /** A virtual CAN bus with simulated drives behind it
+     *
+     * It implements canbus::Driver, so that the code that talks to real
+     * drives can be run unchanged against any number of SimulatedDrive.
+     * Frames are delayed by a configurable latency and may be dropped with
+     * a configurable probability, independently in each direction.
+     *
+     * The bus either follows the wall clock, or a virtual clock that read()
+     * advances to the next event instead of sleeping. The latter makes
+     * load and latency measurements deterministic and independent of the
+     * host's load.
+     *
+     * It is not thread-safe
+     */
+    class SimulatedBus : public canbus::Driver
+    {
+    public:
+        struct Configuration
+        {
+            /** One-way latency of the frames */
+            base::Time latency;
+            /** Maximum random latency added to the fixed one. The order of
+             * the frames is preserved regardless
+             */
+            base::Time jitter;
+            /** Probability for a frame to be lost, in [0, 1] */
+            double lossProbability;
+            /** Seed of the random generator used for jitter and loss */
+            uint32_t seed;
+            /** Whether the bus uses a virtual clock instead of the wall clock */
+            bool virtualTime;
+
+            Configuration()
+                : lossProbability(0)
+                , seed(0)
+                , virtualTime(false) {}
+        };
+
+        struct Statistics
+        {
+            /** Frames written by the host */
+            uint64_t written;
+            /** Frames sent by the drives */
+            uint64_t sent;
+            /** Frames lost, in both directions */
+            uint64_t lost;
+
+            Statistics()
+                : written(0)
+                , sent(0)
+                , lost(0) {}
+        };
+
+        explicit SimulatedBus(Configuration const& configuration = Configuration());
+
+        /** Add a drive on the bus
+         *
+         * @throws std::invalid_argument if the node ID is invalid or
+         *   already in use
+         */
+        SimulatedDrive& addDrive(uint8_t nodeId);
+
+        /** Returns a drive
+         *
+         * @throws std::invalid_argument if there is no drive with this ID
+         */
+        SimulatedDrive& getDrive(uint8_t nodeId);
+
+        size_t getDriveCount() const;
+
+        /** The bus's current time */
+        base::Time getTime() const;
+
+        /** Advance the virtual clock, processing the events up to the new
+         * time
+         *
+         * @throws std::logic_error if the bus uses the wall clock
+         */
+        void advance(base::Time const& duration);
+
+        Statistics const& getStatistics() const;
+
+        bool open(std::string const& path) override;
+        bool reset() override;
+        void close() override;
+        bool setBaudrate(canbus::BAUD_RATE rate) override;
+        canbus::Message read() override;
+        void write(canbus::Message const& msg) override;
+        int getPendingMessagesCount() override;
+        bool checkBusOk() override;
+        void clear() override;
+        int getFileDescriptor() const override;
+        bool isValid() const override;
+        void setReadTimeout(uint32_t timeout) override;
+        uint32_t getReadTimeout() const override;
+        void setWriteTimeout(uint32_t timeout) override;
+        uint32_t getWriteTimeout() const override;
+
+    private:
+        struct Event
+        {
+            base::Time time;
+            uint64_t sequence;
+            /** If true, the frame goes from the drives to the host */
+            bool toHost;
+            canbus::Message msg;
+
+            bool operator <(Event const& other) const;
+        };
+
+        Configuration mConfiguration;
+        Statistics mStatistics;
+        std::mt19937 mRandom;
+        base::Time mVirtualTime;
+        uint32_t mReadTimeout;
+        uint32_t mWriteTimeout;
+
+        std::vector<std::unique_ptr<SimulatedDrive>> mDrives;
+        std::priority_queue<Event> mEvents;
+        uint64_t mSequence;
+        /** Delivery time of the last frame queued in each direction, used to
+         * preserve the frame order under jitter
+         */
+        base::Time mLastDelivery[2];
+        std::deque<canbus::Message> mInbox;
+        std::vector<canbus::Message> mDriveOutput;
+
+        base::Time now() const;
+        /** Time of the next event or drive deadline, or a null time */
+        base::Time getNextEventTime() const;
+        /** Process all events and drive deadlines up to the given time */
+        void run(base::Time const& time);
+        void transmit(canbus::Message const& msg, base::Time const& time, bool toHost);
+        void queueDriveOutput(base::Time const& time);
+    };
+}
+
+#endif
@@ -0,0 +1,722 @@
+#include <motors_elmo_ds402/SimulatedDrive.hpp>
+#include <cmath>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+using canopen_master::NODE_STATE;
+
+static const uint32_t COB_ID_INVALID = 0x80000000;
+
+/** Mask of the SupportedDriveModes bits of the modes the simulation handles */
+static const uint32_t SUPPORTED_DRIVE_MODES = 0x3AD;
+
+static uint8_t encodeNodeState(NODE_STATE state)
+{
+    switch(state)
+    {
+        case canopen_master::NODE_STOPPED: return 0x04;
+        case canopen_master::NODE_OPERATIONAL: return 0x05;
+        case canopen_master::NODE_PRE_OPERATIONAL: return 0x7F;
+        default: return 0x00;
+    }
+}
+
+static uint16_t encodeState(StatusWord::State state)
+{
+    switch(state)
+    {
+        case StatusWord::NOT_READY_TO_SWITCH_ON: return 0x00;
+        case StatusWord::SWITCH_ON_DISABLED: return 0x40;
+        case StatusWord::READY_TO_SWITCH_ON: return 0x31;
+        case StatusWord::SWITCH_ON: return 0x33;
+        case StatusWord::OPERATION_ENABLED: return 0x37;
+        case StatusWord::QUICK_STOP_ACTIVE: return 0x17;
+        case StatusWord::FAULT_REACTION_ACTIVE: return 0x0F;
+        case StatusWord::FAULT: return 0x08;
+    }
+    return 0;
+}
+
+static uint32_t readLittleEndian(uint8_t const* data, int size)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < size; ++i)
+        value |= static_cast<uint32_t>(data[i]) << (8 * i);
+    return value;
+}
+
+static void writeLittleEndian(uint8_t* data, uint32_t value, int size)
+{
+    for (int i = 0; i < size; ++i)
+        data[i] = (value >> (8 * i)) & 0xFF;
+}
+
+SimulatedDrive::PDO::PDO()
+    : cobId(COB_ID_INVALID)
+    , transmissionType(255)
+    , inhibitTime(0)
+    , eventTimer(0)
+    , mappingCount(0)
+    , mapping()
+    , syncCount(0)
+    , hasPendingData(false)
+{
+}
+
+bool SimulatedDrive::PDO::isValid() const
+{
+    return !(cobId & COB_ID_INVALID);
+}
+
+bool SimulatedDrive::PDO::isSynchronous() const
+{
+    return transmissionType <= 240;
+}
+
+SimulatedDrive::SimulatedDrive(uint8_t nodeId)
+    : mNodeId(nodeId)
+{
+    resetApplication();
+    resetCommunication();
+}
+
+uint8_t SimulatedDrive::getNodeId() const
+{
+    return mNodeId;
+}
+
+canopen_master::NODE_STATE SimulatedDrive::getNodeState() const
+{
+    return mNodeState;
+}
+
+StatusWord::State SimulatedDrive::getState() const
+{
+    return mState;
+}
+
+void SimulatedDrive::reset(base::Time const& time, vector<canbus::Message>& out)
+{
+    resetApplication();
+    resetCommunication();
+    canbus::Message bootup = makeHeartbeat();
+    bootup.data[0] = 0;
+    bootup.time = time;
+    out.push_back(bootup);
+    mLastMotionUpdate = time;
+}
+
+void SimulatedDrive::resetApplication()
+{
+    for (auto& value : mValues)
+        value = 0;
+
+    set<DeviceType>(0x00020192);
+    set<PositionEncoderResolutionNum>(4096);
+    set<PositionEncoderResolutionDen>(1);
+    set<VelocityEncoderResolutionNum>(1);
+    set<VelocityEncoderResolutionDen>(1);
+    set<GearRatioNum>(1);
+    set<GearRatioDen>(1);
+    set<FeedConstantNum>(1);
+    set<FeedConstantDen>(1);
+    set<VelocityFactorNum>(1);
+    set<VelocityFactorDen>(1);
+    set<AccelerationFactorNum>(1);
+    set<AccelerationFactorDen>(1);
+    set<MotorRatedCurrent>(1000);
+    set<MotorRatedTorque>(1000);
+    set<SupportedDriveModes>(SUPPORTED_DRIVE_MODES);
+
+    mState = StatusWord::SWITCH_ON_DISABLED;
+    mLastControlWord = 0;
+    mPosition = 0;
+    mLastMotionUpdate = base::Time();
+    updateStatusWord();
+}
+
+void SimulatedDrive::resetCommunication()
+{
+    for (int i = 0; i < PDO_COUNT; ++i)
+    {
+        mTPDOs[i] = PDO();
+        mTPDOs[i].cobId = COB_ID_INVALID | (0x180 + 0x100 * i + mNodeId);
+        mRPDOs[i] = PDO();
+        mRPDOs[i].cobId = COB_ID_INVALID | (0x200 + 0x100 * i + mNodeId);
+    }
+    mNodeState = canopen_master::NODE_PRE_OPERATIONAL;
+    mNextHeartbeat = base::Time();
+}
+
+canbus::Message SimulatedDrive::makeHeartbeat() const
+{
+    canbus::Message msg;
+    msg.can_id = 0x700 + mNodeId;
+    msg.size = 1;
+    msg.data[0] = encodeNodeState(mNodeState);
+    return msg;
+}
+
+void SimulatedDrive::process(canbus::Message const& msg, base::Time const& time,
+    vector<canbus::Message>& out)
+{
+    if (msg.can_id == 0x000)
+        processNMT(msg, time, out);
+    else if (msg.can_id == 0x080)
+        processSync(time, out);
+    else if (msg.can_id == 0x600u + mNodeId)
+        processSDO(msg, time, out);
+    else if (msg.can_id == 0x700u + mNodeId && msg.size == 0)
+    {
+        // Node guarding / state query
+        canbus::Message heartbeat = makeHeartbeat();
+        heartbeat.time = time;
+        out.push_back(heartbeat);
+    }
+    else if (mNodeState == canopen_master::NODE_OPERATIONAL)
+    {
+        for (auto& pdo : mRPDOs)
+        {
+            if (pdo.isValid() && (pdo.cobId & 0x7FF) == msg.can_id)
+                processRPDO(pdo, msg, time);
+        }
+    }
+}
+
+void SimulatedDrive::processNMT(canbus::Message const& msg, base::Time const& time,
+    vector<canbus::Message>& out)
+{
+    if (msg.size < 2 || (msg.data[1] != 0 && msg.data[1] != mNodeId))
+        return;
+
+    switch(msg.data[0])
+    {
+        case 0x01:
+            mNodeState = canopen_master::NODE_OPERATIONAL;
+            break;
+        case 0x02:
+            mNodeState = canopen_master::NODE_STOPPED;
+            break;
+        case 0x80:
+            mNodeState = canopen_master::NODE_PRE_OPERATIONAL;
+            break;
+        case 0x81:
+            reset(time, out);
+            break;
+        case 0x82:
+        {
+            resetCommunication();
+            canbus::Message bootup = makeHeartbeat();
+            bootup.data[0] = 0;
+            bootup.time = time;
+            out.push_back(bootup);
+            break;
+        }
+        default:
+            return;
+    }
+    scheduleTimers(time);
+}
+
+void SimulatedDrive::processSync(base::Time const& time, vector<canbus::Message>& out)
+{
+    if (mNodeState != canopen_master::NODE_OPERATIONAL)
+        return;
+
+    for (auto& pdo : mRPDOs)
+    {
+        if (pdo.hasPendingData)
+        {
+            applyPDO(pdo, pdo.pendingData, time);
+            pdo.hasPendingData = false;
+        }
+    }
+
+    updateMotion(time);
+    for (auto& pdo : mTPDOs)
+    {
+        if (!pdo.isValid() || !pdo.isSynchronous())
+            continue;
+
+        if (++pdo.syncCount >= max<int>(1, pdo.transmissionType))
+        {
+            pdo.syncCount = 0;
+            canbus::Message msg = makeTPDO(pdo);
+            msg.time = time;
+            out.push_back(msg);
+        }
+    }
+}
+
+void SimulatedDrive::processRPDO(PDO& pdo, canbus::Message const& msg, base::Time const& time)
+{
+    if (pdo.isSynchronous())
+    {
+        pdo.pendingData = msg;
+        pdo.hasPendingData = true;
+    }
+    else
+        applyPDO(pdo, msg, time);
+}
+
+void SimulatedDrive::processSDO(canbus::Message const& msg, base::Time const& time,
+    vector<canbus::Message>& out)
+{
+    if (mNodeState != canopen_master::NODE_PRE_OPERATIONAL &&
+        mNodeState != canopen_master::NODE_OPERATIONAL)
+        return;
+    if (msg.size < 4)
+        return;
+
+    uint8_t command = msg.data[0];
+    uint16_t objectId = msg.data[1] | (msg.data[2] << 8);
+    uint8_t objectSubId = msg.data[3];
+
+    canbus::Message response;
+    response.can_id = 0x580 + mNodeId;
+    response.size = 8;
+    response.time = time;
+    response.data[1] = msg.data[1];
+    response.data[2] = msg.data[2];
+    response.data[3] = objectSubId;
+
+    uint32_t abortCode = 0;
+    switch(command >> 5)
+    {
+        case 2: // initiate upload
+        {
+            uint32_t value;
+            uint8_t size;
+            abortCode = readObject(objectId, objectSubId, value, size);
+            if (!abortCode)
+            {
+                response.data[0] = 0x43 | ((4 - size) << 2);
+                writeLittleEndian(response.data + 4, value, size);
+            }
+            break;
+        }
+        case 1: // initiate download
+        {
+            if (!(command & 0x02))
+            {
+                // Segmented transfers are not supported
+                abortCode = ABORT_INVALID_COMMAND;
+                break;
+            }
+
+            uint8_t size = (command & 0x01) ? 4 - ((command >> 2) & 3) : 0;
+            uint32_t value = readLittleEndian(msg.data + 4, size ? size : 4);
+            abortCode = writeObject(objectId, objectSubId, value, size, time);
+            if (!abortCode)
+                response.data[0] = 0x60;
+            break;
+        }
+        case 4: // abort
+            return;
+        default:
+            abortCode = ABORT_INVALID_COMMAND;
+    }
+
+    if (abortCode)
+    {
+        response.data[0] = 0x80;
+        writeLittleEndian(response.data + 4, abortCode, 4);
+    }
+    out.push_back(response);
+}
+
+static bool isPDOParameter(uint16_t objectId)
+{
+    uint16_t base = objectId & 0xFF00;
+    return base == 0x1400 || base == 0x1600 || base == 0x1800 || base == 0x1A00;
+}
+
+uint32_t SimulatedDrive::readObject(uint16_t objectId, uint8_t objectSubId,
+    uint32_t& value, uint8_t& size)
+{
+    if (isPDOParameter(objectId))
+        return accessPDOParameter(false, objectId, objectSubId, value, size);
+
+    ObjectInfo const* info = findObject(objectId, objectSubId);
+    if (!info)
+        return ABORT_NO_SUCH_OBJECT;
+    if (!info->isReadable())
+        return ABORT_WRITE_ONLY;
+
+    value = mValues[getObjectIndex(*info)];
+    size = info->size;
+    return 0;
+}
+
+uint32_t SimulatedDrive::writeObject(uint16_t objectId, uint8_t objectSubId,
+    uint32_t value, uint8_t size, base::Time const& time)
+{
+    if (isPDOParameter(objectId))
+    {
+        uint32_t result = accessPDOParameter(true, objectId, objectSubId, value, size);
+        scheduleTimers(time);
+        return result;
+    }
+
+    ObjectInfo const* info = findObject(objectId, objectSubId);
+    if (!info)
+        return ABORT_NO_SUCH_OBJECT;
+    if (!info->isWritable())
+        return ABORT_READ_ONLY;
+    if (size && size != info->size)
+        return ABORT_SIZE_MISMATCH;
+
+    if (info->size < 4)
+        value &= (1u << (8 * info->size)) - 1;
+    mValues[getObjectIndex(*info)] = value;
+
+    if (info == &getObjectInfo<ControlWordRegister>())
+    {
+        updateMotion(time);
+        applyControlWord(value);
+    }
+    else if (info == &getObjectInfo<ProducerHeartbeatTime>())
+    {
+        mNextHeartbeat = base::Time();
+        scheduleTimers(time);
+    }
+    return 0;
+}
+
+uint32_t SimulatedDrive::accessPDOParameter(bool write, uint16_t objectId,
+    uint8_t objectSubId, uint32_t& value, uint8_t& size)
+{
+    uint16_t base = objectId & 0xFF00;
+    unsigned int index = objectId & 0xFF;
+    if (index >= PDO_COUNT)
+        return ABORT_NO_SUCH_OBJECT;
+
+    bool transmit = (base >= 0x1800);
+    PDO& pdo = transmit ? mTPDOs[index] : mRPDOs[index];
+    bool communication = (base == 0x1400 || base == 0x1800);
+
+    if (communication)
+    {
+        switch(objectSubId)
+        {
+            case 0:
+                if (write)
+                    return ABORT_READ_ONLY;
+                value = 5;
+                size = 1;
+                return 0;
+            case 1:
+                if (write)
+                {
+                    pdo.cobId = value;
+                    pdo.nextTransmit = base::Time();
+                }
+                value = pdo.cobId;
+                size = 4;
+                return 0;
+            case 2:
+                if (write)
+                {
+                    pdo.transmissionType = value;
+                    pdo.syncCount = 0;
+                    pdo.hasPendingData = false;
+                }
+                value = pdo.transmissionType;
+                size = 1;
+                return 0;
+            case 3:
+                if (write)
+                    pdo.inhibitTime = value;
+                value = pdo.inhibitTime;
+                size = 2;
+                return 0;
+            case 5:
+                if (write)
+                {
+                    pdo.eventTimer = value;
+                    pdo.nextTransmit = base::Time();
+                }
+                value = pdo.eventTimer;
+                size = 2;
+                return 0;
+            default:
+                return ABORT_NO_SUCH_OBJECT;
+        }
+    }
+
+    if (objectSubId == 0)
+    {
+        if (write)
+        {
+            if (value > MAX_MAPPED_OBJECTS)
+                return ABORT_PDO_TOO_LONG;
+            if (uint32_t abortCode = validateMapping(transmit, pdo, value))
+                return abortCode;
+            pdo.mappingCount = value;
+        }
+        value = pdo.mappingCount;
+        size = 1;
+        return 0;
+    }
+    else if (objectSubId <= MAX_MAPPED_OBJECTS)
+    {
+        if (write)
+        {
+            // CiA 301: the entries can only be changed while the mapping
+            // is disabled, i.e. while subindex 0 is zero
+            if (pdo.mappingCount != 0)
+                return ABORT_WRONG_STATE;
+            if (uint32_t abortCode = validateMappingEntry(transmit, value))
+                return abortCode;
+            pdo.mapping[objectSubId - 1] = value;
+        }
+        value = pdo.mapping[objectSubId - 1];
+        size = 4;
+        return 0;
+    }
+    return ABORT_NO_SUCH_OBJECT;
+}
+
+uint32_t SimulatedDrive::validateMappingEntry(bool transmit, uint32_t entry) const
+{
+    ObjectInfo const* info = findObject(entry >> 16, (entry >> 8) & 0xFF);
+    if (!info || info->size * 8 != (entry & 0xFF))
+        return ABORT_CANNOT_MAP;
+    if (transmit ? !info->isReadable() : !info->isWritable())
+        return ABORT_CANNOT_MAP;
+    return 0;
+}
+
+uint32_t SimulatedDrive::validateMapping(bool transmit, PDO const& pdo, uint8_t count) const
+{
+    int bits = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        uint32_t entry = pdo.mapping[i];
+        if (uint32_t abortCode = validateMappingEntry(transmit, entry))
+            return abortCode;
+        bits += entry & 0xFF;
+    }
+    if (bits > 64)
+        return ABORT_PDO_TOO_LONG;
+    return 0;
+}
+
+canbus::Message SimulatedDrive::makeTPDO(PDO const& pdo) const
+{
+    canbus::Message msg;
+    msg.can_id = pdo.cobId & 0x7FF;
+    int offset = 0;
+    // The entries are validated when they are written, and when the
+    // mapping is enabled
+    for (int i = 0; i < pdo.mappingCount; ++i)
+    {
+        uint32_t entry = pdo.mapping[i];
+        ObjectInfo const* info = findObject(entry >> 16, (entry >> 8) & 0xFF);
+        writeLittleEndian(msg.data + offset, mValues[getObjectIndex(*info)], info->size);
+        offset += info->size;
+    }
+    msg.size = offset;
+    return msg;
+}
+
+void SimulatedDrive::applyPDO(PDO const& pdo, canbus::Message const& msg, base::Time const& time)
+{
+    int offset = 0;
+    for (int i = 0; i < pdo.mappingCount; ++i)
+        offset += (pdo.mapping[i] & 0xFF) / 8;
+    if (msg.size < offset)
+        return;
+
+    offset = 0;
+    for (int i = 0; i < pdo.mappingCount; ++i)
+    {
+        uint32_t entry = pdo.mapping[i];
+        int size = (entry & 0xFF) / 8;
+        writeObject(entry >> 16, (entry >> 8) & 0xFF,
+            readLittleEndian(msg.data + offset, size), size, time);
+        offset += size;
+    }
+}
+
+void SimulatedDrive::update(base::Time const& time, vector<canbus::Message>& out)
+{
+    updateMotion(time);
+
+    uint32_t heartbeatPeriod = get<ProducerHeartbeatTime>();
+    if (!mNextHeartbeat.isNull() && mNextHeartbeat <= time)
+    {
+        canbus::Message msg = makeHeartbeat();
+        msg.time = time;
+        out.push_back(msg);
+        mNextHeartbeat = mNextHeartbeat + base::Time::fromMilliseconds(heartbeatPeriod);
+        if (mNextHeartbeat <= time)
+            mNextHeartbeat = time + base::Time::fromMilliseconds(heartbeatPeriod);
+    }
+
+    for (auto& pdo : mTPDOs)
+    {
+        if (pdo.nextTransmit.isNull() || time < pdo.nextTransmit)
+            continue;
+
+        canbus::Message msg = makeTPDO(pdo);
+        msg.time = time;
+        out.push_back(msg);
+        base::Time period = base::Time::fromMilliseconds(pdo.eventTimer);
+        pdo.nextTransmit = pdo.nextTransmit + period;
+        if (pdo.nextTransmit <= time)
+            pdo.nextTransmit = time + period;
+    }
+}
+
+base::Time SimulatedDrive::getNextDeadline() const
+{
+    base::Time deadline = mNextHeartbeat;
+    for (auto const& pdo : mTPDOs)
+    {
+        if (!pdo.nextTransmit.isNull() &&
+            (deadline.isNull() || pdo.nextTransmit < deadline))
+            deadline = pdo.nextTransmit;
+    }
+    return deadline;
+}
+
+void SimulatedDrive::scheduleTimers(base::Time const& time)
+{
+    uint32_t heartbeatPeriod = get<ProducerHeartbeatTime>();
+    if (!heartbeatPeriod)
+        mNextHeartbeat = base::Time();
+    else if (mNextHeartbeat.isNull())
+        mNextHeartbeat = time + base::Time::fromMilliseconds(heartbeatPeriod);
+
+    bool operational = (mNodeState == canopen_master::NODE_OPERATIONAL);
+    for (auto& pdo : mTPDOs)
+    {
+        if (!operational || !pdo.isValid() || pdo.isSynchronous() || !pdo.eventTimer)
+            pdo.nextTransmit = base::Time();
+        else if (pdo.nextTransmit.isNull())
+            pdo.nextTransmit = time + base::Time::fromMilliseconds(pdo.eventTimer);
+    }
+}
+
+void SimulatedDrive::setFault(uint16_t errorCode)
+{
+    mState = StatusWord::FAULT;
+    set<ErrorCode>(errorCode);
+    set<ErrorRegister>(get<ErrorRegister>() | 0x01);
+    updateStatusWord();
+}
+
+void SimulatedDrive::applyControlWord(uint16_t word)
+{
+    bool faultReset = (word & 0x80) && !(mLastControlWord & 0x80);
+    mLastControlWord = word;
+
+    bool disableVoltage  = !(word & 0x02);
+    bool quickStop       = (word & 0x06) == 0x02;
+    bool shutdown        = (word & 0x07) == 0x06;
+    bool switchOn        = (word & 0x0F) == 0x07;
+    bool enableOperation = (word & 0x0F) == 0x0F;
+
+    switch(mState)
+    {
+        case StatusWord::FAULT:
+            if (faultReset)
+            {
+                mState = StatusWord::SWITCH_ON_DISABLED;
+                set<ErrorCode>(0);
+                set<ErrorRegister>(0);
+            }
+            break;
+        case StatusWord::SWITCH_ON_DISABLED:
+            if (shutdown)
+                mState = StatusWord::READY_TO_SWITCH_ON;
+            break;
+        case StatusWord::READY_TO_SWITCH_ON:
+            if (disableVoltage || quickStop)
+                mState = StatusWord::SWITCH_ON_DISABLED;
+            else if (switchOn)
+                mState = StatusWord::SWITCH_ON;
+            else if (enableOperation)
+                mState = StatusWord::OPERATION_ENABLED;
+            break;
+        case StatusWord::SWITCH_ON:
+            if (disableVoltage || quickStop)
+                mState = StatusWord::SWITCH_ON_DISABLED;
+            else if (shutdown)
+                mState = StatusWord::READY_TO_SWITCH_ON;
+            else if (enableOperation)
+                mState = StatusWord::OPERATION_ENABLED;
+            break;
+        case StatusWord::OPERATION_ENABLED:
+            if (disableVoltage)
+                mState = StatusWord::SWITCH_ON_DISABLED;
+            else if (quickStop)
+                mState = StatusWord::QUICK_STOP_ACTIVE;
+            else if (shutdown)
+                mState = StatusWord::READY_TO_SWITCH_ON;
+            else if (switchOn)
+                mState = StatusWord::SWITCH_ON;
+            break;
+        case StatusWord::QUICK_STOP_ACTIVE:
+            if (disableVoltage)
+                mState = StatusWord::SWITCH_ON_DISABLED;
+            else if (enableOperation)
+                mState = StatusWord::OPERATION_ENABLED;
+            break;
+        default:
+            break;
+    }
+    updateStatusWord();
+}
+
+void SimulatedDrive::updateStatusWord()
+{
+    uint16_t word = encodeState(mState);
+    if (mState == StatusWord::OPERATION_ENABLED &&
+        get<PositionActualInternalValue>() == get<TargetPosition>())
+        word |= 0x400;
+    set<StatusWordRegister>(word);
+}
+
+void SimulatedDrive::updateMotion(base::Time const& time)
+{
+    double dt = mLastMotionUpdate.isNull() ? 0 : (time - mLastMotionUpdate).toSeconds();
+    mLastMotionUpdate = time;
+
+    // Follow changes made through set()
+    if (lround(mPosition) != get<PositionActualInternalValue>())
+        mPosition = get<PositionActualInternalValue>();
+
+    int32_t velocity = 0;
+    int16_t current = 0;
+    if (mState == StatusWord::OPERATION_ENABLED)
+    {
+        switch(get<ModesOfOperation>())
+        {
+            case OperationMode::CYCLIC_SYNCHRONOUS_POSITION:
+            {
+                int32_t target = get<TargetPosition>();
+                if (dt > 0)
+                    velocity = lround((target - mPosition) / dt);
+                mPosition = target;
+                break;
+            }
+            case OperationMode::CYCLIC_SYNCHRONOUS_VELOCITY:
+                velocity = get<TargetVelocity>();
+                mPosition += velocity * dt;
+                break;
+            case OperationMode::CYCLIC_SYNCHRONOUS_TORQUE:
+                current = get<TargetTorque>();
+                break;
+            default:
+                break;
+        }
+    }
+
+    set<PositionActualInternalValue>(lround(mPosition));
+    set<VelocityActualValue>(velocity);
+    set<CurrentActualValue>(current);
+    set<TorqueActualValue>(current);
+    updateStatusWord();
+}
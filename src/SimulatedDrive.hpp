@@ -0,0 +1,193 @@
+#ifndef MOTORS_ELMO_DS402_SIMULATED_DRIVE_HPP
+#define MOTORS_ELMO_DS402_SIMULATED_DRIVE_HPP
+
+#include <vector>
+#include <cstring>
+#include <canbus/Message.hpp>
+#include <canopen_master/StateMachine.hpp>
+#include <motors_elmo_ds402/Objects.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Simulation of a DS402 drive, at the protocol level
+     *
+     * It is, like Controller, independent of how the CAN bus is accessed.
+     * The messages seen on the bus are fed to process() and the periodic
+     * behaviour (heartbeat, timer-triggered TPDOs) is triggered by
+     * update(). Both append the frames the drive sends to a caller-provided
+     * vector. See SimulatedBus to plug drives behind a canbus::Driver.
+     *
+     * The drive has an object dictionary holding the objects of Objects.hpp,
+     * answers expedited SDO uploads and downloads, follows the NMT state
+     * machine, produces heartbeats, implements TPDO/RPDO mapping with
+     * SYNC-triggered and timer-triggered transmission and follows the CiA
+     * 402 state machine as driven by the control word. In OPERATION_ENABLED,
+     * the cyclic synchronous modes apply their target directly to the
+     * actual values.
+     */
+    class SimulatedDrive
+    {
+    public:
+        static const int PDO_COUNT = 4;
+        static const int MAX_MAPPED_OBJECTS = 8;
+
+        /** SDO abort codes, as defined by CiA 301 */
+        enum SDO_ABORT_CODE
+        {
+            ABORT_INVALID_COMMAND       = 0x05040001,
+            ABORT_WRITE_ONLY            = 0x06010001,
+            ABORT_READ_ONLY             = 0x06010002,
+            ABORT_NO_SUCH_OBJECT        = 0x06020000,
+            ABORT_CANNOT_MAP            = 0x06040041,
+            ABORT_PDO_TOO_LONG          = 0x06040042,
+            ABORT_SIZE_MISMATCH         = 0x06070010,
+            ABORT_WRONG_STATE           = 0x08000022
+        };
+
+        explicit SimulatedDrive(uint8_t nodeId);
+
+        uint8_t getNodeId() const;
+
+        /** Process a message seen on the bus
+         *
+         * @param out the frames sent by the drive in response are appended
+         *   to this vector
+         */
+        void process(canbus::Message const& msg, base::Time const& time,
+            std::vector<canbus::Message>& out);
+
+        /** Run the drive's periodic behaviour up to the given time
+         *
+         * @param out the frames sent by the drive are appended to this
+         *   vector
+         */
+        void update(base::Time const& time, std::vector<canbus::Message>& out);
+
+        /** Time at which update() must be called next, or a null time if
+         * the drive has nothing scheduled
+         */
+        base::Time getNextDeadline() const;
+
+        /** Reset the drive to its power-on state and send the boot-up
+         * message
+         */
+        void reset(base::Time const& time, std::vector<canbus::Message>& out);
+
+        canopen_master::NODE_STATE getNodeState() const;
+        StatusWord::State getState() const;
+
+        /** Put the drive in fault, as if an error had been detected */
+        void setFault(uint16_t errorCode);
+
+        /** Write the raw value of an object, bypassing access checks */
+        template<typename T>
+        void set(typename T::OBJECT_TYPE value)
+        {
+            std::memcpy(&mValues[ObjectIndex<T>::value], &value, sizeof(value));
+        }
+
+        /** Read the raw value of an object */
+        template<typename T>
+        typename T::OBJECT_TYPE get() const
+        {
+            typename T::OBJECT_TYPE value;
+            std::memcpy(&value, &mValues[ObjectIndex<T>::value], sizeof(value));
+            return value;
+        }
+
+    private:
+        struct PDO
+        {
+            uint32_t cobId;
+            uint8_t transmissionType;
+            uint16_t inhibitTime;
+            uint16_t eventTimer;
+            uint8_t mappingCount;
+            uint32_t mapping[MAX_MAPPED_OBJECTS];
+
+            /** Number of SYNCs received since the last transmission */
+            int syncCount;
+            /** Next transmission of timer-triggered TPDOs */
+            base::Time nextTransmit;
+            /** Data of a synchronous RPDO, applied on the next SYNC */
+            bool hasPendingData;
+            canbus::Message pendingData;
+
+            PDO();
+            bool isValid() const;
+            bool isSynchronous() const;
+        };
+
+        uint8_t mNodeId;
+        canopen_master::NODE_STATE mNodeState;
+        StatusWord::State mState;
+        uint16_t mLastControlWord;
+
+        /** mValues[i] holds the value of the i-th object of OBJECT_REGISTRY,
+         * objects smaller than 4 bytes using the first bytes of their cell
+         */
+        uint32_t mValues[OBJECT_COUNT];
+
+        PDO mTPDOs[PDO_COUNT];
+        PDO mRPDOs[PDO_COUNT];
+
+        /** Actual position, kept as double to integrate velocities */
+        double mPosition;
+        base::Time mLastMotionUpdate;
+        base::Time mNextHeartbeat;
+
+        /** Start or stop the heartbeat and TPDO timers after a
+         * configuration change
+         */
+        void scheduleTimers(base::Time const& time);
+
+        void resetCommunication();
+        void resetApplication();
+
+        void processNMT(canbus::Message const& msg, base::Time const& time,
+            std::vector<canbus::Message>& out);
+        void processSync(base::Time const& time, std::vector<canbus::Message>& out);
+        void processSDO(canbus::Message const& msg, base::Time const& time,
+            std::vector<canbus::Message>& out);
+        void processRPDO(PDO& pdo, canbus::Message const& msg, base::Time const& time);
+
+        /** Read an object for an SDO upload
+         *
+         * @return zero on success, an SDO abort code otherwise
+         */
+        uint32_t readObject(uint16_t objectId, uint8_t objectSubId,
+            uint32_t& value, uint8_t& size);
+        /** Write an object for an SDO download or an RPDO
+         *
+         * @return zero on success, an SDO abort code otherwise
+         */
+        uint32_t writeObject(uint16_t objectId, uint8_t objectSubId,
+            uint32_t value, uint8_t size, base::Time const& time);
+        /** Read or write a PDO communication or mapping parameter
+         *
+         * @return zero on success, an SDO abort code otherwise
+         */
+        uint32_t accessPDOParameter(bool write, uint16_t objectId,
+            uint8_t objectSubId, uint32_t& value, uint8_t& size);
+        /** Validate a single PDO mapping entry
+         *
+         * @return zero if the entry maps a known object, with its size and an
+         *   access compatible with the PDO direction. An SDO abort code
+         *   otherwise
+         */
+        uint32_t validateMappingEntry(bool transmit, uint32_t entry) const;
+        /** Validate a PDO mapping of the given number of entries */
+        uint32_t validateMapping(bool transmit, PDO const& pdo, uint8_t count) const;
+
+        void applyPDO(PDO const& pdo, canbus::Message const& msg, base::Time const& time);
+        canbus::Message makeTPDO(PDO const& pdo) const;
+
+        void applyControlWord(uint16_t word);
+        void updateStatusWord();
+        void updateMotion(base::Time const& time);
+
+        canbus::Message makeHeartbeat() const;
+    };
+}
+
+#endif
@@ -0,0 +1,142 @@
+#include <motors_elmo_ds402/Statistics.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+/** Increment a counter that has a single writer
+ *
+ * A relaxed load/store pair is enough, and avoids the cost of an atomic
+ * read-modify-write on the control thread
+ */
+static void increment(atomic<uint64_t>& counter, uint64_t value = 1)
+{
+    counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+HistogramSnapshot::HistogramSnapshot()
+    : buckets()
+    , count(0)
+    , sum(0)
+    , min(0)
+    , max(0)
+{
+}
+
+double HistogramSnapshot::mean() const
+{
+    if (!count)
+        return 0;
+    return static_cast<double>(sum) / count;
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const
+{
+    if (!count)
+        return 0;
+
+    uint64_t threshold = static_cast<uint64_t>(ceil(p * count));
+    uint64_t cumulated = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i)
+    {
+        cumulated += buckets[i];
+        if (cumulated >= threshold && cumulated)
+            return std::min(getBucketUpperBound(i), max);
+    }
+    return max;
+}
+
+uint64_t HistogramSnapshot::getBucketUpperBound(int bucket)
+{
+    if (bucket == BUCKET_COUNT - 1)
+        return numeric_limits<uint64_t>::max();
+    return static_cast<uint64_t>(1) << bucket;
+}
+
+Histogram::Histogram()
+{
+    for (auto& bucket : mBuckets)
+        bucket.store(0, memory_order_relaxed);
+    mCount.store(0, memory_order_relaxed);
+    mSum.store(0, memory_order_relaxed);
+    mMin.store(numeric_limits<uint64_t>::max(), memory_order_relaxed);
+    mMax.store(0, memory_order_relaxed);
+}
+
+int Histogram::getBucket(uint64_t value)
+{
+    if (!value)
+        return 0;
+    int bucket = 64 - __builtin_clzll(value);
+    return std::min(bucket, HistogramSnapshot::BUCKET_COUNT - 1);
+}
+
+void Histogram::add(uint64_t value)
+{
+    increment(mBuckets[getBucket(value)]);
+    increment(mSum, value);
+    if (value < mMin.load(memory_order_relaxed))
+        mMin.store(value, memory_order_relaxed);
+    if (value > mMax.load(memory_order_relaxed))
+        mMax.store(value, memory_order_relaxed);
+    // Written last with release semantics, so that a snapshot that sees the
+    // new count also sees the buckets
+    mCount.store(mCount.load(memory_order_relaxed) + 1, memory_order_release);
+}
+
+void Histogram::clear()
+{
+    mCount.store(0, memory_order_release);
+    for (auto& bucket : mBuckets)
+        bucket.store(0, memory_order_relaxed);
+    mSum.store(0, memory_order_relaxed);
+    mMin.store(numeric_limits<uint64_t>::max(), memory_order_relaxed);
+    mMax.store(0, memory_order_relaxed);
+}
+
+HistogramSnapshot Histogram::snapshot() const
+{
+    HistogramSnapshot result;
+    result.count = mCount.load(memory_order_acquire);
+    for (int i = 0; i < HistogramSnapshot::BUCKET_COUNT; ++i)
+        result.buckets[i] = mBuckets[i].load(memory_order_relaxed);
+    result.sum = mSum.load(memory_order_relaxed);
+    result.max = mMax.load(memory_order_relaxed);
+    result.min = result.count ? mMin.load(memory_order_relaxed) : 0;
+    return result;
+}
+
+ControllerStatistics::ControllerStatistics()
+{
+    for (auto& counter : mFrames)
+        counter.store(0, memory_order_relaxed);
+}
+
+void ControllerStatistics::countFrame(FRAME_TYPE type)
+{
+    increment(mFrames[type]);
+}
+
+ControllerStatisticsSnapshot ControllerStatistics::snapshot() const
+{
+    ControllerStatisticsSnapshot result;
+    result.sdoRoundTrip = sdoRoundTrip.snapshot();
+    result.tpdoJitter = tpdoJitter.snapshot();
+    result.syncToPDOLatency = syncToPDOLatency.snapshot();
+    result.processTime = processTime.snapshot();
+    for (int i = 0; i < FRAME_TYPE_COUNT; ++i)
+        result.frames[i] = mFrames[i].load(memory_order_relaxed);
+    return result;
+}
+
+void ControllerStatistics::clear()
+{
+    sdoRoundTrip.clear();
+    tpdoJitter.clear();
+    syncToPDOLatency.clear();
+    processTime.clear();
+    for (auto& counter : mFrames)
+        counter.store(0, memory_order_relaxed);
+}
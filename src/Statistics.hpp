@@ -0,0 +1,137 @@
+#ifndef MOTORS_ELMO_DS402_STATISTICS_HPP
+#define MOTORS_ELMO_DS402_STATISTICS_HPP
+
+#include <atomic>
+#include <cstdint>
+
+namespace motors_elmo_ds402 {
+    /** Copy of the state of a Histogram at a given point in time
+     */
+    struct HistogramSnapshot
+    {
+        /** Bucket 0 counts the zero values, bucket i > 0 the values in
+         * [2^(i-1), 2^i). The last bucket also counts all values above its
+         * lower bound
+         */
+        static const int BUCKET_COUNT = 32;
+
+        uint64_t buckets[BUCKET_COUNT];
+        uint64_t count;
+        uint64_t sum;
+        uint64_t min;
+        uint64_t max;
+
+        HistogramSnapshot();
+
+        /** Mean of the recorded values, or zero if there are none */
+        double mean() const;
+
+        /** Upper bound of the bucket that contains the given percentile
+         *
+         * @param p the percentile, in [0, 1]
+         */
+        uint64_t percentile(double p) const;
+
+        /** Exclusive upper bound of the values counted in a bucket */
+        static uint64_t getBucketUpperBound(int bucket);
+    };
+
+    /** Fixed-memory histogram with power-of-two buckets
+     *
+     * Values are recorded by a single thread, the control thread, without
+     * locks nor read-modify-write instructions. Any other thread can take
+     * snapshot() concurrently. The fields of a snapshot are read one after
+     * the other, so a snapshot taken while values are being added may be
+     * off by the values added in between.
+     */
+    class Histogram
+    {
+    public:
+        Histogram();
+
+        /** Record a value. Must always be called from the same thread */
+        void add(uint64_t value);
+
+        /** Reset the histogram. Must be called from the thread that calls
+         * add
+         */
+        void clear();
+
+        HistogramSnapshot snapshot() const;
+
+        static int getBucket(uint64_t value);
+
+    private:
+        std::atomic<uint64_t> mBuckets[HistogramSnapshot::BUCKET_COUNT];
+        std::atomic<uint64_t> mCount;
+        std::atomic<uint64_t> mSum;
+        std::atomic<uint64_t> mMin;
+        std::atomic<uint64_t> mMax;
+    };
+
+    /** Types of frames counted by ControllerStatistics */
+    enum FRAME_TYPE
+    {
+        /** TPDOs decoded by the fast path */
+        FRAME_TPDO,
+        /** Other PDOs */
+        FRAME_PDO,
+        /** SDO upload responses */
+        FRAME_SDO,
+        /** SDO download acknowledgements */
+        FRAME_SDO_ACK,
+        FRAME_HEARTBEAT,
+        FRAME_EMERGENCY,
+        /** Frames that did not update anything */
+        FRAME_OTHER,
+        FRAME_TYPE_COUNT
+    };
+
+    /** Copy of the state of ControllerStatistics at a given point in time */
+    struct ControllerStatisticsSnapshot
+    {
+        HistogramSnapshot sdoRoundTrip;
+        HistogramSnapshot tpdoJitter;
+        HistogramSnapshot syncToPDOLatency;
+        HistogramSnapshot processTime;
+        uint64_t frames[FRAME_TYPE_COUNT];
+    };
+
+    /** Instrumentation of a Controller
+     *
+     * It is updated by the thread that calls Controller::process, and can
+     * be snapshotted by any other thread (see Histogram)
+     */
+    class ControllerStatistics
+    {
+    public:
+        /** SDO round-trip times, in microseconds */
+        Histogram sdoRoundTrip;
+        /** Difference between consecutive inter-arrival times of a TPDO, in
+         * microseconds
+         */
+        Histogram tpdoJitter;
+        /** Time between the last SYNC and the reception of the TPDOs, in
+         * microseconds
+         */
+        Histogram syncToPDOLatency;
+        /** Time spent in Controller::process, in nanoseconds */
+        Histogram processTime;
+
+        ControllerStatistics();
+
+        void countFrame(FRAME_TYPE type);
+
+        ControllerStatisticsSnapshot snapshot() const;
+
+        /** Reset all statistics. Must be called from the thread that
+         * updates them
+         */
+        void clear();
+
+    private:
+        std::atomic<uint64_t> mFrames[FRAME_TYPE_COUNT];
+    };
+}
+
+#endif
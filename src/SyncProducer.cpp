@@ -0,0 +1,153 @@
+#include <motors_elmo_ds402/SyncProducer.hpp>
+#include <motors_elmo_ds402/RealTime.hpp>
+#include <cerrno>
+#include <stdexcept>
+#include <time.h>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static const int64_t NSEC_PER_SEC = 1000000000;
+
+static int64_t getMonotonicTime()
+{
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<int64_t>(now.tv_sec) * NSEC_PER_SEC + now.tv_nsec;
+}
+
+static void sleepUntil(int64_t deadline)
+{
+    timespec time;
+    time.tv_sec = deadline / NSEC_PER_SEC;
+    time.tv_nsec = deadline % NSEC_PER_SEC;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time, NULL) == EINTR);
+}
+
+/** Increment a counter that has a single writer */
+static void increment(atomic<uint64_t>& counter, uint64_t value = 1)
+{
+    counter.store(counter.load(memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+SyncProducer::SyncProducer(canbus::Driver& device, canbus::Message const& sync,
+    Configuration const& configuration)
+    : mDevice(device)
+    , mSync(sync)
+    , mConfiguration(configuration)
+    , mRunning(false)
+    , mRealTimeFailed(false)
+    , mLastSyncTime(0)
+    , mCycles(0)
+    , mOverruns(0)
+    , mWriteErrors(0)
+{
+    if (configuration.period.toMicroseconds() <= 0)
+        throw std::invalid_argument("SyncProducer: the period must be strictly positive");
+}
+
+SyncProducer::~SyncProducer()
+{
+    stop();
+}
+
+void SyncProducer::start()
+{
+    if (isRunning())
+        throw std::logic_error("SyncProducer::start: already running");
+
+    mRealTimeFailed = false;
+    mLastSyncTime = 0;
+    mCycles = 0;
+    mOverruns = 0;
+    mWriteErrors = 0;
+    mWakeupLatency.clear();
+    mPeriodJitter.clear();
+    mRunning = true;
+
+    promise<void> setup;
+    future<void> setupDone = setup.get_future();
+    mThread = thread(&SyncProducer::run, this, std::move(setup));
+    setupDone.wait();
+}
+
+void SyncProducer::stop()
+{
+    mRunning = false;
+    if (mThread.joinable())
+        mThread.join();
+}
+
+bool SyncProducer::isRunning() const
+{
+    return mRunning;
+}
+
+bool SyncProducer::isRealTime() const
+{
+    return !mRealTimeFailed;
+}
+
+base::Time SyncProducer::getLastSyncTime() const
+{
+    return base::Time::fromMicroseconds(mLastSyncTime.load(memory_order_acquire));
+}
+
+SyncProducerStatistics SyncProducer::getStatistics() const
+{
+    SyncProducerStatistics stats;
+    stats.cycles = mCycles.load(memory_order_relaxed);
+    stats.overruns = mOverruns.load(memory_order_relaxed);
+    stats.writeErrors = mWriteErrors.load(memory_order_relaxed);
+    stats.wakeupLatency = mWakeupLatency.snapshot();
+    stats.periodJitter = mPeriodJitter.snapshot();
+    return stats;
+}
+
+void SyncProducer::run(promise<void> setup)
+{
+    bool success = true;
+    if (mConfiguration.cpu >= 0)
+        success = setCurrentThreadAffinity(mConfiguration.cpu) && success;
+    if (mConfiguration.priority > 0)
+        success = setCurrentThreadFIFOPriority(mConfiguration.priority) && success;
+    if (!success)
+        mRealTimeFailed = true;
+    setup.set_value();
+
+    int64_t const period = mConfiguration.period.toMicroseconds() * 1000;
+    int64_t deadline = getMonotonicTime() + period;
+    int64_t lastWrite = -1;
+    while (mRunning.load(memory_order_relaxed))
+    {
+        sleepUntil(deadline);
+
+        int64_t now = getMonotonicTime();
+        try {
+            mDevice.write(mSync);
+        }
+        catch(std::runtime_error const&) {
+            increment(mWriteErrors);
+        }
+        mLastSyncTime.store(base::Time::now().toMicroseconds(), memory_order_release);
+        increment(mCycles);
+
+        mWakeupLatency.add((now - deadline) / 1000);
+        if (lastWrite >= 0)
+        {
+            int64_t error = (now - lastWrite) - period;
+            mPeriodJitter.add((error < 0 ? -error : error) / 1000);
+        }
+        lastWrite = now;
+
+        // Skip the cycles we already missed instead of catching up with a
+        // burst of SYNCs
+        deadline += period;
+        if (now >= deadline)
+        {
+            int64_t missed = (now - deadline) / period + 1;
+            increment(mOverruns, missed);
+            deadline += missed * period;
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#ifndef MOTORS_ELMO_DS402_SYNC_PRODUCER_HPP
+#define MOTORS_ELMO_DS402_SYNC_PRODUCER_HPP
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <base/Time.hpp>
+#include <canbus/Driver.hpp>
+#include <canbus/Message.hpp>
+#include <motors_elmo_ds402/Statistics.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Statistics of a SyncProducer */
+    struct SyncProducerStatistics
+    {
+        /** Number of SYNC frames written */
+        uint64_t cycles;
+        /** Number of cycles skipped because the thread woke up after the
+         * deadline of the next cycle
+         */
+        uint64_t overruns;
+        /** Number of SYNC frames the device failed to write */
+        uint64_t writeErrors;
+        /** Delay between each deadline and the actual write, in
+         * microseconds
+         */
+        HistogramSnapshot wakeupLatency;
+        /** Absolute difference between the measured period and the
+         * configured one, in microseconds
+         */
+        HistogramSnapshot periodJitter;
+
+        SyncProducerStatistics()
+            : cycles(0)
+            , overruns(0)
+            , writeErrors(0) {}
+    };
+
+    /** Writes SYNC frames at a fixed rate from a dedicated thread
+     *
+     * Deadlines are absolute (clock_nanosleep with TIMER_ABSTIME on
+     * CLOCK_MONOTONIC), so the period does not drift with the time spent
+     * writing the frame or with the activity of the other threads. When a
+     * deadline is missed by more than one period, the missed cycles are
+     * skipped and counted as overruns rather than being written in a burst.
+     *
+     * The device is only written by the producer thread: it must support
+     * being read from another thread at the same time, which is the case of
+     * the socket-based canbus drivers.
+     */
+    class SyncProducer
+    {
+    public:
+        struct Configuration
+        {
+            base::Time period;
+            /** CPU the thread is pinned to, or -1 */
+            int cpu;
+            /** SCHED_FIFO priority of the thread, or 0 to keep the default
+             * scheduling
+             */
+            int priority;
+
+            Configuration()
+                : period(base::Time::fromMilliseconds(1))
+                , cpu(-1)
+                , priority(0) {}
+        };
+
+        /**
+         * @param sync the SYNC frame, usually Controller::querySync()
+         * @throws std::invalid_argument if the period is not strictly positive
+         */
+        SyncProducer(canbus::Driver& device, canbus::Message const& sync,
+            Configuration const& configuration = Configuration());
+        ~SyncProducer();
+
+        /** Start the producer thread
+         *
+         * It returns once the thread has applied its affinity and priority
+         *
+         * @throws std::logic_error if the producer is already running
+         */
+        void start();
+
+        /** Stop the producer thread. It returns within one period */
+        void stop();
+
+        bool isRunning() const;
+
+        /** Whether the thread got its requested affinity and priority
+         *
+         * Only meaningful once start() has been called
+         */
+        bool isRealTime() const;
+
+        /** Time at which the last SYNC was written, or a null time
+         *
+         * It is meant to be passed to Controller::notifySync by the thread
+         * that processes the frames
+         */
+        base::Time getLastSyncTime() const;
+
+        /** Statistics since the last call to start()
+         *
+         * It can be called from any thread
+         */
+        SyncProducerStatistics getStatistics() const;
+
+    private:
+        canbus::Driver& mDevice;
+        canbus::Message mSync;
+        Configuration mConfiguration;
+
+        std::atomic<bool> mRunning;
+        std::atomic<bool> mRealTimeFailed;
+        std::atomic<int64_t> mLastSyncTime;
+        std::atomic<uint64_t> mCycles;
+        std::atomic<uint64_t> mOverruns;
+        std::atomic<uint64_t> mWriteErrors;
+        Histogram mWakeupLatency;
+        Histogram mPeriodJitter;
+
+        std::thread mThread;
+
+        /** Thread body. setup is fulfilled once the thread got its
+         * affinity and priority, or failed to
+         */
+        void run(std::promise<void> setup);
+    };
+}
+
+#endif
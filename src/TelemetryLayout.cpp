@@ -0,0 +1,65 @@
+#include <motors_elmo_ds402/TelemetryLayout.hpp>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+bool TelemetryLayout::contains(ObjectInfo const& object) const
+{
+    for (auto const& pdo : pdos)
+    {
+        for (auto const& entry : pdo.entries)
+        {
+            if (entry.object == &object)
+                return true;
+        }
+    }
+    return false;
+}
+
+uint64_t TelemetryLayout::getUpdateIds() const
+{
+    uint64_t updateIds = 0;
+    for (auto const& pdo : pdos)
+    {
+        for (auto const& entry : pdo.entries)
+            updateIds |= entry.object->updateId;
+    }
+    return updateIds;
+}
+
+TelemetryLayout motors_elmo_ds402::packTelemetry(
+    vector<ObjectInfo const*> const& objects, int maxPDOs)
+{
+    vector<ObjectInfo const*> sorted;
+    for (auto object : objects)
+    {
+        if (!object->isReadable())
+            throw std::invalid_argument(
+                string("cannot map write-only object ") + object->name + " in a TPDO");
+        if (find(sorted.begin(), sorted.end(), object) == sorted.end())
+            sorted.push_back(object);
+    }
+    stable_sort(sorted.begin(), sorted.end(),
+        [](ObjectInfo const* a, ObjectInfo const* b) { return a->size > b->size; });
+
+    TelemetryLayout layout;
+    for (auto object : sorted)
+    {
+        auto pdo = find_if(layout.pdos.begin(), layout.pdos.end(),
+            [object](TelemetryLayout::PDO const& pdo) { return pdo.size + object->size <= 8; });
+        if (pdo == layout.pdos.end())
+        {
+            if (static_cast<int>(layout.pdos.size()) == maxPDOs)
+                throw std::invalid_argument("telemetry objects do not fit in the available TPDOs");
+            layout.pdos.push_back(TelemetryLayout::PDO());
+            pdo = layout.pdos.end() - 1;
+        }
+
+        TelemetryLayout::Entry entry = { object, pdo->size };
+        pdo->entries.push_back(entry);
+        pdo->size += object->size;
+    }
+    return layout;
+}
@@ -0,0 +1,59 @@
+#ifndef MOTORS_ELMO_DS402_TELEMETRY_LAYOUT_HPP
+#define MOTORS_ELMO_DS402_TELEMETRY_LAYOUT_HPP
+
+#include <vector>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Placement of a set of objects in TPDOs
+     *
+     * It is both the PDO mapping that should be configured on the drive, and
+     * the plan to decode the received PDOs
+     */
+    struct TelemetryLayout
+    {
+        struct Entry
+        {
+            ObjectInfo const* object;
+            /** Offset of the object in the PDO, in bytes */
+            uint8_t offset;
+        };
+
+        struct PDO
+        {
+            std::vector<Entry> entries;
+            /** Number of bytes used in the PDO */
+            uint8_t size = 0;
+        };
+
+        /** The PDOs, in order */
+        std::vector<PDO> pdos;
+
+        /** Number of PDOs, i.e. of frames the drive sends every cycle */
+        size_t getPDOCount() const { return pdos.size(); }
+
+        /** Whether the given object is part of the layout */
+        bool contains(ObjectInfo const& object) const;
+
+        /** The union of the UPDATE_ID of the objects in the layout */
+        uint64_t getUpdateIds() const;
+    };
+
+    /** Pack a set of objects into the minimum number of TPDOs
+     *
+     * The objects are placed by decreasing size in the first PDO that still
+     * has room for them (first-fit decreasing). Since the object sizes (1, 2
+     * and 4 bytes) all divide the 8-byte PDO payload, this always uses the
+     * minimum number of PDOs, that is the total size divided by 8 rounded up.
+     *
+     * Objects that appear more than once are mapped only once.
+     *
+     * @param maxPDOs the number of TPDOs available on the drive
+     * @throws std::invalid_argument if the objects do not fit in maxPDOs
+     *   PDOs, or if one of them is not readable
+     */
+    TelemetryLayout packTelemetry(std::vector<ObjectInfo const*> const& objects,
+        int maxPDOs = 4);
+}
+
+#endif
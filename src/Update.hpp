@@ -37,7 +37,7 @@ namespace motors_elmo_ds402
             return mAckedObjectID != 0;
         }
 
-        bool isAcked(uint16_t objectId, uint8_t objectSubID)
+        bool isAcked(uint16_t objectId, uint8_t objectSubID) const
         {
             return (mAckedObjectID == objectId) &&
                 (mAckedObjectSubID == objectSubID);
@@ -49,11 +49,17 @@ namespace motors_elmo_ds402
             return isUpdated(T::UPDATE_ID);
         }
 
-        bool isUpdated(uint64_t updateId)
+        bool isUpdated(uint64_t updateId) const
         {
             return (mUpdatedObjects & updateId) == updateId;
         }
 
+        /** Returns the bitmask of all the update IDs set in this update */
+        uint64_t getUpdatedObjects() const
+        {
+            return mUpdatedObjects;
+        }
+
 	void merge(Update const& update)
 	{
 	    mUpdatedObjects |= update.mUpdatedObjects;
@@ -0,0 +1,75 @@
+#include "CountingAllocator.hpp"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+static atomic<size_t> allocationCount(0);
+
+size_t motors_elmo_ds402::getAllocationCount()
+{
+    return allocationCount.load(memory_order_relaxed);
+}
+
+// The replacements are defined out of line in their own translation unit,
+// so that the compiler never pairs an inlined free() with a call to
+// operator new
+
+void* operator new(size_t size)
+{
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    if (void* ptr = malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(size_t size, std::nothrow_t const&) noexcept
+{
+    try {
+        return operator new(size);
+    }
+    catch(std::bad_alloc const&) {
+        return nullptr;
+    }
+}
+
+void* operator new[](size_t size, std::nothrow_t const& tag) noexcept
+{
+    return operator new(size, tag);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, std::nothrow_t const&) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr, std::nothrow_t const&) noexcept
+{
+    free(ptr);
+}
@@ -0,0 +1,16 @@
+#ifndef MOTORS_ELMO_DS402_TEST_COUNTING_ALLOCATOR_HPP
+#define MOTORS_ELMO_DS402_TEST_COUNTING_ALLOCATOR_HPP
+
+#include <cstddef>
+
+namespace motors_elmo_ds402 {
+    /** Number of calls to the global operator new since the start
+     *
+     * CountingAllocator.cpp replaces the global operator new and delete.
+     * It must only be linked into dedicated executables, as it affects
+     * every allocation of the program.
+     */
+    size_t getAllocationCount();
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef MOTORS_ELMO_DS402_TEST_FRAMES_HPP
+#define MOTORS_ELMO_DS402_TEST_FRAMES_HPP
+
+#include <canbus/Message.hpp>
+#include <motors_elmo_ds402/Objects.hpp>
+
+namespace motors_elmo_ds402 {
+    /** Expedited SDO upload response of a drive, as it would answer a
+     * query of the object T
+     */
+    template<typename T>
+    canbus::Message makeUploadResponse(uint8_t nodeId, uint32_t value)
+    {
+        canbus::Message msg;
+        msg.can_id = 0x580 + nodeId;
+        msg.size = 8;
+        msg.data[0] = 0x43 | ((4 - sizeof(typename T::OBJECT_TYPE)) << 2);
+        msg.data[1] = T::OBJECT_ID & 0xFF;
+        msg.data[2] = T::OBJECT_ID >> 8;
+        msg.data[3] = T::OBJECT_SUB_ID;
+        for (int i = 0; i < 4; ++i)
+            msg.data[4 + i] = (value >> (8 * i)) & 0xFF;
+        return msg;
+    }
+
+    /** EMCY frame of a drive, with the manufacturer-specific bytes set to
+     * their index in the frame
+     */
+    inline canbus::Message makeEmergency(uint8_t nodeId, uint16_t errorCode,
+        uint8_t errorRegister)
+    {
+        canbus::Message msg;
+        msg.can_id = 0x080 + nodeId;
+        msg.size = 8;
+        msg.data[0] = errorCode & 0xFF;
+        msg.data[1] = errorCode >> 8;
+        msg.data[2] = errorRegister;
+        for (int i = 3; i < 8; ++i)
+            msg.data[i] = i;
+        return msg;
+    }
+}
+
+#endif
@@ -0,0 +1,162 @@
+#include <motors_elmo_ds402/Controller.hpp>
+#include "CountingAllocator.hpp"
+#include "Frames.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+/** Prevent the compiler from optimizing away the computation of a value */
+template<typename T>
+static void doNotOptimize(T const& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct Result
+{
+    string name;
+    uint64_t iterations;
+    double nsPerOp;
+    double allocationsPerOp;
+};
+
+/** Run a benchmark, doubling the number of iterations until one run lasts
+ * at least minDuration
+ */
+template<typename F>
+static Result run(string const& name, F f, chrono::nanoseconds minDuration)
+{
+    typedef chrono::steady_clock clock;
+
+    for (uint64_t iterations = 1;; iterations *= 2)
+    {
+        size_t allocations = getAllocationCount();
+        auto start = clock::now();
+        for (uint64_t i = 0; i < iterations; ++i)
+            f();
+        auto duration = clock::now() - start;
+        allocations = getAllocationCount() - allocations;
+
+        if (duration >= minDuration || iterations >= (1ULL << 40))
+        {
+            Result result;
+            result.name = name;
+            result.iterations = iterations;
+            result.nsPerOp = static_cast<double>(
+                chrono::duration_cast<chrono::nanoseconds>(duration).count()) / iterations;
+            result.allocationsPerOp = static_cast<double>(allocations) / iterations;
+            return result;
+        }
+    }
+}
+
+static void usage()
+{
+    cerr << "motors_elmo_ds402_benchmark [--json] [--min-time MS]\n"
+         << "\n"
+         << "Measures the decode and encode hot paths, reporting ns/op and\n"
+         << "allocations/op. --json outputs the results as a JSON array\n"
+         << "--min-time is the minimum duration of each benchmark (default 200ms)\n"
+         << endl;
+}
+
+int main(int argc, char** argv)
+{
+    bool json = false;
+    chrono::nanoseconds minDuration = chrono::milliseconds(200);
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--json")
+            json = true;
+        else if (arg == "--min-time" && i + 1 < argc)
+            minDuration = chrono::milliseconds(atoi(argv[++i]));
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    uint8_t const nodeId = 1;
+    Controller controller(nodeId);
+    controller.process(makeUploadResponse<PositionEncoderResolutionNum>(nodeId, 4096));
+    controller.process(makeUploadResponse<PositionEncoderResolutionDen>(nodeId, 1));
+    controller.process(makeUploadResponse<GearRatioNum>(nodeId, 10));
+    controller.process(makeUploadResponse<GearRatioDen>(nodeId, 1));
+    controller.process(makeUploadResponse<FeedConstantNum>(nodeId, 1));
+    controller.process(makeUploadResponse<FeedConstantDen>(nodeId, 1));
+    controller.process(makeUploadResponse<MotorRatedCurrent>(nodeId, 2000));
+    controller.process(makeUploadResponse<MotorRatedTorque>(nodeId, 500));
+    controller.queryPeriodicJointStateUpdate(0, 1);
+
+    canbus::Message sdo = makeUploadResponse<PositionActualInternalValue>(nodeId, 123456);
+    // The TPDO does not carry the current
+    controller.process(makeUploadResponse<CurrentActualValue>(nodeId, 0xFC18));
+
+    canbus::Message tpdo;
+    tpdo.can_id = 0x180 + nodeId;
+    tpdo.size = 8;
+    uint8_t tpdoData[8] = { 0x40, 0xE2, 0x01, 0x00, 0x18, 0xFC, 0xFF, 0xFF };
+    memcpy(tpdo.data, tpdoData, 8);
+
+    Factors factors = controller.getFactors();
+    volatile int32_t encoderValue = 123456;
+    volatile uint16_t rawStatusWord = 0x0237;
+    ControlWord controlWord(ControlWord::ENABLE_OPERATION, false);
+
+    vector<Result> results;
+    results.push_back(run("Controller::process(SDO)", [&]() {
+        doNotOptimize(controller.process(sdo));
+    }, minDuration));
+    results.push_back(run("Controller::process(TPDO)", [&]() {
+        doNotOptimize(controller.process(tpdo));
+    }, minDuration));
+    results.push_back(run("Controller::getJointState", [&]() {
+        doNotOptimize(controller.getJointState());
+    }, minDuration));
+    results.push_back(run("Factors::scaleEncoderValue", [&]() {
+        doNotOptimize(factors.scaleEncoderValue(encoderValue));
+    }, minDuration));
+    results.push_back(run("parse<StatusWord>", [&]() {
+        doNotOptimize(parse<StatusWord, uint16_t>(rawStatusWord));
+    }, minDuration));
+    results.push_back(run("encode<ControlWord>", [&]() {
+        doNotOptimize(encode<ControlWord, uint16_t>(controlWord));
+    }, minDuration));
+
+    if (json)
+    {
+        cout << "[\n";
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            Result const& r = results[i];
+            cout << "  { \"name\": \"" << r.name << "\""
+                 << ", \"iterations\": " << r.iterations
+                 << ", \"ns_per_op\": " << r.nsPerOp
+                 << ", \"allocations_per_op\": " << r.allocationsPerOp
+                 << " }" << (i + 1 == results.size() ? "" : ",") << "\n";
+        }
+        cout << "]" << endl;
+    }
+    else
+    {
+        cout << left << setw(32) << "benchmark"
+             << right << setw(14) << "ns/op"
+             << setw(16) << "allocs/op" << "\n";
+        for (auto const& r : results)
+        {
+            cout << left << setw(32) << r.name
+                 << right << setw(14) << fixed << setprecision(2) << r.nsPerOp
+                 << setw(16) << r.allocationsPerOp << "\n";
+        }
+    }
+    return 0;
+}
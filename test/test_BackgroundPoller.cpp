@@ -0,0 +1,128 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/BackgroundPoller.hpp>
+#include <motors_elmo_ds402/SimulatedBus.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static base::Time ms(int value)
+{
+    return base::Time::fromMilliseconds(value);
+}
+
+BOOST_AUTO_TEST_SUITE(BackgroundPollerSuite)
+
+BOOST_AUTO_TEST_CASE(it_stays_within_its_load_budget)
+{
+    BusController controllers;
+    for (uint8_t nodeId = 1; nodeId <= 16; ++nodeId)
+        controllers.add(nodeId);
+
+    // 10% of 1Mbit/s is 100 bits per 1ms cycle, i.e. one transaction of
+    // two frames every three cycles
+    BackgroundPoller::Configuration configuration;
+    configuration.maxLoad = 0.1;
+    BackgroundPoller poller(controllers, configuration);
+    for (uint8_t nodeId = 1; nodeId <= 16; ++nodeId)
+        poller.add<Temperature>(nodeId);
+    BOOST_REQUIRE_THROW(poller.add<Temperature>(17), std::invalid_argument);
+
+    base::Time start = base::Time::fromSeconds(10);
+    for (int cycle = 0; cycle < 30; ++cycle)
+    {
+        base::Time now = start + ms(cycle);
+        BOOST_REQUIRE(poller.poll(now, now + ms(1)).size() <= 1);
+    }
+    BOOST_REQUIRE_EQUAL(10, poller.getSentCount());
+
+    // No room left before the next SYNC
+    BackgroundPoller unlimited(controllers);
+    unlimited.add<Temperature>(1);
+    BOOST_REQUIRE(unlimited.poll(start, start + base::Time::fromMicroseconds(100)).empty());
+    BOOST_REQUIRE_EQUAL(1, unlimited.poll(start, start + ms(1)).size());
+}
+
+BOOST_AUTO_TEST_CASE(it_leaves_room_for_the_response_before_the_next_sync)
+{
+    BusController controllers;
+    controllers.add(1);
+    controllers.add(2);
+    base::Time start = base::Time::fromSeconds(10);
+
+    // Two 135-bit frames take 270us at 1Mbit/s, and the drive answers
+    // within 200us
+    BackgroundPoller poller(controllers);
+    poller.add<Temperature>(1);
+    poller.add<Temperature>(2);
+    BOOST_REQUIRE(poller.poll(start, start + base::Time::fromMicroseconds(469)).empty());
+    BOOST_REQUIRE_EQUAL(1, poller.poll(start, start + base::Time::fromMicroseconds(739)).size());
+
+    // The second transaction follows the first one on the bus
+    BackgroundPoller both(controllers);
+    both.add<Temperature>(1);
+    both.add<Temperature>(2);
+    BOOST_REQUIRE_EQUAL(2, both.poll(start, start + base::Time::fromMicroseconds(740)).size());
+
+    BackgroundPoller::Configuration configuration;
+    configuration.responseMargin = base::Time();
+    BackgroundPoller immediate(controllers, configuration);
+    immediate.add<Temperature>(1);
+    immediate.add<Temperature>(2);
+    BOOST_REQUIRE_EQUAL(2, immediate.poll(start, start + base::Time::fromMicroseconds(540)).size());
+}
+
+BOOST_AUTO_TEST_CASE(it_reads_the_objects_of_simulated_drives_in_turn)
+{
+    SimulatedBus::Configuration busConfiguration;
+    busConfiguration.latency = base::Time::fromMicroseconds(200);
+    busConfiguration.virtualTime = true;
+    SimulatedBus bus(busConfiguration);
+    BusController controllers;
+    BackgroundPoller poller(controllers);
+    for (uint8_t nodeId = 1; nodeId <= 3; ++nodeId)
+    {
+        bus.addDrive(nodeId);
+        bus.getDrive(nodeId).set<Temperature>(40 + nodeId);
+        controllers.add(nodeId);
+        poller.add<Temperature>(nodeId);
+        poller.add<DCLinkCircuitVoltage>(nodeId);
+        poller.add<DCSupply5V>(nodeId);
+        poller.add<STOStatusRegister>(nodeId);
+        poller.add<ExtraStatusRegister>(nodeId);
+    }
+
+    for (int cycle = 0; cycle < 20; ++cycle)
+    {
+        base::Time nextSync = bus.getTime() + ms(1);
+        for (auto const& msg : poller.poll(bus.getTime(), nextSync))
+            bus.write(msg);
+        while (bus.getTime() < nextSync)
+        {
+            base::Time remaining = nextSync - bus.getTime();
+            bus.setReadTimeout(std::max<int64_t>(1, remaining.toMilliseconds()));
+            try {
+                canbus::Message msg = bus.read();
+                controllers.process(msg);
+                poller.process(msg, bus.getTime());
+            }
+            catch(std::runtime_error const&) {}
+        }
+    }
+
+    BOOST_REQUIRE_EQUAL(15, poller.getObjects().size());
+    for (auto const& object : poller.getObjects())
+    {
+        BOOST_REQUIRE(object.isValid());
+        BOOST_REQUIRE_EQUAL(0, object.failures);
+        BOOST_REQUIRE(poller.getAge(object.nodeId, *object.info, bus.getTime()) <= ms(20));
+    }
+    for (uint8_t nodeId = 1; nodeId <= 3; ++nodeId)
+    {
+        BOOST_REQUIRE_EQUAL(40 + nodeId,
+            poller.get(nodeId, getObjectInfo<Temperature>()).value);
+        BOOST_REQUIRE_EQUAL(40 + nodeId,
+            controllers.get(nodeId).getTelemetry<Temperature>());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
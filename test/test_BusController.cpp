@@ -0,0 +1,80 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/BusController.hpp>
+
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(BusControllerSuite)
+
+BOOST_AUTO_TEST_CASE(it_extracts_the_node_id_from_the_cob_id)
+{
+    BOOST_REQUIRE_EQUAL(0, BusController::getNodeIdFromCOBID(0x080));
+    BOOST_REQUIRE_EQUAL(5, BusController::getNodeIdFromCOBID(0x185));
+    BOOST_REQUIRE_EQUAL(127, BusController::getNodeIdFromCOBID(0x5FF));
+    BOOST_REQUIRE_EQUAL(42, BusController::getNodeIdFromCOBID(0x72A));
+}
+
+BOOST_AUTO_TEST_CASE(it_registers_controllers_by_node_id)
+{
+    BusController bus;
+    bus.add(3);
+    bus.add(12);
+    BOOST_REQUIRE_EQUAL(2, bus.size());
+    BOOST_REQUIRE(bus.has(3));
+    BOOST_REQUIRE(!bus.has(4));
+    BOOST_REQUIRE_EQUAL(12, bus.get(12).getNodeId());
+    BOOST_REQUIRE_THROW(bus.get(4), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_invalid_and_duplicate_node_ids)
+{
+    BusController bus;
+    bus.add(3);
+    BOOST_REQUIRE_THROW(bus.add(3), std::invalid_argument);
+    BOOST_REQUIRE_THROW(bus.add(0), std::invalid_argument);
+    BOOST_REQUIRE_THROW(bus.add(128), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(it_ignores_frames_for_unknown_nodes)
+{
+    BusController bus;
+    bus.add(3);
+    canbus::Message msg;
+    msg.can_id = 0x704;
+    msg.size = 1;
+    msg.data[0] = 0x05;
+    BOOST_REQUIRE(!bus.process(msg).isValid());
+}
+
+BOOST_AUTO_TEST_CASE(it_dispatches_frames_to_the_addressed_node)
+{
+    BusController bus;
+    bus.add(3);
+    bus.add(12);
+    canbus::Message msg;
+    msg.can_id = 0x70C;
+    msg.size = 1;
+    msg.data[0] = 0x05;
+
+    NodeUpdate update = bus.process(msg);
+    BOOST_REQUIRE(update.isValid());
+    BOOST_REQUIRE_EQUAL(12, update.nodeId);
+    BOOST_REQUIRE(update.update.isUpdated(Heartbeat::UPDATE_ID));
+    BOOST_REQUIRE_EQUAL(canopen_master::NODE_OPERATIONAL, bus.get(12).getNodeState());
+    BOOST_REQUIRE(canopen_master::NODE_OPERATIONAL != bus.get(3).getNodeState());
+}
+
+BOOST_AUTO_TEST_CASE(it_merges_updates_per_node)
+{
+    BusUpdate updates;
+    updates.merge(NodeUpdate(3, Update::UpdatedObjects(UPDATE_JOINT_POSITION)));
+    updates.merge(NodeUpdate(3, Update::UpdatedObjects(UPDATE_JOINT_VELOCITY)));
+    updates.merge(NodeUpdate(7, Update::UpdatedObjects(UPDATE_STATUS_WORD)));
+    BOOST_REQUIRE(updates.isUpdated(3, UPDATE_JOINT_POSITION | UPDATE_JOINT_VELOCITY));
+    BOOST_REQUIRE(!updates.isUpdated(3, UPDATE_STATUS_WORD));
+    BOOST_REQUIRE(updates.isUpdated(7, UPDATE_STATUS_WORD));
+    BOOST_REQUIRE(!updates.hasNode(4));
+    updates.clear();
+    BOOST_REQUIRE(!updates.hasNode(3));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
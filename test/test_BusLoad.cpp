@@ -0,0 +1,113 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/BusLoad.hpp>
+#include <motors_elmo_ds402/Controller.hpp>
+#include <motors_elmo_ds402/SimulatedBus.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(BusLoadSuite)
+
+BOOST_AUTO_TEST_CASE(it_computes_the_length_of_frames)
+{
+    BOOST_REQUIRE_EQUAL(55, getWorstCaseFrameBits(0));
+    BOOST_REQUIRE_EQUAL(135, getWorstCaseFrameBits(8));
+
+    canbus::Message msg;
+    msg.can_id = 0x181;
+    msg.size = 8;
+    for (int i = 0; i < 256; ++i)
+    {
+        for (int j = 0; j < 8; ++j)
+            msg.data[j] = (i * (j + 1) * 37) & 0xFF;
+        int bits = getFrameBits(msg);
+        BOOST_REQUIRE(bits >= 47 + 64);
+        BOOST_REQUIRE(bits <= getWorstCaseFrameBits(8));
+    }
+
+    // A run of zeroes gets a stuff bit every five bits
+    for (int j = 0; j < 8; ++j)
+        msg.data[j] = 0;
+    BOOST_REQUIRE(getFrameBits(msg) >= 47 + 64 + 64 / 5);
+    BOOST_REQUIRE_EQUAL(LOAD_TPDO, getLoadSource(msg));
+}
+
+BOOST_AUTO_TEST_CASE(it_models_the_configured_pdos_and_heartbeats)
+{
+    BusLoadModel model;
+    BOOST_REQUIRE_EQUAL(55, model.getBitsPerCycle());
+
+    // One 8-byte and one 2-byte TPDO per cycle and node
+    for (uint8_t nodeId = 1; nodeId <= 2; ++nodeId)
+    {
+        Controller controller(nodeId);
+        model.addConfiguration(controller.queryPeriodicJointStateUpdate(0, 1));
+        model.addConfiguration({ controller.sendRawObject(
+            getObjectInfo<ProducerHeartbeatTime>(), 100) });
+    }
+    BOOST_REQUIRE_EQUAL(2 * (135 + 75), model.getBitsPerCycle(LOAD_TPDO));
+    BOOST_REQUIRE_CLOSE(2 * 65 / 100.0, model.getBitsPerCycle(LOAD_HEARTBEAT), 1e-6);
+    model.validate();
+
+    // A TPDO every 10ms rather than every cycle
+    Controller slow(3);
+    model.addConfiguration(slow.queryPeriodicJointStateUpdate(0, base::Time::fromMilliseconds(10)));
+    BOOST_REQUIRE_CLOSE(2 * (135 + 75) + 21, model.getBitsPerCycle(LOAD_TPDO), 1e-6);
+    model.validate();
+
+    model.addSDOTraffic(1);
+    BOOST_REQUIRE_EQUAL(270, model.getBitsPerCycle(LOAD_SDO));
+    BOOST_REQUIRE_THROW(model.validate(), BusOverloaded);
+}
+
+BOOST_AUTO_TEST_CASE(it_measures_a_load_below_the_modelled_worst_case)
+{
+    SimulatedBus::Configuration busConfiguration;
+    busConfiguration.latency = base::Time::fromMicroseconds(100);
+    busConfiguration.virtualTime = true;
+    SimulatedBus bus(busConfiguration);
+    bus.addDrive(1);
+    Controller controller(1);
+
+    auto pdoSetup = controller.queryPeriodicJointStateUpdate(0, 1);
+    BusLoadModel model;
+    model.addConfiguration(pdoSetup);
+    for (auto const& msg : pdoSetup)
+    {
+        bus.write(msg);
+        bus.read();
+    }
+    bus.write(controller.queryNodeStateTransition(canopen_master::NODE_START));
+
+    BusLoadMeter::Configuration configuration;
+    configuration.window = base::Time::fromMilliseconds(10);
+    BusLoadMeter meter(configuration);
+    canbus::Message sync = controller.querySync();
+    bus.setReadTimeout(1);
+    for (int cycle = 0; cycle < 100; ++cycle)
+    {
+        base::Time nextSync = bus.getTime() + base::Time::fromMilliseconds(1);
+        bus.write(sync);
+        meter.add(sync, bus.getTime());
+        while (bus.getTime() < nextSync)
+        {
+            try {
+                meter.add(bus.read(), bus.getTime());
+            }
+            catch(std::runtime_error const&) {}
+        }
+    }
+    meter.update(bus.getTime());
+
+    BOOST_REQUIRE_EQUAL(300, meter.getFrameCount());
+    BOOST_REQUIRE(meter.getWindowCount() >= 9);
+    BOOST_REQUIRE(meter.getPeakLoad() <= model.getLoad());
+    BOOST_REQUIRE(meter.getLoad() > 0);
+    // One SYNC, one 8-byte and one 2-byte TPDO per cycle, with some stuff
+    // bits but less than the worst case
+    BOOST_REQUIRE(meter.getBitCount() > 100 * (47 + 111 + 63));
+    BOOST_REQUIRE(meter.getBitCount() <= 100 * model.getBitsPerCycle());
+    BOOST_REQUIRE(meter.getBitCount(LOAD_TPDO) <= 100 * model.getBitsPerCycle(LOAD_TPDO));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,90 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/BusScanner.hpp>
+#include <motors_elmo_ds402/SimulatedBus.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static SimulatedBus::Configuration makeBusConfiguration()
+{
+    SimulatedBus::Configuration configuration;
+    configuration.latency = base::Time::fromMicroseconds(200);
+    configuration.virtualTime = true;
+    return configuration;
+}
+
+static void runScan(SimulatedBus& bus, BusScanner& scanner)
+{
+    while (!scanner.isDone(bus.getTime()))
+    {
+        for (auto const& msg : scanner.poll(bus.getTime()))
+            bus.write(msg);
+
+        base::Time remaining = scanner.getNextDeadline() - bus.getTime();
+        bus.setReadTimeout(std::max<int64_t>(1, remaining.toMilliseconds()));
+        try {
+            scanner.process(bus.read());
+        }
+        catch(std::runtime_error const&) {}
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(BusScannerSuite)
+
+BOOST_AUTO_TEST_CASE(it_rejects_invalid_node_ranges)
+{
+    BusScanner::Configuration configuration;
+    configuration.firstNodeId = 0;
+    BOOST_REQUIRE_THROW(BusScanner scanner(configuration), std::invalid_argument);
+    configuration.firstNodeId = 10;
+    configuration.lastNodeId = 5;
+    BOOST_REQUIRE_THROW(BusScanner scanner(configuration), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(it_paces_the_probes_in_bursts)
+{
+    BusScanner::Configuration configuration;
+    configuration.burstSize = 10;
+    BusScanner scanner(configuration);
+
+    base::Time start = base::Time::fromSeconds(1);
+    BOOST_REQUIRE_EQUAL(10, scanner.poll(start).size());
+    BOOST_REQUIRE(scanner.poll(start).empty());
+    BOOST_REQUIRE(start + configuration.burstPeriod == scanner.getNextDeadline());
+    BOOST_REQUIRE_EQUAL(10, scanner.poll(scanner.getNextDeadline()).size());
+    BOOST_REQUIRE(!scanner.isDone(start + base::Time::fromSeconds(10)));
+}
+
+BOOST_AUTO_TEST_CASE(it_finds_the_nodes_and_their_identity_within_one_timeout)
+{
+    SimulatedBus bus(makeBusConfiguration());
+    SimulatedDrive& drive3 = bus.addDrive(3);
+    drive3.set<DeviceType>(0x00020192);
+    drive3.set<IdentityObject>(0x1234);
+    drive3.set<PALVersion>(0x0107);
+    bus.addDrive(42).set<IdentityObject>(0x5678);
+
+    BusScanner::Configuration configuration;
+    configuration.burstSize = 16;
+    BusScanner scanner(configuration);
+    base::Time start = bus.getTime();
+    runScan(bus, scanner);
+
+    // 8 bursts of probes plus the follow-ups, then one timeout
+    BOOST_REQUIRE(bus.getTime() - start < base::Time::fromMilliseconds(120));
+
+    auto nodes = scanner.getNodes();
+    BOOST_REQUIRE_EQUAL(2, nodes.size());
+    BOOST_REQUIRE_EQUAL(3, nodes[0].nodeId);
+    BOOST_REQUIRE(nodes[0].hasDeviceType);
+    BOOST_REQUIRE_EQUAL(0x00020192, nodes[0].deviceType);
+    BOOST_REQUIRE(nodes[0].hasSerialNumber);
+    BOOST_REQUIRE_EQUAL(0x1234, nodes[0].serialNumber);
+    BOOST_REQUIRE(nodes[0].hasPALVersion);
+    BOOST_REQUIRE_EQUAL(0x0107, nodes[0].palVersion);
+    BOOST_REQUIRE(nodes[0].hasNodeState);
+    BOOST_REQUIRE_EQUAL(42, nodes[1].nodeId);
+    BOOST_REQUIRE_EQUAL(0x5678, nodes[1].serialNumber);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,98 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/ConfigurationSnapshot.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+#include "Frames.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+struct ConfigurationSnapshotFixture
+{
+    string path;
+
+    ConfigurationSnapshotFixture()
+    {
+        ostringstream name;
+        name << "/tmp/motors_elmo_ds402_snapshot_" << getpid();
+        path = name.str();
+    }
+    ~ConfigurationSnapshotFixture()
+    {
+        remove(path.c_str());
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(ConfigurationSnapshotSuite, ConfigurationSnapshotFixture)
+
+BOOST_AUTO_TEST_CASE(it_only_covers_the_rw_objects_that_do_not_command_the_drive)
+{
+    BOOST_REQUIRE(ConfigurationSnapshot::isConfigurationObject(getObjectInfo<TorqueWindow>()));
+    BOOST_REQUIRE(ConfigurationSnapshot::isConfigurationObject(getObjectInfo<QuickStopOptionCode>()));
+    BOOST_REQUIRE(!ConfigurationSnapshot::isConfigurationObject(getObjectInfo<StatusWordRegister>()));
+    BOOST_REQUIRE(!ConfigurationSnapshot::isConfigurationObject(getObjectInfo<ControlWordRegister>()));
+    BOOST_REQUIRE(!ConfigurationSnapshot::isConfigurationObject(getObjectInfo<TargetPosition>()));
+
+    Controller controller(1);
+    auto queries = ConfigurationSnapshot::queryAll(controller);
+    size_t count = 0;
+    for (auto const& info : OBJECT_REGISTRY)
+        count += ConfigurationSnapshot::isConfigurationObject(info);
+    BOOST_REQUIRE_EQUAL(count, queries.size());
+}
+
+BOOST_AUTO_TEST_CASE(it_downloads_only_the_objects_that_differ)
+{
+    Controller source(1);
+    source.process(makeUploadResponse<TorqueWindow>(1, 100));
+    source.process(makeUploadResponse<QuickStopOptionCode>(1, 0xFFFE));
+    source.process(makeUploadResponse<FollowingErrorWindow>(1, 4096));
+    ConfigurationSnapshot snapshot = ConfigurationSnapshot::capture(source);
+    BOOST_REQUIRE_EQUAL(3, snapshot.size());
+    snapshot.save(path);
+
+    ConfigurationSnapshot loaded = ConfigurationSnapshot::load(path);
+    BOOST_REQUIRE_EQUAL(3, loaded.size());
+    BOOST_REQUIRE_EQUAL(3, loaded.queryCurrent(source).size());
+    BOOST_REQUIRE(loaded.queryRestore(source).empty());
+
+    Controller target(2);
+    target.process(makeUploadResponse<TorqueWindow>(2, 100));
+    target.process(makeUploadResponse<QuickStopOptionCode>(2, 2));
+    auto downloads = loaded.queryRestore(target);
+    BOOST_REQUIRE_EQUAL(2, downloads.size());
+    BOOST_REQUIRE_EQUAL(0x602, downloads[0].can_id);
+    BOOST_REQUIRE_EQUAL(0x2B, downloads[0].data[0]);
+    BOOST_REQUIRE_EQUAL(0x5A, downloads[0].data[1]);
+    BOOST_REQUIRE_EQUAL(0xFE, downloads[0].data[4]);
+    BOOST_REQUIRE_EQUAL(0xFF, downloads[0].data[5]);
+    BOOST_REQUIRE_EQUAL(0x65, downloads[1].data[1]);
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_snapshots_of_non_configuration_objects)
+{
+    ofstream(path.c_str()) << "6040 00 000f ControlWordRegister\n";
+    BOOST_REQUIRE_THROW(ConfigurationSnapshot::load(path), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_values_out_of_the_range_of_their_object)
+{
+    ofstream(path.c_str())
+        << "1017 00 0064 ProducerHeartbeatTime\n"
+        << "605a 00 1ffff QuickStopOptionCode\n";
+    try {
+        ConfigurationSnapshot::load(path);
+        BOOST_FAIL("load did not throw");
+    }
+    catch(std::runtime_error const& e) {
+        BOOST_REQUIRE(string(e.what()).find(path + ":2:") != string::npos);
+    }
+
+    ofstream(path.c_str()) << "605a 00 ffff QuickStopOptionCode\n";
+    BOOST_REQUIRE_NO_THROW(ConfigurationSnapshot::load(path));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
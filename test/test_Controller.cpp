@@ -0,0 +1,380 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/Controller.hpp>
+#include "Frames.hpp"
+#include <cstring>
+
+using namespace motors_elmo_ds402;
+
+static void loadFactors(Controller& controller, uint32_t encoderTicks,
+    uint32_t ratedCurrent_mA, uint32_t ratedTorque_mNm)
+{
+    uint8_t nodeId = controller.getNodeId();
+    controller.process(makeUploadResponse<PositionEncoderResolutionNum>(nodeId, encoderTicks));
+    controller.process(makeUploadResponse<PositionEncoderResolutionDen>(nodeId, 1));
+    controller.process(makeUploadResponse<GearRatioNum>(nodeId, 1));
+    controller.process(makeUploadResponse<GearRatioDen>(nodeId, 1));
+    controller.process(makeUploadResponse<FeedConstantNum>(nodeId, 1));
+    controller.process(makeUploadResponse<FeedConstantDen>(nodeId, 1));
+    controller.process(makeUploadResponse<MotorRatedCurrent>(nodeId, ratedCurrent_mA));
+    controller.process(makeUploadResponse<MotorRatedTorque>(nodeId, ratedTorque_mNm));
+}
+
+BOOST_AUTO_TEST_SUITE(ControllerSuite)
+
+BOOST_AUTO_TEST_CASE(it_updates_the_factors_only_once_all_inputs_are_received)
+{
+    Controller controller(1);
+    controller.process(makeUploadResponse<PositionEncoderResolutionNum>(1, 4096));
+    controller.process(makeUploadResponse<PositionEncoderResolutionDen>(1, 1));
+    controller.process(makeUploadResponse<GearRatioNum>(1, 10));
+    controller.process(makeUploadResponse<GearRatioDen>(1, 1));
+    controller.process(makeUploadResponse<FeedConstantNum>(1, 1));
+    controller.process(makeUploadResponse<FeedConstantDen>(1, 1));
+    controller.process(makeUploadResponse<MotorRatedCurrent>(1, 2000));
+    BOOST_REQUIRE_EQUAL(1, controller.getFactors().encoderTicks);
+
+    Update update = controller.process(makeUploadResponse<MotorRatedTorque>(1, 500));
+    BOOST_REQUIRE(update.isUpdated(UPDATE_FACTORS));
+    Factors factors = controller.getFactors();
+    BOOST_REQUIRE_EQUAL(4096, factors.encoderTicks);
+    BOOST_REQUIRE_EQUAL(10, factors.gearMotorShaftRevolutions);
+    BOOST_REQUIRE_EQUAL(2, factors.ratedCurrent);
+    BOOST_REQUIRE_EQUAL(0.5, factors.ratedTorque);
+    BOOST_REQUIRE_EQUAL(40960, factors.positionDenominator);
+}
+
+BOOST_AUTO_TEST_CASE(it_keeps_the_previous_factors_if_the_drive_reports_a_zero_term)
+{
+    Controller controller(1);
+    loadFactors(controller, 4096, 2000, 500);
+    controller.process(makeUploadResponse<VelocityFactorNum>(1, 10));
+    BOOST_REQUIRE(!controller.hasInvalidFactors());
+
+    BOOST_REQUIRE_NO_THROW(controller.process(makeUploadResponse<VelocityFactorNum>(1, 0)));
+    BOOST_REQUIRE(controller.hasInvalidFactors());
+    BOOST_REQUIRE_EQUAL(10, controller.getFactors().velocityFactorNum);
+    BOOST_REQUIRE_NO_THROW(controller.process(makeUploadResponse<VelocityFactorDen>(1, 2)));
+    BOOST_REQUIRE(controller.hasInvalidFactors());
+    BOOST_REQUIRE_EQUAL(1, controller.getFactors().velocityFactorDen);
+
+    controller.process(makeUploadResponse<VelocityFactorNum>(1, 5));
+    BOOST_REQUIRE(!controller.hasInvalidFactors());
+    BOOST_REQUIRE_EQUAL(5, controller.getFactors().velocityFactorNum);
+    BOOST_REQUIRE_EQUAL(2, controller.getFactors().velocityFactorDen);
+}
+
+BOOST_AUTO_TEST_CASE(it_computes_the_rated_torque_from_the_motor_parameters)
+{
+    Controller controller(1);
+    controller.process(makeUploadResponse<PositionEncoderResolutionNum>(1, 4096));
+    controller.process(makeUploadResponse<PositionEncoderResolutionDen>(1, 1));
+    controller.process(makeUploadResponse<GearRatioNum>(1, 1));
+    controller.process(makeUploadResponse<GearRatioDen>(1, 1));
+    controller.process(makeUploadResponse<FeedConstantNum>(1, 1));
+    controller.process(makeUploadResponse<FeedConstantDen>(1, 1));
+    controller.process(makeUploadResponse<MotorRatedCurrent>(1, 2000));
+
+    MotorParameters parameters;
+    parameters.gearMotorShaftRevolutions = 5;
+    parameters.torqueConstant = 0.1;
+    controller.setMotorParameters(parameters);
+
+    Factors factors = controller.getFactors();
+    BOOST_REQUIRE_EQUAL(5, factors.gearMotorShaftRevolutions);
+    BOOST_REQUIRE_CLOSE(0.2, factors.ratedTorque, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(it_requires_the_rated_current_to_apply_the_torque_constant)
+{
+    Controller controller(1);
+    MotorParameters parameters;
+    parameters.torqueConstant = 0.1;
+    BOOST_REQUIRE_THROW(controller.setMotorParameters(parameters), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(it_decodes_the_joint_state_pdos_into_the_sample)
+{
+    Controller controller(2);
+    controller.queryPeriodicJointStateUpdate(1, 1);
+
+    canbus::Message msg;
+    msg.can_id = 0x282;
+    msg.size = 8;
+    uint8_t pdo0[8] = { 0x10, 0x27, 0, 0, 0xFF, 0xFF, 0xFF, 0xFF };
+    std::memcpy(msg.data, pdo0, 8);
+    Update update = controller.process(msg);
+    BOOST_REQUIRE(update.isUpdated(UPDATE_JOINT_POSITION | UPDATE_JOINT_VELOCITY));
+    BOOST_REQUIRE(!update.isUpdated(UPDATE_JOINT_CURRENT));
+
+    msg.can_id = 0x382;
+    msg.size = 2;
+    msg.data[0] = 0x18;
+    msg.data[1] = 0xFC;
+    update = controller.process(msg);
+    BOOST_REQUIRE(update.isUpdated(UPDATE_JOINT_CURRENT));
+
+    JointStateSample sample = controller.getJointStateSample();
+    BOOST_REQUIRE_EQUAL(10000, sample.position);
+    BOOST_REQUIRE_EQUAL(-1, sample.velocity);
+    BOOST_REQUIRE_EQUAL(-1000, sample.current);
+}
+
+BOOST_AUTO_TEST_CASE(it_refuses_to_return_the_state_before_it_is_received)
+{
+    Controller controller(2);
+    controller.queryPeriodicJointStateUpdate(1, 1);
+    BOOST_REQUIRE_THROW(controller.getStatusWord(), canopen_master::ObjectNotRead);
+    BOOST_REQUIRE_THROW(controller.getJointState(), canopen_master::ObjectNotRead);
+    BOOST_REQUIRE_EQUAL(0, controller.getJointStateFields());
+
+    canbus::Message msg;
+    msg.can_id = 0x282;
+    msg.size = 8;
+    std::memset(msg.data, 0, 8);
+    controller.process(msg);
+    BOOST_REQUIRE_EQUAL(UPDATE_JOINT_POSITION | UPDATE_JOINT_VELOCITY,
+        controller.getJointStateFields());
+    BOOST_REQUIRE(controller.hasTelemetry<VelocityActualValue>());
+    BOOST_REQUIRE(!controller.hasTelemetry<CurrentActualValue>());
+    BOOST_REQUIRE_THROW(controller.getJointState(), canopen_master::ObjectNotRead);
+    base::JointState state = controller.getJointState(UPDATE_JOINT_POSITION | UPDATE_JOINT_VELOCITY);
+    BOOST_REQUIRE_EQUAL(0, state.speed);
+    BOOST_REQUIRE(base::isUnknown(state.effort));
+}
+
+BOOST_AUTO_TEST_CASE(it_ignores_truncated_joint_state_pdos)
+{
+    Controller controller(2);
+    controller.queryPeriodicJointStateUpdate(0, 1);
+
+    canbus::Message msg;
+    msg.can_id = 0x182;
+    msg.size = 4;
+    BOOST_REQUIRE(!controller.process(msg).isUpdated(UPDATE_JOINT_POSITION));
+}
+
+BOOST_AUTO_TEST_CASE(it_updates_the_sample_from_sdo_uploads)
+{
+    Controller controller(1);
+    controller.process(makeUploadResponse<PositionActualInternalValue>(1, 1234));
+    controller.process(makeUploadResponse<CurrentActualValue>(1, 0xFFFF));
+    BOOST_REQUIRE_EQUAL(1234, controller.getJointStateSample().position);
+    BOOST_REQUIRE_EQUAL(-1, controller.getJointStateSample().current);
+}
+
+BOOST_AUTO_TEST_CASE(it_decodes_telemetry_pdos)
+{
+    Controller controller(2);
+    auto layout = packTelemetry({
+        &getObjectInfo<StatusWordRegister>(),
+        &getObjectInfo<TorqueDemand>(),
+        &getObjectInfo<PositionActualInternalValue>()
+    });
+    canopen_master::PDOCommunicationParameters parameters;
+    controller.queryPeriodicTelemetryUpdate(0, parameters, layout);
+
+    canbus::Message msg;
+    msg.can_id = 0x182;
+    msg.size = 8;
+    uint8_t pdo[8] = { 0x10, 0x27, 0, 0, 0x27, 0x02, 0xFE, 0xFF };
+    std::memcpy(msg.data, pdo, 8);
+    Update update = controller.process(msg);
+    BOOST_REQUIRE(update.isUpdated(UPDATE_TELEMETRY | UPDATE_STATUS_WORD |
+        UPDATE_JOINT_POSITION));
+
+    BOOST_REQUIRE_EQUAL(10000, controller.getJointStateSample().position);
+    BOOST_REQUIRE_EQUAL(10000, controller.getTelemetry<PositionActualInternalValue>());
+    BOOST_REQUIRE_EQUAL(-2, controller.getTelemetry<TorqueDemand>());
+    BOOST_REQUIRE_EQUAL(StatusWord::OPERATION_ENABLED, controller.getStatusWord().state);
+}
+
+BOOST_AUTO_TEST_CASE(it_updates_the_telemetry_values_from_sdo_uploads)
+{
+    Controller controller(1);
+    BOOST_REQUIRE(!controller.hasTelemetry<Temperature>());
+    controller.process(makeUploadResponse<Temperature>(1, 45));
+    BOOST_REQUIRE(controller.hasTelemetry<Temperature>());
+    BOOST_REQUIRE(controller.hasTelemetry(getObjectInfo<Temperature>()));
+    BOOST_REQUIRE_EQUAL(45, controller.getTelemetry<Temperature>());
+}
+
+BOOST_AUTO_TEST_CASE(it_encodes_position_setpoints_in_the_command_rpdo)
+{
+    Controller controller(3);
+    loadFactors(controller, 4096, 2000, 500);
+    auto messages = controller.queryCyclicCommand(1,
+        OperationMode::CYCLIC_SYNCHRONOUS_POSITION);
+    BOOST_REQUIRE(!messages.empty());
+
+    canbus::Message msg = controller.commandJoint(base::JointState::Position(-M_PI));
+    BOOST_REQUIRE_EQUAL(0x303, msg.can_id);
+    BOOST_REQUIRE_EQUAL(6, msg.size);
+    BOOST_REQUIRE_EQUAL(0x0F, msg.data[0]);
+    BOOST_REQUIRE_EQUAL(0x00, msg.data[1]);
+    int32_t target = msg.data[2] | msg.data[3] << 8 | msg.data[4] << 16 | msg.data[5] << 24;
+    BOOST_REQUIRE_EQUAL(-2048, target);
+}
+
+BOOST_AUTO_TEST_CASE(it_encodes_velocity_setpoints_in_the_command_rpdo)
+{
+    Controller controller(3);
+    loadFactors(controller, 4096, 2000, 500);
+    controller.process(makeUploadResponse<VelocityFactorNum>(3, 10));
+    controller.process(makeUploadResponse<VelocityFactorDen>(3, 1));
+    controller.queryCyclicCommand(1, OperationMode::CYCLIC_SYNCHRONOUS_VELOCITY);
+
+    base::JointState setpoint;
+    setpoint.speed = -M_PI;
+    canbus::Message msg = controller.commandJoint(setpoint);
+    BOOST_REQUIRE_EQUAL(0x303, msg.can_id);
+    BOOST_REQUIRE_EQUAL(6, msg.size);
+    int32_t target = msg.data[2] | msg.data[3] << 8 | msg.data[4] << 16 | msg.data[5] << 24;
+    BOOST_REQUIRE_EQUAL(-20480, target);
+}
+
+BOOST_AUTO_TEST_CASE(it_refuses_setpoints_out_of_the_range_of_the_target_object)
+{
+    Controller controller(3);
+    loadFactors(controller, 4096, 2000, 500);
+    controller.queryCyclicCommand(0, OperationMode::CYCLIC_SYNCHRONOUS_TORQUE);
+    base::JointState setpoint;
+    setpoint.effort = 20;
+    BOOST_REQUIRE_THROW(controller.commandJoint(setpoint), std::invalid_argument);
+    setpoint.effort = -20;
+    BOOST_REQUIRE_THROW(controller.commandJoint(setpoint), std::invalid_argument);
+
+    controller.queryCyclicCommand(0, OperationMode::CYCLIC_SYNCHRONOUS_POSITION);
+    BOOST_REQUIRE_THROW(controller.commandJoint(base::JointState::Position(1e7)),
+        std::invalid_argument);
+    BOOST_REQUIRE_THROW(controller.commandJoint(base::JointState::Position(INFINITY)),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(it_encodes_torque_setpoints_in_the_command_rpdo)
+{
+    Controller controller(3);
+    loadFactors(controller, 4096, 2000, 500);
+    controller.queryCyclicCommand(0, OperationMode::CYCLIC_SYNCHRONOUS_TORQUE);
+    controller.setCommandControlWord(ControlWord(ControlWord::SHUTDOWN, false));
+
+    base::JointState setpoint;
+    setpoint.effort = 0.25;
+    canbus::Message msg = controller.commandJoint(setpoint);
+    BOOST_REQUIRE_EQUAL(0x203, msg.can_id);
+    BOOST_REQUIRE_EQUAL(4, msg.size);
+    BOOST_REQUIRE_EQUAL(0x06, msg.data[0]);
+    BOOST_REQUIRE_EQUAL(500, msg.data[2] | msg.data[3] << 8);
+}
+
+BOOST_AUTO_TEST_CASE(it_encodes_the_joint_limits)
+{
+    Controller controller(3);
+    loadFactors(controller, 4096, 2000, 500);
+
+    base::JointLimitRange limits;
+    limits.min.position = -M_PI;
+    limits.max.position = M_PI;
+    limits.max.effort = 0.25;
+    auto messages = controller.setJointLimits(limits);
+    BOOST_REQUIRE_EQUAL(3, messages.size());
+    BOOST_REQUIRE_EQUAL(500, messages[2].data[4] | messages[2].data[5] << 8);
+
+    limits.max.position = base::infinity<double>();
+    BOOST_REQUIRE_THROW(controller.setJointLimits(limits), std::invalid_argument);
+    limits.min.position = -base::infinity<double>();
+    messages = controller.setJointLimits(limits);
+    BOOST_REQUIRE_EQUAL(0, messages[0].data[4]);
+    BOOST_REQUIRE_EQUAL(0, messages[1].data[4]);
+}
+
+BOOST_AUTO_TEST_CASE(it_converts_the_speed_limit_with_the_velocity_factor)
+{
+    Controller controller(3);
+    loadFactors(controller, 4096, 2000, 500);
+    controller.process(makeUploadResponse<VelocityFactorNum>(3, 10));
+    controller.process(makeUploadResponse<VelocityFactorDen>(3, 1));
+
+    // Same encoding as the velocity setpoints
+    base::JointLimitRange limits;
+    limits.max.speed = 2 * M_PI;
+    auto messages = controller.setJointLimits(limits);
+    BOOST_REQUIRE_EQUAL(1, messages.size());
+    int32_t raw;
+    std::memcpy(&raw, &messages[0].data[4], 4);
+    BOOST_REQUIRE_EQUAL(40960, raw);
+
+    controller.process(makeUploadResponse<SoftwarePositionLimitMin>(3, 0));
+    controller.process(makeUploadResponse<SoftwarePositionLimitMax>(3, 0));
+    controller.process(makeUploadResponse<MaxMotorSpeed>(3, 40960));
+    controller.process(makeUploadResponse<MaxCurrent>(3, 1000));
+    limits = controller.getJointLimits();
+    BOOST_REQUIRE_CLOSE(2 * M_PI, limits.max.speed, 1e-9);
+    BOOST_REQUIRE_CLOSE(-2 * M_PI, limits.min.speed, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(it_refuses_joint_limits_out_of_the_range_of_their_object)
+{
+    Controller controller(3);
+    loadFactors(controller, 4096, 2000, 500);
+
+    base::JointLimitRange limits;
+    limits.max.effort = -0.25;
+    BOOST_REQUIRE_THROW(controller.setJointLimits(limits), std::invalid_argument);
+    limits.max.effort = 100;
+    BOOST_REQUIRE_THROW(controller.setJointLimits(limits), std::invalid_argument);
+
+    limits = base::JointLimitRange();
+    limits.max.speed = -1;
+    BOOST_REQUIRE_THROW(controller.setJointLimits(limits), std::invalid_argument);
+    limits.max.speed = 1e7;
+    BOOST_REQUIRE_THROW(controller.setJointLimits(limits), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(it_refuses_to_encode_setpoints_without_a_command_rpdo)
+{
+    Controller controller(3);
+    BOOST_REQUIRE_THROW(controller.commandJoint(base::JointState::Position(0)),
+        std::logic_error);
+    controller.queryCyclicCommand(0, OperationMode::CYCLIC_SYNCHRONOUS_VELOCITY);
+    BOOST_REQUIRE_THROW(controller.commandJoint(base::JointState::Position(0)),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(it_decodes_emergency_frames)
+{
+    Controller controller(4);
+    BOOST_REQUIRE(controller.getEmergencies().empty());
+    BOOST_REQUIRE(!controller.process(makeEmergency(5, 0x2310, 0x03)).isUpdated(UPDATE_EMERGENCY));
+
+    Update update = controller.process(makeEmergency(4, 0x2310, 0x03));
+    BOOST_REQUIRE(update.isUpdated(UPDATE_EMERGENCY));
+    BOOST_REQUIRE_EQUAL(1, controller.getEmergencies().size());
+    Emergency const& emergency = controller.getEmergencies().getLast();
+    BOOST_REQUIRE_EQUAL(0x2310, emergency.errorCode);
+    BOOST_REQUIRE_EQUAL(0x03, emergency.errorRegister);
+    BOOST_REQUIRE_EQUAL(3, emergency.data[0]);
+    BOOST_REQUIRE_EQUAL(7, emergency.data[4]);
+    BOOST_REQUIRE_EQUAL(0x2310, controller.getTelemetry<ErrorCode>());
+    BOOST_REQUIRE_EQUAL(0x03, controller.getTelemetry<ErrorRegister>());
+    BOOST_REQUIRE_EQUAL(1, controller.getStatistics().snapshot().frames[FRAME_EMERGENCY]);
+}
+
+BOOST_AUTO_TEST_CASE(it_keeps_the_last_emergencies)
+{
+    Controller controller(4);
+    int const capacity = EmergencyHistory::CAPACITY;
+    for (int i = 0; i < capacity + 2; ++i)
+        controller.process(makeEmergency(4, 0x3200 + i, 0));
+
+    EmergencyHistory const& history = controller.getEmergencies();
+    BOOST_REQUIRE_EQUAL(capacity, history.size());
+    BOOST_REQUIRE_EQUAL(capacity + 2, history.getTotalCount());
+    BOOST_REQUIRE_EQUAL(0x3200 + capacity + 1, history.get(0).errorCode);
+    BOOST_REQUIRE_EQUAL(0x3202, history.get(capacity - 1).errorCode);
+    BOOST_REQUIRE_THROW(history.get(capacity), std::out_of_range);
+
+    controller.process(makeEmergency(4, 0, 0));
+    BOOST_REQUIRE(history.getLast().isErrorReset());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
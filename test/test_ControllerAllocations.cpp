@@ -0,0 +1,46 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/Controller.hpp>
+#include "CountingAllocator.hpp"
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(ControllerAllocationsSuite)
+
+BOOST_AUTO_TEST_CASE(polling_queries_do_not_allocate)
+{
+    Controller controller(0x05);
+    canbus::Message buffer[Controller::FACTORS_QUERY_SIZE +
+                           Controller::JOINT_STATE_QUERY_SIZE +
+                           Controller::JOINT_LIMITS_QUERY_SIZE];
+
+    size_t before = getAllocationCount();
+    for (int i = 0; i < 100; ++i)
+    {
+        canbus::Message* out = buffer;
+        out = controller.queryFactors(out);
+        out = controller.queryJointState(out);
+        out = controller.queryJointLimits(out);
+        BOOST_REQUIRE(out == buffer + sizeof(buffer) / sizeof(buffer[0]));
+    }
+    BOOST_REQUIRE_EQUAL(before, getAllocationCount());
+}
+
+BOOST_AUTO_TEST_CASE(the_templates_match_the_vector_queries)
+{
+    Controller controller(0x05);
+    canbus::Message buffer[Controller::JOINT_LIMITS_QUERY_SIZE];
+    controller.queryJointLimits(buffer);
+
+    auto expected = controller.queryJointLimits();
+    BOOST_REQUIRE_EQUAL(expected.size(), sizeof(buffer) / sizeof(buffer[0]));
+    for (size_t i = 0; i < expected.size(); ++i)
+    {
+        BOOST_REQUIRE_EQUAL(expected[i].can_id, buffer[i].can_id);
+        BOOST_REQUIRE_EQUAL(expected[i].size, buffer[i].size);
+        for (int b = 0; b < 8; ++b)
+            BOOST_REQUIRE_EQUAL(expected[i].data[b], buffer[i].data[b]);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
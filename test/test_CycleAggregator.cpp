@@ -0,0 +1,98 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/CycleAggregator.hpp>
+
+using namespace motors_elmo_ds402;
+
+static NodeUpdate makeUpdate(uint8_t nodeId, uint64_t updateId)
+{
+    return NodeUpdate(nodeId, Update::UpdatedObjects(updateId));
+}
+
+static base::Time ms(int value)
+{
+    return base::Time::fromMilliseconds(value);
+}
+
+struct CycleAggregatorFixture
+{
+    BusController bus;
+    CycleAggregator aggregator;
+
+    CycleAggregatorFixture()
+        : aggregator(bus, ms(2))
+    {
+        bus.add(1);
+        bus.add(2);
+        aggregator.expect(1);
+        aggregator.expect(2, UPDATE_JOINT_POSITION);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(CycleAggregatorSuite, CycleAggregatorFixture)
+
+BOOST_AUTO_TEST_CASE(it_rejects_unknown_nodes)
+{
+    BOOST_REQUIRE_THROW(aggregator.expect(3), std::invalid_argument);
+    aggregator.sync(ms(0));
+    BOOST_REQUIRE_THROW(aggregator.expect(1), std::logic_error);
+}
+
+BOOST_AUTO_TEST_CASE(it_completes_the_cycle_on_the_last_expected_update)
+{
+    BOOST_REQUIRE_EQUAL(CYCLE_IDLE, aggregator.getStatus());
+    BOOST_REQUIRE_EQUAL(CYCLE_PENDING, aggregator.sync(ms(10)));
+    BOOST_REQUIRE(ms(12) == aggregator.getDeadline());
+
+    BOOST_REQUIRE_EQUAL(CYCLE_PENDING,
+        aggregator.process(makeUpdate(1, UPDATE_JOINT_POSITION), ms(10)));
+    BOOST_REQUIRE_EQUAL(CYCLE_PENDING,
+        aggregator.process(makeUpdate(2, UPDATE_JOINT_STATE), ms(10)));
+    BOOST_REQUIRE_EQUAL(CYCLE_PENDING,
+        aggregator.process(makeUpdate(3, UPDATE_JOINT_STATE), ms(10)));
+    BOOST_REQUIRE_EQUAL(CYCLE_COMPLETE,
+        aggregator.process(makeUpdate(1, UPDATE_JOINT_VELOCITY | UPDATE_JOINT_CURRENT), ms(11)));
+    BOOST_REQUIRE_EQUAL(CYCLE_IDLE, aggregator.getStatus());
+
+    CycleFrame const& frame = aggregator.getFrame();
+    BOOST_REQUIRE_EQUAL(1, frame.index);
+    BOOST_REQUIRE(frame.complete);
+    BOOST_REQUIRE(ms(10) == frame.sync);
+    BOOST_REQUIRE(ms(11) == frame.end);
+    BOOST_REQUIRE_EQUAL(2, frame.axes.size());
+    BOOST_REQUIRE_EQUAL(1, frame.axes[0].nodeId);
+    BOOST_REQUIRE(ms(11) == frame.axes[0].time);
+    BOOST_REQUIRE_EQUAL(2, frame.axes[1].nodeId);
+    BOOST_REQUIRE(ms(10) == frame.axes[1].time);
+    BOOST_REQUIRE_EQUAL(1, aggregator.getStatistics().complete);
+}
+
+BOOST_AUTO_TEST_CASE(it_flags_missing_and_late_axes)
+{
+    aggregator.sync(ms(10));
+    aggregator.process(makeUpdate(2, UPDATE_JOINT_POSITION), ms(10));
+    BOOST_REQUIRE_EQUAL(CYCLE_PENDING, aggregator.checkDeadline(ms(11)));
+    BOOST_REQUIRE_EQUAL(CYCLE_INCOMPLETE, aggregator.checkDeadline(ms(12)));
+
+    CycleFrame const& frame = aggregator.getFrame();
+    BOOST_REQUIRE(!frame.complete);
+    BOOST_REQUIRE_EQUAL(1, frame.missing);
+    BOOST_REQUIRE(!frame.axes[0].received);
+    BOOST_REQUIRE(frame.axes[1].received);
+
+    aggregator.process(makeUpdate(1, UPDATE_JOINT_STATE), ms(13));
+    aggregator.process(makeUpdate(1, UPDATE_JOINT_STATE), ms(13));
+    BOOST_REQUIRE_EQUAL(1, aggregator.getStatistics().lateFrames);
+    BOOST_REQUIRE_EQUAL(1, aggregator.getStatistics().missingFrames);
+}
+
+BOOST_AUTO_TEST_CASE(a_new_sync_closes_a_pending_cycle)
+{
+    aggregator.sync(ms(10));
+    aggregator.process(makeUpdate(1, UPDATE_JOINT_STATE), ms(10));
+    BOOST_REQUIRE_EQUAL(CYCLE_INCOMPLETE, aggregator.sync(ms(11)));
+    BOOST_REQUIRE_EQUAL(1, aggregator.getFrame().index);
+    BOOST_REQUIRE_EQUAL(1, aggregator.getStatistics().incomplete);
+    BOOST_REQUIRE_EQUAL(CYCLE_PENDING, aggregator.getStatus());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,227 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/EnableSequencer.hpp>
+#include <motors_elmo_ds402/SimulatedBus.hpp>
+#include <motors_elmo_ds402/TelemetryLayout.hpp>
+#include "Frames.hpp"
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static const base::Time SYNC_PERIOD = base::Time::fromMilliseconds(1);
+
+static SimulatedBus::Configuration makeBusConfiguration()
+{
+    SimulatedBus::Configuration configuration;
+    configuration.latency = base::Time::fromMicroseconds(200);
+    configuration.virtualTime = true;
+    return configuration;
+}
+
+static void loadFactors(Controller& controller)
+{
+    uint8_t nodeId = controller.getNodeId();
+    controller.process(makeUploadResponse<PositionEncoderResolutionNum>(nodeId, 4096));
+    controller.process(makeUploadResponse<PositionEncoderResolutionDen>(nodeId, 1));
+    controller.process(makeUploadResponse<GearRatioNum>(nodeId, 1));
+    controller.process(makeUploadResponse<GearRatioDen>(nodeId, 1));
+    controller.process(makeUploadResponse<FeedConstantNum>(nodeId, 1));
+    controller.process(makeUploadResponse<FeedConstantDen>(nodeId, 1));
+    controller.process(makeUploadResponse<MotorRatedCurrent>(nodeId, 2000));
+    controller.process(makeUploadResponse<MotorRatedTorque>(nodeId, 500));
+}
+
+/** Run SDO transactions to completion */
+static void runSDOs(SimulatedBus& bus, BusController& controllers,
+    vector<canbus::Message> const& queries)
+{
+    SDOScheduler scheduler;
+    scheduler.push(queries);
+    while (!scheduler.isDone())
+    {
+        for (auto const& msg : scheduler.poll(bus.getTime()))
+            bus.write(msg);
+        try {
+            canbus::Message msg = bus.read();
+            controllers.process(msg);
+            scheduler.process(msg, bus.getTime());
+        }
+        catch(std::runtime_error const&) {}
+    }
+    BOOST_REQUIRE(scheduler.getFailures().empty());
+}
+
+/** Run the sequencer until done, optionally sending a SYNC every
+ * millisecond
+ */
+static void runSequencer(SimulatedBus& bus, BusController& controllers,
+    EnableSequencer& sequencer, bool sync)
+{
+    base::Time nextSync = bus.getTime();
+    while (!sequencer.isDone())
+    {
+        base::Time now = bus.getTime();
+        if (sync && !(now < nextSync))
+        {
+            bus.write(controllers.querySync());
+            nextSync = now + SYNC_PERIOD;
+        }
+        for (auto const& msg : sequencer.poll(now))
+            bus.write(msg);
+
+        base::Time deadline = sequencer.getNextDeadline();
+        if (sync && (deadline.isNull() || nextSync < deadline))
+            deadline = nextSync;
+        base::Time remaining = deadline - bus.getTime();
+        bus.setReadTimeout(std::max<int64_t>(1, remaining.toMilliseconds()));
+        try {
+            sequencer.process(bus.read(), bus.getTime());
+        }
+        catch(std::runtime_error const&) {}
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(EnableSequencerSuite)
+
+BOOST_AUTO_TEST_CASE(it_rejects_nodes_that_are_not_on_the_bus)
+{
+    BusController controllers;
+    EnableSequencer sequencer(controllers);
+    BOOST_REQUIRE_THROW(sequencer.enable(3, base::Time()), std::invalid_argument);
+    BOOST_REQUIRE(sequencer.isDone());
+}
+
+BOOST_AUTO_TEST_CASE(it_enables_and_disables_nodes_in_parallel_through_sdos)
+{
+    SimulatedBus bus(makeBusConfiguration());
+    BusController controllers;
+    for (uint8_t nodeId = 1; nodeId <= 4; ++nodeId)
+    {
+        bus.addDrive(nodeId);
+        controllers.add(nodeId);
+    }
+
+    EnableSequencer sequencer(controllers);
+    for (uint8_t nodeId = 1; nodeId <= 4; ++nodeId)
+        sequencer.enable(nodeId, bus.getTime());
+    runSequencer(bus, controllers, sequencer, false);
+
+    auto results = sequencer.getResults();
+    BOOST_REQUIRE_EQUAL(4, results.size());
+    for (auto const& result : results)
+    {
+        BOOST_REQUIRE_EQUAL(ENABLE_DONE, result.status);
+        BOOST_REQUIRE(!result.usedPDO);
+        BOOST_REQUIRE_EQUAL(StatusWord::OPERATION_ENABLED,
+            bus.getDrive(result.nodeId).getState());
+        // Four status queries and three control words, all nodes overlapping
+        BOOST_REQUIRE(result.duration < base::Time::fromMilliseconds(4));
+    }
+
+    for (uint8_t nodeId = 1; nodeId <= 4; ++nodeId)
+        sequencer.disable(nodeId, bus.getTime());
+    runSequencer(bus, controllers, sequencer, false);
+    for (uint8_t nodeId = 1; nodeId <= 4; ++nodeId)
+        BOOST_REQUIRE_EQUAL(StatusWord::SWITCH_ON_DISABLED,
+            bus.getDrive(nodeId).getState());
+}
+
+BOOST_AUTO_TEST_CASE(it_uses_the_command_pdo_when_one_is_configured)
+{
+    SimulatedBus bus(makeBusConfiguration());
+    BusController controllers;
+    bus.addDrive(5);
+    Controller& controller = controllers.add(5);
+    loadFactors(controller);
+
+    canopen_master::PDOCommunicationParameters parameters;
+    parameters.transmission_mode = canopen_master::PDO_SYNCHRONOUS;
+    parameters.sync_period = 1;
+    auto layout = packTelemetry({
+        &getObjectInfo<StatusWordRegister>(),
+        &getObjectInfo<PositionActualInternalValue>()
+    });
+    auto queries = controller.queryPeriodicTelemetryUpdate(0, parameters, layout);
+    auto command = controller.queryCyclicCommand(0,
+        OperationMode::CYCLIC_SYNCHRONOUS_POSITION);
+    queries.insert(queries.end(), command.begin(), command.end());
+    runSDOs(bus, controllers, queries);
+    bus.write(controller.queryNodeStateTransition(canopen_master::NODE_START));
+
+    EnableSequencer sequencer(controllers);
+    sequencer.enable(5, bus.getTime());
+    runSequencer(bus, controllers, sequencer, true);
+
+    auto result = sequencer.getResults().at(0);
+    BOOST_REQUIRE_EQUAL(ENABLE_DONE, result.status);
+    BOOST_REQUIRE(result.usedPDO);
+    BOOST_REQUIRE_EQUAL(StatusWord::OPERATION_ENABLED, bus.getDrive(5).getState());
+    BOOST_REQUIRE(result.duration < base::Time::fromMilliseconds(10));
+}
+
+BOOST_AUTO_TEST_CASE(it_does_not_wait_for_the_position_in_cyclic_synchronous_velocity)
+{
+    SimulatedBus bus(makeBusConfiguration());
+    BusController controllers;
+    bus.addDrive(5);
+    Controller& controller = controllers.add(5);
+    loadFactors(controller);
+
+    canopen_master::PDOCommunicationParameters parameters;
+    parameters.transmission_mode = canopen_master::PDO_SYNCHRONOUS;
+    parameters.sync_period = 1;
+    auto layout = packTelemetry({ &getObjectInfo<StatusWordRegister>() });
+    auto queries = controller.queryPeriodicTelemetryUpdate(0, parameters, layout);
+    auto command = controller.queryCyclicCommand(0,
+        OperationMode::CYCLIC_SYNCHRONOUS_VELOCITY);
+    queries.insert(queries.end(), command.begin(), command.end());
+    runSDOs(bus, controllers, queries);
+    bus.write(controller.queryNodeStateTransition(canopen_master::NODE_START));
+
+    EnableSequencer sequencer(controllers);
+    sequencer.enable(5, bus.getTime());
+    runSequencer(bus, controllers, sequencer, true);
+
+    auto result = sequencer.getResults().at(0);
+    BOOST_REQUIRE_EQUAL(ENABLE_DONE, result.status);
+    BOOST_REQUIRE(result.usedPDO);
+    BOOST_REQUIRE_EQUAL(StatusWord::OPERATION_ENABLED, bus.getDrive(5).getState());
+    BOOST_REQUIRE(result.duration < base::Time::fromMilliseconds(10));
+}
+
+BOOST_AUTO_TEST_CASE(it_reports_nodes_in_fault)
+{
+    SimulatedBus bus(makeBusConfiguration());
+    BusController controllers;
+    bus.addDrive(1).setFault(0x2310);
+    bus.addDrive(2);
+    controllers.add(1);
+    controllers.add(2);
+
+    EnableSequencer sequencer(controllers);
+    sequencer.enable(1, bus.getTime());
+    sequencer.enable(2, bus.getTime());
+    runSequencer(bus, controllers, sequencer, false);
+
+    auto results = sequencer.getResults();
+    BOOST_REQUIRE_EQUAL(ENABLE_FAULT, results[0].status);
+    BOOST_REQUIRE_EQUAL(ENABLE_DONE, results[1].status);
+}
+
+BOOST_AUTO_TEST_CASE(it_times_out_nodes_that_do_not_answer)
+{
+    SimulatedBus bus(makeBusConfiguration());
+    BusController controllers;
+    controllers.add(7);
+
+    EnableSequencer::Configuration configuration;
+    configuration.timeout = base::Time::fromMilliseconds(500);
+    EnableSequencer sequencer(controllers, configuration);
+    base::Time start = bus.getTime();
+    sequencer.enable(7, start);
+    runSequencer(bus, controllers, sequencer, false);
+
+    BOOST_REQUIRE_EQUAL(ENABLE_TIMED_OUT, sequencer.getResults().at(0).status);
+    BOOST_REQUIRE(bus.getTime() - start < base::Time::fromMilliseconds(600));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
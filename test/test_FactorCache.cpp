@@ -0,0 +1,130 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/FactorCache.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+#include "Frames.hpp"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+struct FactorCacheFixture
+{
+    string path;
+
+    FactorCacheFixture()
+    {
+        ostringstream name;
+        name << "/tmp/motors_elmo_ds402_factor_cache_" << getpid();
+        path = name.str();
+    }
+    ~FactorCacheFixture()
+    {
+        remove(path.c_str());
+    }
+
+    static void loadConfiguration(Controller& controller, uint32_t serialNumber)
+    {
+        uint8_t nodeId = controller.getNodeId();
+        controller.process(makeUploadResponse<IdentityObject>(nodeId, serialNumber));
+        controller.process(makeUploadResponse<PositionEncoderResolutionNum>(nodeId, 4096));
+        controller.process(makeUploadResponse<PositionEncoderResolutionDen>(nodeId, 1));
+        controller.process(makeUploadResponse<GearRatioNum>(nodeId, 10));
+        controller.process(makeUploadResponse<GearRatioDen>(nodeId, 1));
+        controller.process(makeUploadResponse<FeedConstantNum>(nodeId, 1));
+        controller.process(makeUploadResponse<FeedConstantDen>(nodeId, 1));
+        controller.process(makeUploadResponse<VelocityFactorNum>(nodeId, 1));
+        controller.process(makeUploadResponse<VelocityFactorDen>(nodeId, 1));
+        controller.process(makeUploadResponse<MotorRatedCurrent>(nodeId, 2000));
+        controller.process(makeUploadResponse<MotorRatedTorque>(nodeId, 500));
+        controller.process(makeUploadResponse<SoftwarePositionLimitMin>(nodeId, -4096));
+        controller.process(makeUploadResponse<SoftwarePositionLimitMax>(nodeId, 4096));
+        controller.process(makeUploadResponse<MaxMotorSpeed>(nodeId, 8192));
+        controller.process(makeUploadResponse<MaxAcceleration>(nodeId, 1000));
+        controller.process(makeUploadResponse<MaxDeceleration>(nodeId, 1000));
+        controller.process(makeUploadResponse<MaxCurrent>(nodeId, 1500));
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(FactorCacheSuite, FactorCacheFixture)
+
+BOOST_AUTO_TEST_CASE(a_missing_file_is_an_empty_cache)
+{
+    BOOST_REQUIRE_EQUAL(0, FactorCache::load(path).size());
+}
+
+BOOST_AUTO_TEST_CASE(it_restores_the_configuration_of_the_same_drive)
+{
+    Controller source(3);
+    loadConfiguration(source, 0x12345678);
+    FactorCache cache;
+    cache.store(source);
+    cache.save(path);
+
+    FactorCache loaded = FactorCache::load(path);
+    BOOST_REQUIRE(loaded.has(3));
+    BOOST_REQUIRE_EQUAL(0x12345678, loaded.get(3).serialNumber);
+
+    Controller target(3);
+    target.process(makeUploadResponse<IdentityObject>(3, 0x12345678));
+    BOOST_REQUIRE(loaded.apply(target));
+
+    Factors factors = target.getFactors();
+    BOOST_REQUIRE_EQUAL(4096, factors.encoderTicks);
+    BOOST_REQUIRE_EQUAL(0.5, factors.ratedTorque);
+    BOOST_REQUIRE_EQUAL(source.getJointLimits().min.position,
+        target.getJointLimits().min.position);
+    BOOST_REQUIRE_EQUAL(source.getJointLimits().max.raw,
+        target.getJointLimits().max.raw);
+}
+
+BOOST_AUTO_TEST_CASE(it_does_not_apply_the_entry_of_another_drive)
+{
+    Controller source(3);
+    loadConfiguration(source, 0x12345678);
+    FactorCache cache;
+    cache.store(source);
+
+    Controller target(3);
+    target.process(makeUploadResponse<IdentityObject>(3, 0x12345679));
+    BOOST_REQUIRE(!cache.apply(target));
+    BOOST_REQUIRE_EQUAL(1, target.getFactors().encoderTicks);
+}
+
+BOOST_AUTO_TEST_CASE(it_does_not_apply_an_incomplete_entry)
+{
+    Controller source(3);
+    source.process(makeUploadResponse<IdentityObject>(3, 0x12345678));
+    source.process(makeUploadResponse<PositionEncoderResolutionNum>(3, 4096));
+    FactorCache cache;
+    cache.store(source);
+
+    Controller target(3);
+    target.process(makeUploadResponse<IdentityObject>(3, 0x12345678));
+    BOOST_REQUIRE(!cache.apply(target));
+    BOOST_REQUIRE_EQUAL(1, target.getFactors().encoderTicks);
+}
+
+BOOST_AUTO_TEST_CASE(it_ignores_corrupted_entries)
+{
+    Controller source(3);
+    loadConfiguration(source, 0x12345678);
+    FactorCache cache;
+    cache.store(source);
+    cache.save(path);
+
+    string content;
+    {
+        ifstream in(path.c_str());
+        content.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    // Change the value of the last object
+    content[content.size() - 2] = (content[content.size() - 2] == '1' ? '2' : '1');
+    ofstream(path.c_str()) << content << "3 garbage\n";
+
+    BOOST_REQUIRE_EQUAL(0, FactorCache::load(path).size());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,83 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/Factors.hpp>
+
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(FactorsSuite)
+
+BOOST_AUTO_TEST_CASE(it_converts_encoder_ticks_into_radians)
+{
+    Factors factors;
+    factors.encoderTicks = 4096;
+    factors.gearMotorShaftRevolutions = 10;
+    factors.update();
+    BOOST_REQUIRE_EQUAL(1, factors.positionNumerator);
+    BOOST_REQUIRE_EQUAL(40960, factors.positionDenominator);
+    BOOST_REQUIRE_CLOSE(2 * M_PI, factors.scaleEncoderValue(40960), 1e-12);
+    BOOST_REQUIRE_CLOSE(-M_PI, factors.scaleEncoderValue(-20480), 1e-12);
+    BOOST_REQUIRE_EQUAL(40960, factors.userToEncoderValue(2 * M_PI));
+    BOOST_REQUIRE_EQUAL(-20480, factors.userToEncoderValue(-M_PI));
+}
+
+BOOST_AUTO_TEST_CASE(it_handles_factors_whose_product_overflows_64_bits)
+{
+    Factors factors;
+    factors.encoderTicks = 4000000000;
+    factors.gearMotorShaftRevolutions = 3000000000;
+    factors.feedDrivingShaftRevolutions = 3;
+    factors.feedLength = 2;
+    factors.update();
+
+    double expected = 2 * M_PI * 2 * 0x7FFFFFFF / (3.0 * 4e9 * 3e9);
+    BOOST_REQUIRE_CLOSE(expected, factors.scaleEncoderValue(0x7FFFFFFF), 1e-12);
+    BOOST_REQUIRE_EQUAL(0x7FFFFFFF, factors.userToEncoderValue(
+        factors.scaleEncoderValue(0x7FFFFFFF)));
+}
+
+BOOST_AUTO_TEST_CASE(it_cancels_common_factors_before_multiplying)
+{
+    Factors factors;
+    factors.encoderTicks = 4000000000;
+    factors.encoderRevolutions = 4000000000;
+    factors.gearMotorShaftRevolutions = 3000000000;
+    factors.gearDrivingShaftRevolutions = 1000000000;
+    factors.update();
+    BOOST_REQUIRE_EQUAL(1, factors.positionNumerator);
+    BOOST_REQUIRE_EQUAL(3, factors.positionDenominator);
+}
+
+BOOST_AUTO_TEST_CASE(it_applies_the_velocity_factor)
+{
+    Factors factors;
+    factors.encoderTicks = 1000;
+    factors.velocityFactorNum = 10;
+    factors.velocityFactorDen = 1;
+    factors.update();
+    BOOST_REQUIRE_CLOSE(2 * M_PI, factors.velocityToUser(10000), 1e-12);
+    BOOST_REQUIRE_EQUAL(10000, factors.userToVelocity(2 * M_PI));
+}
+
+BOOST_AUTO_TEST_CASE(it_converts_currents_and_torques_both_ways)
+{
+    Factors factors;
+    factors.ratedCurrent = 2;
+    factors.ratedTorque = 0.5;
+    factors.update();
+    BOOST_REQUIRE_CLOSE(1, factors.currentToUser(500), 1e-12);
+    BOOST_REQUIRE_CLOSE(0.25, factors.currentToUserTorque(500), 1e-12);
+    BOOST_REQUIRE_EQUAL(-500, factors.userToCurrent(-1));
+    BOOST_REQUIRE_EQUAL(500, factors.userTorqueToCurrent(0.25));
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_zero_terms)
+{
+    Factors factors;
+    factors.velocityFactorNum = 0;
+    BOOST_REQUIRE(!factors.isValid());
+    BOOST_REQUIRE_THROW(factors.update(), std::invalid_argument);
+    factors.velocityFactorNum = 1;
+    factors.encoderTicks = 0;
+    BOOST_REQUIRE_THROW(factors.update(), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,164 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/FaultRecovery.hpp>
+#include <motors_elmo_ds402/SimulatedBus.hpp>
+#include "Frames.hpp"
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+struct FaultRecoveryFixture
+{
+    SimulatedBus bus;
+    BusController controllers;
+
+    FaultRecoveryFixture()
+        : bus(makeBusConfiguration())
+    {
+        for (uint8_t nodeId = 1; nodeId <= 2; ++nodeId)
+        {
+            bus.addDrive(nodeId);
+            controllers.add(nodeId);
+        }
+    }
+
+    static SimulatedBus::Configuration makeBusConfiguration()
+    {
+        SimulatedBus::Configuration configuration;
+        configuration.latency = base::Time::fromMicroseconds(200);
+        configuration.virtualTime = true;
+        return configuration;
+    }
+
+    void enable(uint8_t nodeId)
+    {
+        EnableSequencer sequencer(controllers);
+        sequencer.enable(nodeId, bus.getTime());
+        while (!sequencer.isDone())
+        {
+            for (auto const& msg : sequencer.poll(bus.getTime()))
+                bus.write(msg);
+            try {
+                sequencer.process(bus.read(), bus.getTime());
+            }
+            catch(std::runtime_error const&) {}
+        }
+        BOOST_REQUIRE_EQUAL(StatusWord::OPERATION_ENABLED, bus.getDrive(nodeId).getState());
+    }
+
+    void run(FaultRecovery& recovery, base::Time const& duration)
+    {
+        base::Time end = bus.getTime() + duration;
+        while (bus.getTime() < end)
+        {
+            for (auto const& msg : recovery.poll(bus.getTime()))
+                bus.write(msg);
+
+            base::Time deadline = recovery.getNextDeadline();
+            if (deadline.isNull() || end < deadline)
+                deadline = end;
+            base::Time remaining = deadline - bus.getTime();
+            bus.setReadTimeout(std::max<int64_t>(1, remaining.toMilliseconds()));
+            try {
+                recovery.process(bus.read(), bus.getTime());
+            }
+            catch(std::runtime_error const&) {}
+        }
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(FaultRecoverySuite, FaultRecoveryFixture)
+
+BOOST_AUTO_TEST_CASE(it_selects_the_policy_by_error_class)
+{
+    FaultRecovery recovery(controllers);
+    recovery.setPolicy(0x23, RECOVERY_RESET_AND_ENABLE);
+    BOOST_REQUIRE_EQUAL(RECOVERY_RESET_AND_ENABLE, recovery.getPolicy(0x2310));
+    BOOST_REQUIRE_EQUAL(RECOVERY_LATCH, recovery.getPolicy(0x2410));
+    BOOST_REQUIRE_THROW(recovery.watch(5), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(it_resets_and_reenables_a_drive_in_fault)
+{
+    enable(1);
+    FaultRecovery recovery(controllers);
+    recovery.setPolicy(0x23, RECOVERY_RESET_AND_ENABLE);
+    recovery.watch(1);
+    recovery.watch(2);
+    run(recovery, base::Time::fromMilliseconds(20));
+
+    bus.getDrive(1).setFault(0x2310);
+    run(recovery, base::Time::fromMilliseconds(100));
+
+    auto events = recovery.getEvents();
+    BOOST_REQUIRE_EQUAL(1, events.size());
+    BOOST_REQUIRE_EQUAL(1, events[0].nodeId);
+    BOOST_REQUIRE(events[0].hasErrorCode);
+    BOOST_REQUIRE_EQUAL(0x2310, events[0].errorCode);
+    BOOST_REQUIRE_EQUAL(RECOVERY_RESET_AND_ENABLE, events[0].policy);
+    BOOST_REQUIRE(events[0].recovered);
+    BOOST_REQUIRE(events[0].latency < base::Time::fromMilliseconds(10));
+    BOOST_REQUIRE_EQUAL(RECOVERY_WATCHING, recovery.getState(1));
+    BOOST_REQUIRE_EQUAL(StatusWord::OPERATION_ENABLED, bus.getDrive(1).getState());
+    BOOST_REQUIRE_EQUAL(1, recovery.getLatencyStatistics().count);
+}
+
+BOOST_AUTO_TEST_CASE(it_takes_the_error_code_from_an_emcy_sent_with_the_fault)
+{
+    enable(1);
+    FaultRecovery recovery(controllers);
+    recovery.setPolicy(0x23, RECOVERY_RESET_AND_ENABLE);
+    recovery.watch(1);
+    run(recovery, base::Time::fromMilliseconds(20));
+
+    // The simulated drive does not send EMCY frames, and its ErrorCode
+    // differs from the EMCY's
+    recovery.process(makeEmergency(1, 0x2311, 0x03), bus.getTime());
+    bus.getDrive(1).setFault(0x2310);
+    run(recovery, base::Time::fromMilliseconds(100));
+
+    BOOST_REQUIRE_EQUAL(1, recovery.getEvents().size());
+    BOOST_REQUIRE_EQUAL(0x2311, recovery.getEvents()[0].errorCode);
+}
+
+BOOST_AUTO_TEST_CASE(it_reads_the_error_code_if_the_last_emcy_is_older_than_the_fault)
+{
+    enable(1);
+    FaultRecovery recovery(controllers);
+    recovery.setPolicy(0x23, RECOVERY_RESET_AND_ENABLE);
+    recovery.watch(1);
+    run(recovery, base::Time::fromMilliseconds(20));
+
+    recovery.process(makeEmergency(1, 0x3210, 0x03), bus.getTime());
+    run(recovery, base::Time::fromMilliseconds(200));
+    bus.getDrive(1).setFault(0x2310);
+    run(recovery, base::Time::fromMilliseconds(100));
+
+    BOOST_REQUIRE_EQUAL(1, recovery.getEvents().size());
+    BOOST_REQUIRE(recovery.getEvents()[0].hasErrorCode);
+    BOOST_REQUIRE_EQUAL(0x2310, recovery.getEvents()[0].errorCode);
+    BOOST_REQUIRE(recovery.getEvents()[0].recovered);
+}
+
+BOOST_AUTO_TEST_CASE(it_latches_faults_until_acknowledged)
+{
+    enable(2);
+    FaultRecovery recovery(controllers);
+    recovery.watch(2);
+    bus.getDrive(2).setFault(0x8611);
+    run(recovery, base::Time::fromMilliseconds(100));
+
+    BOOST_REQUIRE_EQUAL(RECOVERY_LATCHED, recovery.getState(2));
+    BOOST_REQUIRE_EQUAL(StatusWord::FAULT, bus.getDrive(2).getState());
+    BOOST_REQUIRE_EQUAL(1, recovery.getEvents().size());
+    BOOST_REQUIRE(!recovery.getEvents()[0].recovered);
+
+    recovery.acknowledge(2, bus.getTime());
+    run(recovery, base::Time::fromMilliseconds(100));
+    BOOST_REQUIRE_EQUAL(RECOVERY_WATCHING, recovery.getState(2));
+    BOOST_REQUIRE_EQUAL(StatusWord::SWITCH_ON_DISABLED, bus.getDrive(2).getState());
+    BOOST_REQUIRE_EQUAL(2, recovery.getEvents().size());
+    BOOST_REQUIRE_EQUAL(RECOVERY_RESET, recovery.getEvents()[1].policy);
+    BOOST_REQUIRE(recovery.getEvents()[1].recovered);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,129 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/HeartbeatSupervisor.hpp>
+#include <motors_elmo_ds402/SDOScheduler.hpp>
+#include <motors_elmo_ds402/SimulatedBus.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static NodeUpdate makeHeartbeat(uint8_t nodeId)
+{
+    return NodeUpdate(nodeId, Update::UpdatedObjects(UPDATE_HEARTBEAT));
+}
+
+static base::Time ms(int value)
+{
+    return base::Time::fromMilliseconds(value);
+}
+
+BOOST_AUTO_TEST_SUITE(HeartbeatSupervisorSuite)
+
+BOOST_AUTO_TEST_CASE(it_validates_its_configuration)
+{
+    HeartbeatSupervisor::Configuration configuration;
+    configuration.slotCount = 48;
+    BOOST_REQUIRE_THROW(HeartbeatSupervisor supervisor(configuration), std::invalid_argument);
+    configuration.slotCount = 64;
+    configuration.period = base::Time::fromMicroseconds(1500);
+    BOOST_REQUIRE_THROW(HeartbeatSupervisor supervisor(configuration), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(it_raises_a_loss_within_one_period_of_the_missed_heartbeat)
+{
+    // A wheel shorter than the deadlines, so that entries take several turns
+    HeartbeatSupervisor::Configuration configuration;
+    configuration.slotCount = 4;
+    HeartbeatSupervisor supervisor(configuration);
+
+    BusController bus0, bus1;
+    bus0.add(3);
+    bus1.add(3);
+    size_t index0 = supervisor.addBus(bus0);
+    size_t index1 = supervisor.addBus(bus1);
+    base::Time start = base::Time::fromSeconds(10);
+    supervisor.watch(index0, 3, start);
+    supervisor.watch(index1, 3, start);
+    BOOST_REQUIRE_THROW(supervisor.watch(index0, 4, start), std::invalid_argument);
+
+    // Both nodes send heartbeats for a while, then the one on bus 1 stops
+    base::Time lastOnBus1;
+    for (base::Time t = start; t < start + ms(1000); t = t + ms(5))
+    {
+        if ((t - start).toMilliseconds() % 100 == 0)
+        {
+            supervisor.process(index0, makeHeartbeat(3), t);
+            if (t < start + ms(500))
+            {
+                supervisor.process(index1, makeHeartbeat(3), t);
+                lastOnBus1 = t;
+            }
+        }
+        supervisor.poll(t);
+    }
+
+    BOOST_REQUIRE(supervisor.isAlive(index0, 3));
+    BOOST_REQUIRE(!supervisor.isAlive(index1, 3));
+    BOOST_REQUIRE(supervisor.getAge(index0, 3, start + ms(1000)) <= ms(100));
+    BOOST_REQUIRE(supervisor.getLastSeen(index1, 3) == lastOnBus1);
+
+    auto events = supervisor.getEvents();
+    BOOST_REQUIRE_EQUAL(1, events.size());
+    BOOST_REQUIRE_EQUAL(HeartbeatEvent::LOST, events[0].type);
+    BOOST_REQUIRE_EQUAL(index1, events[0].busIndex);
+    // The heartbeat was expected at lastOnBus1 + 100ms
+    BOOST_REQUIRE(!(events[0].time - lastOnBus1 < ms(150)));
+    BOOST_REQUIRE(events[0].time - lastOnBus1 <= ms(200));
+
+    supervisor.process(index1, makeHeartbeat(3), start + ms(1000));
+    BOOST_REQUIRE(supervisor.isAlive(index1, 3));
+    BOOST_REQUIRE_EQUAL(HeartbeatEvent::RECOVERED, supervisor.getEvents().back().type);
+}
+
+BOOST_AUTO_TEST_CASE(it_configures_and_supervises_simulated_drives)
+{
+    SimulatedBus::Configuration busConfiguration;
+    busConfiguration.latency = base::Time::fromMicroseconds(200);
+    busConfiguration.virtualTime = true;
+    SimulatedBus bus(busConfiguration);
+    BusController controllers;
+    HeartbeatSupervisor supervisor;
+    size_t busIndex = supervisor.addBus(controllers);
+    for (uint8_t nodeId = 1; nodeId <= 20; ++nodeId)
+    {
+        bus.addDrive(nodeId);
+        controllers.add(nodeId);
+        supervisor.watch(busIndex, nodeId, bus.getTime());
+    }
+
+    SDOScheduler scheduler;
+    scheduler.push(supervisor.queryConfiguration(busIndex));
+    BOOST_REQUIRE_EQUAL(20, supervisor.queryConfiguration(busIndex).size());
+
+    base::Time end = bus.getTime() + ms(1000);
+    while (bus.getTime() < end)
+    {
+        for (auto const& msg : scheduler.poll(bus.getTime()))
+            bus.write(msg);
+        supervisor.poll(bus.getTime());
+
+        base::Time remaining = supervisor.getNextDeadline() - bus.getTime();
+        bus.setReadTimeout(std::max<int64_t>(1, remaining.toMilliseconds()));
+        try {
+            canbus::Message msg = bus.read();
+            scheduler.process(msg, bus.getTime());
+            supervisor.process(busIndex, controllers.process(msg), bus.getTime());
+        }
+        catch(std::runtime_error const&) {}
+    }
+
+    BOOST_REQUIRE(scheduler.getFailures().empty());
+    BOOST_REQUIRE(supervisor.getEvents().empty());
+    for (uint8_t nodeId = 1; nodeId <= 20; ++nodeId)
+    {
+        BOOST_REQUIRE(supervisor.isAlive(busIndex, nodeId));
+        BOOST_REQUIRE(supervisor.getAge(busIndex, nodeId, bus.getTime()) <= ms(101));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,93 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/JointStateBatch.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(JointStateBatchSuite)
+
+struct JointStateBatchFixture
+{
+    static const size_t AXES = 11;
+
+    FactorsTable table;
+    vector<Factors> factors;
+    vector<int32_t> position;
+    vector<int32_t> velocity;
+    vector<int16_t> current;
+
+    JointStateBatchFixture()
+        : factors(AXES)
+    {
+        table.resize(AXES);
+        for (size_t i = 0; i < AXES; ++i)
+        {
+            Factors& f = factors[i];
+            f.encoderTicks = 4096 + 1000 * i;
+            f.gearMotorShaftRevolutions = 1 + i;
+            f.velocityFactorNum = 3 + i;
+            f.velocityFactorDen = 7;
+            f.ratedCurrent = 1.5 + 0.1 * i;
+            f.ratedTorque = 0.3 + 0.01 * i;
+            f.update();
+            table.set(i, f);
+
+            position.push_back(static_cast<int32_t>(0x7FFFFFFF - 123456789 * i));
+            velocity.push_back(static_cast<int32_t>(-987654 * (i + 1)));
+            current.push_back(static_cast<int16_t>(-32768 + 5000 * i));
+        }
+    }
+
+    void check(JOINT_STATE_KERNEL kernel)
+    {
+        vector<double> outPosition(AXES), outSpeed(AXES), outEffort(AXES), outCurrent(AXES);
+        RawJointStateArrays raw;
+        raw.position = position.data();
+        raw.velocity = velocity.data();
+        raw.current = current.data();
+        JointStateArrays out;
+        out.position = outPosition.data();
+        out.speed = outSpeed.data();
+        out.effort = outEffort.data();
+        out.current = outCurrent.data();
+        convertJointStates(table, raw, out, AXES, kernel);
+
+        for (size_t i = 0; i < AXES; ++i)
+        {
+            BOOST_REQUIRE_EQUAL(factors[i].scaleEncoderValue(position[i]), outPosition[i]);
+            BOOST_REQUIRE_EQUAL(factors[i].velocityToUser(velocity[i]), outSpeed[i]);
+            BOOST_REQUIRE_EQUAL(factors[i].currentToUserTorque(current[i]), outEffort[i]);
+            BOOST_REQUIRE_EQUAL(factors[i].currentToUser(current[i]), outCurrent[i]);
+        }
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(the_scalar_kernel_matches_the_per_axis_conversions, JointStateBatchFixture)
+{
+    check(KERNEL_SCALAR);
+}
+
+BOOST_FIXTURE_TEST_CASE(the_avx2_kernel_matches_the_per_axis_conversions, JointStateBatchFixture)
+{
+    check(KERNEL_AVX2);
+}
+
+BOOST_FIXTURE_TEST_CASE(it_skips_arrays_left_null, JointStateBatchFixture)
+{
+    vector<double> outSpeed(AXES, 42);
+    RawJointStateArrays raw;
+    raw.position = position.data();
+    JointStateArrays out;
+    out.speed = outSpeed.data();
+    convertJointStates(table, raw, out, AXES);
+    for (size_t i = 0; i < AXES; ++i)
+        BOOST_REQUIRE_EQUAL(42, outSpeed[i]);
+}
+
+BOOST_FIXTURE_TEST_CASE(it_rejects_a_factors_table_too_small, JointStateBatchFixture)
+{
+    BOOST_REQUIRE_THROW(convertJointStates(table, RawJointStateArrays(),
+        JointStateArrays(), AXES + 1), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,43 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/ObjectRegistry.hpp>
+#include <string>
+
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(ObjectRegistrySuite)
+
+BOOST_AUTO_TEST_CASE(it_finds_objects_by_id_and_sub_id)
+{
+    ObjectInfo const* info = findObject(0x607D, 2);
+    BOOST_REQUIRE(info);
+    BOOST_REQUIRE_EQUAL("SoftwarePositionLimitMax", std::string(info->name));
+    BOOST_REQUIRE_EQUAL(4, info->size);
+    BOOST_REQUIRE(info->isSigned);
+    BOOST_REQUIRE(info->isWritable());
+    BOOST_REQUIRE_EQUAL(UPDATE_JOINT_LIMITS, info->updateId);
+}
+
+BOOST_AUTO_TEST_CASE(it_finds_the_first_and_last_objects)
+{
+    BOOST_REQUIRE_EQUAL(&OBJECT_REGISTRY[0], findObject(0x1000, 0));
+    BOOST_REQUIRE_EQUAL(&OBJECT_REGISTRY[OBJECT_COUNT - 1], findObject(0x6502, 0));
+}
+
+BOOST_AUTO_TEST_CASE(it_returns_null_for_unknown_objects)
+{
+    BOOST_REQUIRE(!findObject(0x607D, 3));
+    BOOST_REQUIRE(!findObject(0x0FFF, 0));
+    BOOST_REQUIRE(!findObject(0x7000, 0));
+}
+
+BOOST_AUTO_TEST_CASE(it_matches_the_object_definitions)
+{
+    ObjectInfo const* info = findObject(StatusWordRegister::OBJECT_ID,
+        StatusWordRegister::OBJECT_SUB_ID);
+    BOOST_REQUIRE(info);
+    BOOST_REQUIRE_EQUAL(UPDATE_STATUS_WORD, info->updateId);
+    BOOST_REQUIRE_EQUAL(sizeof(StatusWordRegister::OBJECT_TYPE), info->size);
+    BOOST_REQUIRE(!info->isWritable());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
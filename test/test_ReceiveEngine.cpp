@@ -0,0 +1,203 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/ReceiveEngine.hpp>
+#include "Frames.hpp"
+#include <deque>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+/** Minimal thread-safe driver fed from the test thread */
+class QueueDriver : public canbus::Driver
+{
+    mutex mMutex;
+    condition_variable mAvailable;
+    deque<canbus::Message> mQueue;
+    int mReadTimeout = 100;
+
+public:
+    void push(canbus::Message const& msg)
+    {
+        lock_guard<mutex> lock(mMutex);
+        mQueue.push_back(msg);
+        mAvailable.notify_one();
+    }
+
+    bool open(std::string const&) { return true; }
+    bool reset() { return true; }
+    void close() {}
+    bool setBaudrate(canbus::BAUD_RATE) { return true; }
+    canbus::Message read()
+    {
+        unique_lock<mutex> lock(mMutex);
+        if (!mAvailable.wait_for(lock, chrono::milliseconds(mReadTimeout),
+                [this] { return !mQueue.empty(); }))
+            throw std::runtime_error("QueueDriver: read timeout");
+        canbus::Message msg = mQueue.front();
+        mQueue.pop_front();
+        return msg;
+    }
+    void write(canbus::Message const&) {}
+    int getPendingMessagesCount() { return 0; }
+    bool checkBusOk() { return true; }
+    void clear() {}
+    int getFileDescriptor() const { return -1; }
+    bool isValid() const { return true; }
+    void setReadTimeout(uint32_t timeout) { mReadTimeout = timeout; }
+    uint32_t getReadTimeout() const { return mReadTimeout; }
+    void setWriteTimeout(uint32_t) {}
+    uint32_t getWriteTimeout() const { return 0; }
+};
+
+BOOST_AUTO_TEST_SUITE(ReceiveEngineSuite)
+
+BOOST_AUTO_TEST_CASE(the_spsc_ring_preserves_order_across_threads)
+{
+    SPSCRing<uint32_t, 64> ring;
+    const uint32_t count = 100000;
+    thread producer([&ring, count] {
+        for (uint32_t i = 0; i < count; ++i)
+            while (!ring.push(i));
+    });
+
+    uint32_t expected = 0;
+    while (expected < count)
+    {
+        uint32_t value;
+        if (ring.pop(value))
+        {
+            BOOST_REQUIRE_EQUAL(expected, value);
+            ++expected;
+        }
+    }
+    producer.join();
+    BOOST_REQUIRE(ring.empty());
+}
+
+BOOST_AUTO_TEST_CASE(the_seqlock_never_returns_a_torn_value)
+{
+    struct Pair { uint64_t a; uint64_t b; uint64_t c; };
+    SeqLock<Pair> lock;
+    Pair value;
+    BOOST_REQUIRE(!lock.load(value));
+
+    atomic<bool> done(false);
+    thread writer([&lock, &done] {
+        for (uint64_t i = 1; i < 200000; ++i)
+            lock.store(Pair { i, i * 2, i * 3 });
+        done = true;
+    });
+
+    int torn = 0;
+    while (!done)
+    {
+        if (lock.load(value) && (value.b != value.a * 2 || value.c != value.a * 3))
+            ++torn;
+    }
+    writer.join();
+    BOOST_REQUIRE_EQUAL(0, torn);
+    BOOST_REQUIRE(lock.load(value));
+    BOOST_REQUIRE_EQUAL(199999, value.a);
+}
+
+BOOST_AUTO_TEST_CASE(it_reports_the_thread_setup_once_started)
+{
+    QueueDriver device;
+    BusController bus;
+
+    ReceiveEngine::Configuration configuration;
+    configuration.readTimeout = base::Time::fromMilliseconds(10);
+    // No CPU that high on the test machine
+    configuration.processingCPU = 1023;
+    ReceiveEngine engine(device, bus, configuration);
+    engine.start();
+    BOOST_REQUIRE(!engine.isRealTime());
+    engine.stop();
+}
+
+BOOST_AUTO_TEST_CASE(it_publishes_the_state_of_the_nodes)
+{
+    QueueDriver device;
+    BusController bus;
+    bus.add(3);
+
+    ReceiveEngine::Configuration configuration;
+    configuration.readTimeout = base::Time::fromMilliseconds(10);
+    ReceiveEngine engine(device, bus, configuration);
+
+    PublishedNodeState state;
+    BOOST_REQUIRE(!engine.getNodeState(3, state));
+
+    engine.start();
+    BOOST_REQUIRE_THROW(engine.start(), std::logic_error);
+    device.push(makeUploadResponse<StatusWordRegister>(3, 0x0237));
+    for (int i = 0; i < 1000 && !engine.getNodeState(3, state); ++i)
+        this_thread::sleep_for(chrono::milliseconds(1));
+    engine.stop();
+
+    BOOST_REQUIRE(engine.getNodeState(3, state));
+    BOOST_REQUIRE(state.hasStatusWord);
+    BOOST_REQUIRE_EQUAL(StatusWord::OPERATION_ENABLED, state.statusWord.state);
+    BOOST_REQUIRE(state.updateId & UPDATE_STATUS_WORD);
+    BOOST_REQUIRE_EQUAL(1, engine.getProcessedCount());
+    BOOST_REQUIRE_EQUAL(0, engine.getOverrunCount());
+    BOOST_REQUIRE(!engine.isRunning());
+}
+
+BOOST_AUTO_TEST_CASE(it_drops_the_frames_whose_processing_throws)
+{
+    QueueDriver device;
+    BusController bus;
+    bus.add(3);
+
+    ReceiveEngine::Configuration configuration;
+    configuration.readTimeout = base::Time::fromMilliseconds(10);
+    ReceiveEngine engine(device, bus, configuration);
+
+    canbus::Message abort = makeUploadResponse<StatusWordRegister>(3, 0);
+    abort.data[0] = 0x80;
+    abort.data[7] = 0x08;
+
+    PublishedNodeState state;
+    engine.start();
+    device.push(abort);
+    device.push(makeUploadResponse<StatusWordRegister>(3, 0x0237));
+    for (int i = 0; i < 1000 && !engine.getNodeState(3, state); ++i)
+        this_thread::sleep_for(chrono::milliseconds(1));
+    engine.stop();
+
+    BOOST_REQUIRE(engine.getNodeState(3, state));
+    BOOST_REQUIRE_EQUAL(StatusWord::OPERATION_ENABLED, state.statusWord.state);
+    BOOST_REQUIRE_EQUAL(1, engine.getProcessingErrorCount());
+    BOOST_REQUIRE_EQUAL(1, engine.getProcessedCount());
+}
+
+BOOST_AUTO_TEST_CASE(it_publishes_a_joint_state_without_a_status_word)
+{
+    QueueDriver device;
+    BusController bus;
+    bus.add(3).queryPeriodicJointStateUpdate(0, 1);
+
+    ReceiveEngine::Configuration configuration;
+    configuration.readTimeout = base::Time::fromMilliseconds(10);
+    ReceiveEngine engine(device, bus, configuration);
+
+    canbus::Message pdo;
+    pdo.can_id = 0x183;
+    pdo.size = 8;
+    for (int i = 0; i < 8; ++i)
+        pdo.data[i] = 0;
+    pdo.data[0] = 0x10;
+
+    PublishedNodeState state;
+    engine.start();
+    device.push(pdo);
+    for (int i = 0; i < 1000 && !engine.getNodeState(3, state); ++i)
+        this_thread::sleep_for(chrono::milliseconds(1));
+    engine.stop();
+
+    BOOST_REQUIRE(engine.getNodeState(3, state));
+    BOOST_REQUIRE(state.updateId & UPDATE_JOINT_POSITION);
+    BOOST_REQUIRE(!state.hasStatusWord);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,107 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/SDOScheduler.hpp>
+#include <motors_elmo_ds402/Controller.hpp>
+
+using namespace motors_elmo_ds402;
+
+static canbus::Message makeSDO(uint32_t cobId, uint8_t command,
+    uint16_t objectId, uint8_t objectSubId, uint32_t payload = 0)
+{
+    canbus::Message msg;
+    msg.can_id = cobId;
+    msg.size = 8;
+    msg.data[0] = command;
+    msg.data[1] = objectId & 0xFF;
+    msg.data[2] = objectId >> 8;
+    msg.data[3] = objectSubId;
+    for (int i = 0; i < 4; ++i)
+        msg.data[4 + i] = (payload >> (8 * i)) & 0xFF;
+    return msg;
+}
+
+static base::Time ms(int value)
+{
+    return base::Time::fromMilliseconds(value);
+}
+
+BOOST_AUTO_TEST_SUITE(SDOSchedulerSuite)
+
+BOOST_AUTO_TEST_CASE(it_keeps_one_request_in_flight_per_node)
+{
+    SDOScheduler scheduler;
+    scheduler.push(makeSDO(0x601, 0x40, 0x6041, 0));
+    scheduler.push(makeSDO(0x601, 0x40, 0x6063, 0));
+    scheduler.push(makeSDO(0x602, 0x40, 0x6041, 0));
+
+    auto messages = scheduler.poll(ms(0));
+    BOOST_REQUIRE_EQUAL(2, messages.size());
+    BOOST_REQUIRE_EQUAL(0x601, messages[0].can_id);
+    BOOST_REQUIRE_EQUAL(0x602, messages[1].can_id);
+    BOOST_REQUIRE(scheduler.poll(ms(1)).empty());
+
+    auto result = scheduler.process(makeSDO(0x581, 0x4B, 0x6041, 0, 0x27), ms(2));
+    BOOST_REQUIRE_EQUAL(SDOResult::SUCCESS, result.status);
+    BOOST_REQUIRE_EQUAL(2, result.roundTrip.toMilliseconds());
+
+    messages = scheduler.poll(ms(2));
+    BOOST_REQUIRE_EQUAL(1, messages.size());
+    BOOST_REQUIRE_EQUAL(0x63, messages[0].data[1]);
+
+    scheduler.process(makeSDO(0x581, 0x43, 0x6063, 0), ms(3));
+    scheduler.process(makeSDO(0x582, 0x4B, 0x6041, 0), ms(3));
+    BOOST_REQUIRE(scheduler.isDone());
+    BOOST_REQUIRE(scheduler.getFailures().empty());
+}
+
+BOOST_AUTO_TEST_CASE(it_ignores_responses_to_other_objects)
+{
+    SDOScheduler scheduler;
+    scheduler.push(makeSDO(0x601, 0x40, 0x6041, 0));
+    scheduler.poll(ms(0));
+    auto result = scheduler.process(makeSDO(0x581, 0x4B, 0x6063, 0), ms(1));
+    BOOST_REQUIRE(!result.isValid());
+    BOOST_REQUIRE(scheduler.hasPendingQuery(1));
+}
+
+BOOST_AUTO_TEST_CASE(it_retries_and_then_reports_timeouts)
+{
+    SDOScheduler scheduler(ms(100), 1);
+    scheduler.push(makeSDO(0x601, 0x40, 0x6041, 0));
+    scheduler.push(makeSDO(0x601, 0x40, 0x6063, 0));
+    scheduler.poll(ms(0));
+    BOOST_REQUIRE_EQUAL(100, scheduler.getNextDeadline().toMilliseconds());
+    BOOST_REQUIRE(scheduler.poll(ms(50)).empty());
+
+    auto messages = scheduler.poll(ms(100));
+    BOOST_REQUIRE_EQUAL(1, messages.size());
+    BOOST_REQUIRE_EQUAL(0x41, messages[0].data[1]);
+
+    messages = scheduler.poll(ms(200));
+    BOOST_REQUIRE_EQUAL(1, messages.size());
+    BOOST_REQUIRE_EQUAL(0x63, messages[0].data[1]);
+    BOOST_REQUIRE_EQUAL(1, scheduler.getFailures().size());
+    BOOST_REQUIRE_EQUAL(SDOResult::TIMED_OUT, scheduler.getFailures()[0].status);
+    BOOST_REQUIRE_EQUAL(0x6041, scheduler.getFailures()[0].objectId);
+}
+
+BOOST_AUTO_TEST_CASE(it_reports_aborts)
+{
+    SDOScheduler scheduler;
+    scheduler.push(makeSDO(0x601, 0x40, 0x6041, 0));
+    scheduler.poll(ms(0));
+    auto result = scheduler.process(makeSDO(0x581, 0x80, 0x6041, 0, 0x06020000), ms(1));
+    BOOST_REQUIRE_EQUAL(SDOResult::ABORTED, result.status);
+    BOOST_REQUIRE_EQUAL(0x06020000, result.abortCode);
+    BOOST_REQUIRE(scheduler.isDone());
+    BOOST_REQUIRE_EQUAL(1, scheduler.getFailures().size());
+}
+
+BOOST_AUTO_TEST_CASE(it_refuses_to_start_a_second_transaction_on_a_node)
+{
+    SDOScheduler scheduler;
+    scheduler.start(makeSDO(0x601, 0x40, 0x6041, 0), ms(0));
+    BOOST_REQUIRE_THROW(scheduler.start(makeSDO(0x601, 0x40, 0x6063, 0), ms(0)),
+        HasPendingQuery);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
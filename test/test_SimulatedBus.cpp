@@ -0,0 +1,248 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/SimulatedBus.hpp>
+#include <motors_elmo_ds402/Controller.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static canbus::Message makeSDO(uint8_t nodeId, uint8_t command,
+    uint16_t objectId, uint8_t objectSubId, uint32_t value = 0)
+{
+    canbus::Message msg;
+    msg.can_id = 0x600 + nodeId;
+    msg.size = 8;
+    msg.data[0] = command;
+    msg.data[1] = objectId & 0xFF;
+    msg.data[2] = objectId >> 8;
+    msg.data[3] = objectSubId;
+    for (int i = 0; i < 4; ++i)
+        msg.data[4 + i] = (value >> (8 * i)) & 0xFF;
+    return msg;
+}
+
+static canbus::Message makeNMT(uint8_t command, uint8_t nodeId)
+{
+    canbus::Message msg;
+    msg.can_id = 0;
+    msg.size = 2;
+    msg.data[0] = command;
+    msg.data[1] = nodeId;
+    return msg;
+}
+
+static canbus::Message makeSync()
+{
+    canbus::Message msg;
+    msg.can_id = 0x80;
+    msg.size = 0;
+    return msg;
+}
+
+struct SimulatedBusFixture
+{
+    SimulatedBus bus;
+
+    SimulatedBusFixture()
+        : bus(makeConfiguration()) {}
+
+    static SimulatedBus::Configuration makeConfiguration()
+    {
+        SimulatedBus::Configuration configuration;
+        configuration.latency = base::Time::fromMicroseconds(100);
+        configuration.virtualTime = true;
+        return configuration;
+    }
+
+    canbus::Message transact(canbus::Message const& msg)
+    {
+        bus.write(msg);
+        return bus.read();
+    }
+
+    /** Do an expedited download and check that it is acknowledged */
+    void download(uint8_t nodeId, uint16_t objectId, uint8_t objectSubId,
+        uint32_t value, int size)
+    {
+        uint8_t command = 0x23 | ((4 - size) << 2);
+        canbus::Message reply = transact(makeSDO(nodeId, command, objectId, objectSubId, value));
+        BOOST_REQUIRE_EQUAL(0x60, reply.data[0]);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(SimulatedBusSuite, SimulatedBusFixture)
+
+BOOST_AUTO_TEST_CASE(it_answers_the_controller_sdo_uploads)
+{
+    bus.addDrive(3).set<MotorRatedCurrent>(2000);
+    Controller controller(3);
+    for (auto const& query : controller.queryFactors())
+        controller.process(transact(query));
+    // The rated torque is usually set with setMotorParameters, as the
+    // drive does not store it
+    controller.process(transact(makeSDO(3, 0x40, 0x6076, 0)));
+
+    Factors factors = controller.getFactors();
+    BOOST_REQUIRE_EQUAL(4096, factors.encoderTicks);
+    BOOST_REQUIRE_CLOSE(2, factors.ratedCurrent, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(it_delays_frames_by_the_configured_latency)
+{
+    bus.addDrive(3);
+    base::Time start = bus.getTime();
+    canbus::Message reply = transact(makeSDO(3, 0x40, 0x6041, 0));
+    BOOST_REQUIRE_EQUAL(200, (reply.time - start).toMicroseconds());
+}
+
+BOOST_AUTO_TEST_CASE(it_aborts_invalid_sdo_accesses)
+{
+    bus.addDrive(3);
+    canbus::Message reply = transact(makeSDO(3, 0x40, 0x5000, 0));
+    BOOST_REQUIRE_EQUAL(0x80, reply.data[0]);
+    BOOST_REQUIRE_EQUAL(0x06020000u, reply.data[4] | reply.data[5] << 8 |
+        reply.data[6] << 16 | static_cast<uint32_t>(reply.data[7]) << 24);
+
+    reply = transact(makeSDO(3, 0x2B, 0x6041, 0, 0x1234));
+    BOOST_REQUIRE_EQUAL(0x80, reply.data[0]);
+    BOOST_REQUIRE_EQUAL(0x02, reply.data[4]);
+    BOOST_REQUIRE_EQUAL(0x01, reply.data[6]);
+}
+
+BOOST_AUTO_TEST_CASE(it_follows_the_ds402_state_machine)
+{
+    SimulatedDrive& drive = bus.addDrive(3);
+    download(3, 0x6040, 0, 0x06, 2);
+    BOOST_REQUIRE_EQUAL(StatusWord::READY_TO_SWITCH_ON, drive.getState());
+    download(3, 0x6040, 0, 0x0F, 2);
+    BOOST_REQUIRE_EQUAL(StatusWord::OPERATION_ENABLED, drive.getState());
+
+    Controller controller(3);
+    controller.process(transact(controller.queryStatusWord()));
+    BOOST_REQUIRE_EQUAL(StatusWord::OPERATION_ENABLED, controller.getStatusWord().state);
+
+    drive.setFault(0x2310);
+    download(3, 0x6040, 0, 0x0F, 2);
+    BOOST_REQUIRE_EQUAL(StatusWord::FAULT, drive.getState());
+    download(3, 0x6040, 0, 0x80, 2);
+    BOOST_REQUIRE_EQUAL(StatusWord::SWITCH_ON_DISABLED, drive.getState());
+}
+
+BOOST_AUTO_TEST_CASE(it_produces_heartbeats_once_configured)
+{
+    bus.addDrive(3);
+    download(3, 0x1017, 0, 100, 2);
+    bus.write(makeNMT(0x01, 0));
+
+    canbus::Message heartbeat = bus.read();
+    BOOST_REQUIRE_EQUAL(0x703, heartbeat.can_id);
+    BOOST_REQUIRE_EQUAL(0x05, heartbeat.data[0]);
+    base::Time first = heartbeat.time;
+    heartbeat = bus.read();
+    BOOST_REQUIRE_EQUAL(100000, (heartbeat.time - first).toMicroseconds());
+}
+
+BOOST_AUTO_TEST_CASE(it_sends_mapped_tpdos_on_sync)
+{
+    SimulatedDrive& drive = bus.addDrive(3);
+    drive.set<PositionActualInternalValue>(0x12345678);
+    download(3, 0x1A00, 0, 0, 1);
+    download(3, 0x1A00, 1, 0x60630020, 4);
+    download(3, 0x1A00, 0, 1, 1);
+    download(3, 0x1800, 2, 2, 1);
+    download(3, 0x1800, 1, 0x183, 4);
+    bus.write(makeNMT(0x01, 3));
+
+    bus.write(makeSync());
+    bus.write(makeSync());
+    canbus::Message pdo = bus.read();
+    BOOST_REQUIRE_EQUAL(0x183, pdo.can_id);
+    BOOST_REQUIRE_EQUAL(4, pdo.size);
+    BOOST_REQUIRE_EQUAL(0x78, pdo.data[0]);
+    BOOST_REQUIRE_EQUAL(0x12, pdo.data[3]);
+    BOOST_REQUIRE_EQUAL(0, bus.getPendingMessagesCount());
+}
+
+BOOST_AUTO_TEST_CASE(it_applies_synchronous_rpdos_on_sync)
+{
+    SimulatedDrive& drive = bus.addDrive(3);
+    download(3, 0x6060, 0, OperationMode::CYCLIC_SYNCHRONOUS_POSITION, 1);
+    download(3, 0x6040, 0, 0x06, 2);
+    download(3, 0x6040, 0, 0x0F, 2);
+    download(3, 0x1600, 0, 0, 1);
+    download(3, 0x1600, 1, 0x607A0020, 4);
+    download(3, 0x1600, 0, 1, 1);
+    download(3, 0x1400, 2, 1, 1);
+    download(3, 0x1400, 1, 0x203, 4);
+    bus.write(makeNMT(0x01, 3));
+
+    canbus::Message rpdo;
+    rpdo.can_id = 0x203;
+    rpdo.size = 4;
+    rpdo.data[0] = 0x10;
+    rpdo.data[1] = 0x27;
+    bus.write(rpdo);
+    bus.advance(base::Time::fromMilliseconds(1));
+    BOOST_REQUIRE_EQUAL(0, drive.get<PositionActualInternalValue>());
+
+    bus.write(makeSync());
+    bus.advance(base::Time::fromMilliseconds(1));
+    BOOST_REQUIRE_EQUAL(10000, drive.get<PositionActualInternalValue>());
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_a_mapping_of_unknown_or_oversized_objects)
+{
+    bus.addDrive(3);
+    download(3, 0x1A00, 0, 0, 1);
+    canbus::Message reply = transact(makeSDO(3, 0x23, 0x1A00, 1, 0x50000020));
+    BOOST_REQUIRE_EQUAL(0x80, reply.data[0]);
+    BOOST_REQUIRE_EQUAL(0x41, reply.data[4]);
+    reply = transact(makeSDO(3, 0x23, 0x1A00, 1, 0x60410020));
+    BOOST_REQUIRE_EQUAL(0x80, reply.data[0]);
+    BOOST_REQUIRE_EQUAL(0x41, reply.data[4]);
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_mapping_entries_while_the_mapping_is_enabled)
+{
+    SimulatedDrive& drive = bus.addDrive(3);
+    drive.set<PositionActualInternalValue>(0x12345678);
+    download(3, 0x1A00, 0, 0, 1);
+    download(3, 0x1A00, 1, 0x60630020, 4);
+    download(3, 0x1A00, 0, 1, 1);
+    canbus::Message reply = transact(makeSDO(3, 0x23, 0x1A00, 1, 0x50000020));
+    BOOST_REQUIRE_EQUAL(0x80, reply.data[0]);
+    BOOST_REQUIRE_EQUAL(0x22, reply.data[4]);
+    BOOST_REQUIRE_EQUAL(0x08, reply.data[7]);
+
+    download(3, 0x1800, 2, 1, 1);
+    download(3, 0x1800, 1, 0x183, 4);
+    bus.write(makeNMT(0x01, 3));
+    bus.write(makeSync());
+    canbus::Message pdo = bus.read();
+    BOOST_REQUIRE_EQUAL(0x183, pdo.can_id);
+    BOOST_REQUIRE_EQUAL(4, pdo.size);
+    BOOST_REQUIRE_EQUAL(0x78, pdo.data[0]);
+}
+
+BOOST_AUTO_TEST_CASE(it_drops_frames_with_the_configured_probability)
+{
+    SimulatedBus::Configuration configuration = makeConfiguration();
+    configuration.lossProbability = 1;
+    SimulatedBus lossy(configuration);
+    lossy.addDrive(3);
+    lossy.write(makeSDO(3, 0x40, 0x6041, 0));
+    BOOST_REQUIRE_THROW(lossy.read(), std::runtime_error);
+    BOOST_REQUIRE_EQUAL(1, lossy.getStatistics().lost);
+}
+
+BOOST_AUTO_TEST_CASE(it_handles_many_nodes)
+{
+    for (int i = 1; i <= 48; ++i)
+        bus.addDrive(i);
+    for (int i = 1; i <= 48; ++i)
+        bus.write(makeSDO(i, 0x40, 0x6041, 0));
+    for (int i = 1; i <= 48; ++i)
+        BOOST_REQUIRE_EQUAL(0x580 + i, bus.read().can_id);
+    BOOST_REQUIRE_THROW(bus.addDrive(48), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,70 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/Statistics.hpp>
+#include <motors_elmo_ds402/Controller.hpp>
+
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(StatisticsSuite)
+
+BOOST_AUTO_TEST_CASE(it_sorts_values_in_power_of_two_buckets)
+{
+    BOOST_REQUIRE_EQUAL(0, Histogram::getBucket(0));
+    BOOST_REQUIRE_EQUAL(1, Histogram::getBucket(1));
+    BOOST_REQUIRE_EQUAL(2, Histogram::getBucket(2));
+    BOOST_REQUIRE_EQUAL(2, Histogram::getBucket(3));
+    BOOST_REQUIRE_EQUAL(11, Histogram::getBucket(1024));
+    BOOST_REQUIRE_EQUAL(HistogramSnapshot::BUCKET_COUNT - 1,
+        Histogram::getBucket(uint64_t(1) << 62));
+}
+
+BOOST_AUTO_TEST_CASE(it_reports_the_histogram_summary)
+{
+    Histogram histogram;
+    for (int i = 0; i < 99; ++i)
+        histogram.add(100);
+    histogram.add(5000);
+
+    HistogramSnapshot snapshot = histogram.snapshot();
+    BOOST_REQUIRE_EQUAL(100, snapshot.count);
+    BOOST_REQUIRE_EQUAL(100, snapshot.min);
+    BOOST_REQUIRE_EQUAL(5000, snapshot.max);
+    BOOST_REQUIRE_CLOSE(149, snapshot.mean(), 1e-9);
+    BOOST_REQUIRE_EQUAL(128, snapshot.percentile(0.5));
+    BOOST_REQUIRE_EQUAL(128, snapshot.percentile(0.99));
+    BOOST_REQUIRE_EQUAL(5000, snapshot.percentile(1));
+
+    histogram.clear();
+    BOOST_REQUIRE_EQUAL(0, histogram.snapshot().count);
+    BOOST_REQUIRE_EQUAL(0, histogram.snapshot().min);
+}
+
+BOOST_AUTO_TEST_CASE(the_controller_records_the_tpdo_timings)
+{
+    Controller controller(2);
+    controller.queryPeriodicJointStateUpdate(1, 1);
+
+    canbus::Message msg;
+    msg.can_id = 0x282;
+    msg.size = 8;
+    int64_t arrivals[] = { 1000, 2000, 3100, 4000 };
+    for (int64_t arrival : arrivals)
+    {
+        controller.notifySync(base::Time::fromMicroseconds(arrival - 300));
+        msg.time = base::Time::fromMicroseconds(arrival);
+        controller.process(msg);
+    }
+
+    ControllerStatisticsSnapshot stats = controller.getStatistics().snapshot();
+    BOOST_REQUIRE_EQUAL(4, stats.frames[FRAME_TPDO]);
+    BOOST_REQUIRE_EQUAL(4, stats.syncToPDOLatency.count);
+    BOOST_REQUIRE_EQUAL(300, stats.syncToPDOLatency.max);
+    // Intervals are 1000, 1100 and 900
+    BOOST_REQUIRE_EQUAL(2, stats.tpdoJitter.count);
+    BOOST_REQUIRE_EQUAL(100, stats.tpdoJitter.min);
+    BOOST_REQUIRE_EQUAL(200, stats.tpdoJitter.max);
+
+    controller.clearStatistics();
+    BOOST_REQUIRE_EQUAL(0, controller.getStatistics().snapshot().frames[FRAME_TPDO]);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
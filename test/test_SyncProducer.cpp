@@ -0,0 +1,73 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/SyncProducer.hpp>
+#include <motors_elmo_ds402/SimulatedBus.hpp>
+
+using namespace std;
+using namespace motors_elmo_ds402;
+
+static canbus::Message makeSync()
+{
+    canbus::Message msg;
+    msg.can_id = 0x80;
+    msg.size = 0;
+    return msg;
+}
+
+BOOST_AUTO_TEST_SUITE(SyncProducerSuite)
+
+BOOST_AUTO_TEST_CASE(it_rejects_a_null_period)
+{
+    SimulatedBus bus;
+    SyncProducer::Configuration configuration;
+    configuration.period = base::Time();
+    BOOST_REQUIRE_THROW(SyncProducer(bus, makeSync(), configuration),
+        std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(it_writes_sync_at_the_configured_period)
+{
+    SimulatedBus bus;
+    SyncProducer::Configuration configuration;
+    configuration.period = base::Time::fromMicroseconds(500);
+    SyncProducer producer(bus, makeSync(), configuration);
+    BOOST_REQUIRE(producer.getLastSyncTime().isNull());
+
+    auto startTime = chrono::steady_clock::now();
+    producer.start();
+    BOOST_REQUIRE_THROW(producer.start(), std::logic_error);
+    this_thread::sleep_for(chrono::milliseconds(50));
+    producer.stop();
+    auto elapsed = chrono::steady_clock::now() - startTime;
+    BOOST_REQUIRE(!producer.isRunning());
+
+    // Be lenient, the test machine is not a real-time system. The producer
+    // cannot have gone through more periods than elapsed, though
+    auto stats = producer.getStatistics();
+    uint64_t periods = chrono::duration_cast<chrono::microseconds>(elapsed).count() /
+        configuration.period.toMicroseconds();
+    BOOST_REQUIRE_GT(stats.cycles, 20);
+    BOOST_REQUIRE_LE(stats.cycles + stats.overruns, periods);
+    BOOST_REQUIRE_EQUAL(stats.cycles, bus.getStatistics().written);
+    BOOST_REQUIRE_EQUAL(stats.cycles, stats.wakeupLatency.count);
+    BOOST_REQUIRE_EQUAL(stats.cycles - 1, stats.periodJitter.count);
+    BOOST_REQUIRE(!producer.getLastSyncTime().isNull());
+}
+
+BOOST_AUTO_TEST_CASE(it_reports_the_thread_setup_once_started)
+{
+    SimulatedBus bus;
+    SyncProducer::Configuration configuration;
+    SyncProducer producer(bus, makeSync(), configuration);
+    producer.start();
+    BOOST_REQUIRE(producer.isRealTime());
+    producer.stop();
+
+    // No CPU that high on the test machine
+    configuration.cpu = 1023;
+    SyncProducer pinned(bus, makeSync(), configuration);
+    pinned.start();
+    BOOST_REQUIRE(!pinned.isRealTime());
+    pinned.stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
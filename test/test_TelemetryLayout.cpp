@@ -0,0 +1,53 @@
+#include <boost/test/unit_test.hpp>
+#include <motors_elmo_ds402/TelemetryLayout.hpp>
+
+using namespace motors_elmo_ds402;
+
+BOOST_AUTO_TEST_SUITE(TelemetryLayoutSuite)
+
+BOOST_AUTO_TEST_CASE(it_packs_objects_in_the_minimum_number_of_pdos)
+{
+    auto layout = packTelemetry({
+        &getObjectInfo<StatusWordRegister>(),
+        &getObjectInfo<PositionActualInternalValue>(),
+        &getObjectInfo<TorqueDemand>(),
+        &getObjectInfo<FollowingErrorActualValue>(),
+        &getObjectInfo<ModesOfOperation>(),
+        &getObjectInfo<VelocityActualValue>()
+    });
+
+    // 2 + 4 + 2 + 4 + 1 + 4 = 17 bytes
+    BOOST_REQUIRE_EQUAL(3, layout.getPDOCount());
+    BOOST_REQUIRE_EQUAL(8, layout.pdos[0].size);
+    BOOST_REQUIRE_EQUAL(8, layout.pdos[1].size);
+    BOOST_REQUIRE_EQUAL(1, layout.pdos[2].size);
+    BOOST_REQUIRE_EQUAL(&getObjectInfo<PositionActualInternalValue>(),
+        layout.pdos[0].entries[0].object);
+    BOOST_REQUIRE_EQUAL(4, layout.pdos[0].entries[1].offset);
+    BOOST_REQUIRE(layout.contains(getObjectInfo<ModesOfOperation>()));
+    BOOST_REQUIRE_EQUAL(UPDATE_STATUS_WORD | UPDATE_JOINT_POSITION | UPDATE_JOINT_VELOCITY,
+        layout.getUpdateIds());
+}
+
+BOOST_AUTO_TEST_CASE(it_maps_duplicate_objects_only_once)
+{
+    auto layout = packTelemetry({
+        &getObjectInfo<StatusWordRegister>(),
+        &getObjectInfo<StatusWordRegister>()
+    });
+    BOOST_REQUIRE_EQUAL(1, layout.getPDOCount());
+    BOOST_REQUIRE_EQUAL(1, layout.pdos[0].entries.size());
+}
+
+BOOST_AUTO_TEST_CASE(it_rejects_sets_that_do_not_fit_in_the_available_pdos)
+{
+    std::vector<ObjectInfo const*> objects = {
+        &getObjectInfo<PositionActualInternalValue>(),
+        &getObjectInfo<VelocityActualValue>(),
+        &getObjectInfo<FollowingErrorActualValue>()
+    };
+    BOOST_REQUIRE_THROW(packTelemetry(objects, 1), std::invalid_argument);
+    BOOST_REQUIRE_EQUAL(2, packTelemetry(objects, 2).getPDOCount());
+}
+
+BOOST_AUTO_TEST_SUITE_END()